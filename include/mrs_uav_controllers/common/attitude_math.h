@@ -0,0 +1,58 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_ATTITUDE_MATH_H
+#define MRS_UAV_CONTROLLERS_COMMON_ATTITUDE_MATH_H
+
+/**
+ * The heading operations of mrs_lib::AttitudeConverter without exceptions, for the control loop.
+ *
+ * The AttitudeConverter throws near the singular attitudes and the exceptions would be thrown on every
+ * update while the UAV stays there. These return nothing instead, the caller chooses the fallback and
+ * raises FLIGHT_RECORD_ATTITUDE_SINGULAR, which is counted in the diagnostics.
+ */
+
+#include <eigen3/Eigen/Eigen>
+
+#include <optional>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/**
+ * @brief the angle of the body x projected to the world xy plane
+ *
+ * @return nothing when the body x is vertical
+ */
+std::optional<double> getHeading(const Eigen::Matrix3d& R) noexcept;
+
+/**
+ * @brief the rate of the heading caused by the attitude rate
+ *
+ * @param attitude_rate [rad/s] in the body frame
+ *
+ * @return [rad/s], nothing when the body x is close to vertical
+ */
+std::optional<double> getHeadingRate(const Eigen::Matrix3d& R, const Eigen::Vector3d& attitude_rate) noexcept;
+
+/**
+ * @brief the body yaw rate which produces the heading rate, with zero roll and pitch rates
+ *
+ * @return [rad/s], nothing when the body yaw does not change the heading
+ */
+std::optional<double> getYawRateIntrinsic(const Eigen::Matrix3d& R, const double heading_rate) noexcept;
+
+/**
+ * @brief the orientation with the same body z and the given heading
+ *
+ * The body x is the oblique projection of the heading vector along the world z, as in mrs_lib.
+ *
+ * @return nothing when the body z is horizontal
+ */
+std::optional<Eigen::Matrix3d> setHeading(const Eigen::Matrix3d& R, const double heading) noexcept;
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif  // MRS_UAV_CONTROLLERS_COMMON_ATTITUDE_MATH_H
@@ -0,0 +1,52 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_BENCHMARK_UTILS_H
+#define MRS_UAV_CONTROLLERS_COMMON_BENCHMARK_UTILS_H
+
+#include <cstdint>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/**
+ * @brief the number of heap allocations (malloc, calloc, realloc, and so operator new) of the process so far
+ *
+ * Counted by wrapping the glibc allocator, so only available in the executables which compile
+ * benchmark_utils.cpp in, never link it into the controllers. Always 0 without glibc.
+ */
+uint64_t getAllocationCount(void);
+
+/**
+ * @brief the p-th percentile (0..1) of the samples, nearest rank
+ */
+double samplePercentile(std::vector<double> samples, const double p);
+
+/**
+ * @brief a timestamp cheap enough to time single calls of a few hundred ns, the TSC on x64, CLOCK_MONOTONIC_RAW elsewhere
+ *
+ * @return [ticks], see getTimestampPeriod()
+ */
+uint64_t readTimestamp(void);
+
+/**
+ * @brief [s] per tick of readTimestamp(), calibrated against the steady clock on the first call, which takes 50 ms
+ */
+double getTimestampPeriod(void);
+
+/**
+ * @brief [ticks] the least difference of two back-to-back readTimestamp(), to be subtracted from the timed calls
+ */
+uint64_t getTimestampOverhead(void);
+
+/**
+ * @brief the build type and the optimizations (LTO, PGO, tuning) the benchmark was compiled with
+ */
+const char* getBuildDescription(void);
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_CONTROL_ALLOCATION_H
+#define MRS_UAV_CONTROLLERS_COMMON_CONTROL_ALLOCATION_H
+
+#include <mrs_uav_managers/controller.h>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// the layouts are limited by the 8 controls of mavros_msgs/ActuatorControl
+const int CONTROL_ALLOCATION_MAX_MOTORS = 8;
+
+// of the fixed maximum size, so the mixing on every IMU message does not allocate
+typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, CONTROL_ALLOCATION_MAX_MOTORS, 1> MotorVector_t;
+
+/* Motor_t //{ */
+
+typedef struct
+{
+  double x;          // [m] the position of the propeller in the body frame
+  double y;          // [m]
+  double direction;  // 1 = the reaction torque of the motor is along +z, -1 = along -z
+} Motor_t;
+
+//}
+
+/* TiltedMotor_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d position;   // [m] the position of the propeller in the body frame
+  Eigen::Vector3d axis;       // the direction of the thrust in the body frame
+  double          direction;  // 1 = the reaction torque of the motor is along +axis, -1 = along -axis
+} TiltedMotor_t;
+
+//}
+
+/* class ControlAllocation //{ */
+
+/**
+ * @brief the mixer from the collective thrust (or the full body force) and the body torques to the per-motor throttles
+ *
+ * The allocation matrix is inverted once in the constructor, the per-motor forces are then
+ * converted to throttles by the quadratic thrust model of the UAV. Only the first
+ * CONTROL_ALLOCATION_MAX_MOTORS motors of a longer layout are used, the caller reports it.
+ */
+class ControlAllocation {
+
+public:
+  /**
+   * @param motors the layout of the motors
+   * @param torque_coefficient [m], the reaction torque of a motor per its thrust
+   * @param motor_params the thrust model of the whole UAV
+   */
+  ControlAllocation(const std::vector<Motor_t>& motors, const double torque_coefficient, const mrs_lib::quadratic_thrust_model::MotorParams_t& motor_params);
+
+  /**
+   * @brief the allocation of a fully actuated multirotor, the motors are tilted
+   *
+   * @param motors the layout of the motors
+   * @param torque_coefficient [m], the reaction torque of a motor per its thrust
+   * @param motor_params the thrust model of the whole UAV
+   */
+  ControlAllocation(const std::vector<TiltedMotor_t>& motors, const double torque_coefficient,
+                    const mrs_lib::quadratic_thrust_model::MotorParams_t& motor_params);
+
+  int numberOfMotors(void) const;
+
+  // can the body force be allocated in all three axes
+  bool isFullyActuated(void) const;
+
+  // the rank of the allocation matrix, 6 is needed for the full actuation
+  int rank(void) const;
+
+  /**
+   * @brief mixes the wrench into the motor throttles
+   *
+   * @param thrust_force the collective thrust [N]
+   * @param torque the body torque [N m]
+   * @param throttles the output throttles, each in [0, 1]
+   *
+   * @return true if some motor has been saturated
+   */
+  bool mix(const double thrust_force, const Eigen::Vector3d& torque, MotorVector_t& throttles) const;
+
+  /**
+   * @brief mixes the full wrench into the motor throttles, only for the fully actuated allocation
+   *
+   * @param force the body force [N]
+   * @param torque the body torque [N m]
+   * @param throttles the output throttles, each in [0, 1]
+   *
+   * @return true if some motor has been saturated
+   */
+  bool mix(const Eigen::Vector3d& force, const Eigen::Vector3d& torque, MotorVector_t& throttles) const;
+
+private:
+  int  n_motors_;
+  bool fully_actuated_;
+  int  rank_;
+
+  mrs_lib::quadratic_thrust_model::MotorParams_t motor_params_;
+
+  // [n_motors x 4], [thrust, torque] -> motor forces, or [n_motors x 6], [force, torque] -> motor forces
+  Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, 0, CONTROL_ALLOCATION_MAX_MOTORS, 6> mixer_;
+
+  bool forcesToThrottles(MotorVector_t& forces, MotorVector_t& throttles) const;
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
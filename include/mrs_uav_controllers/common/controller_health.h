@@ -0,0 +1,188 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_CONTROLLER_HEALTH_H
+#define MRS_UAV_CONTROLLERS_COMMON_CONTROLLER_HEALTH_H
+
+#include <ros/ros.h>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+#include <mrs_uav_controllers/common/flight_recorder.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// the update time histogram, 4 buckets per octave from 1 us to ~1 s
+#define CONTROLLER_HEALTH_N_BUCKETS 80
+#define CONTROLLER_HEALTH_BUCKETS_PER_OCTAVE 4
+
+/* CpuCategory_t //{ */
+
+// what the CPU time of a controller instance is spent on
+typedef enum
+{
+  CPU_UPDATE = 0,  // update()
+  CPU_DRS,         // the dynamic reconfigure callbacks
+  CPU_SERVICE,     // the service callbacks
+  CPU_SUBSCRIBER,  // the subscriber callbacks
+  CPU_BACKGROUND,  // the own threads and timers of the controller
+  CPU_N_CATEGORIES,
+} CpuCategory_t;
+
+//}
+
+/* ControllerHealthParams_t //{ */
+
+typedef struct
+{
+  double rate;             // [Hz] of the diagnostics_out, 0 = not published
+  double max_update_time;  // [s] the p99 of the update time over this is reported as a warning, 0 = not checked
+} ControllerHealthParams_t;
+
+//}
+
+/* class ControllerHealth //{ */
+
+/**
+ * @brief the health and the performance margins of a controller
+ *
+ * The update thread only increments relaxed atomic counters: a histogram of the update time, the
+ * counts of the saturation flags (FLIGHT_RECORD_*), the solver iterations and the last values of the
+ * estimators. getDiagnostics() differentiates the counters against its previous call, so the reported
+ * percentiles and duty cycles are over the window between two calls. The status is published on
+ * "diagnostics_out" by a timer, the control manager or the operator can act on the eroding margins.
+ */
+class ControllerHealth {
+
+public:
+  /**
+   * @param name of the controller, the name of the diagnostic status
+   * @param estimates the names of the monitored estimates, e.g., the mass difference
+   */
+  ControllerHealth(const std::string& name, const std::vector<std::string>& estimates, const ControllerHealthParams_t& params);
+
+  /**
+   * @brief starts publishing the diagnostics_out in the namespace of the controller
+   */
+  void advertise(ros::NodeHandle& nh);
+
+  /**
+   * @brief called once per update
+   *
+   * @param duration [s] of the update
+   * @param flags FLIGHT_RECORD_* which were raised during the update
+   */
+  void addUpdate(const double duration, const uint32_t flags);
+
+  void addUpdate(const std::chrono::steady_clock::time_point& start, const uint32_t flags) {
+    addUpdate(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), flags);
+  }
+
+  /**
+   * @brief called once per solver run
+   *
+   * @param truncated the solver ended on the iteration limit
+   * @param fast_path the solution came from the unconstrained fast path, the solver did not run
+   */
+  void addSolve(const int iterations, const bool truncated, const bool fast_path = false);
+
+  void setEstimate(const size_t index, const double value);
+
+  /**
+   * @brief accounts a call which ran in the thread of the caller, see CpuTimeScope
+   *
+   * @param cpu_time [ns] CLOCK_THREAD_CPUTIME_ID
+   * @param wall_time [ns]
+   */
+  void addCpuTime(const CpuCategory_t category, const uint64_t cpu_time, const uint64_t wall_time);
+
+  /**
+   * @brief the statistics since the previous call
+   */
+  diagnostic_msgs::DiagnosticStatus getDiagnostics(const ros::Time& now);
+
+private:
+  std::string              name_;
+  std::vector<std::string> estimate_names_;
+  ControllerHealthParams_t params_;
+
+  ros::Publisher publisher_diagnostics_;
+  ros::Timer     timer_diagnostics_;
+
+  void timerDiagnostics(const ros::TimerEvent& event);
+
+  std::atomic<uint64_t>                                          n_updates_;
+  std::array<std::atomic<uint64_t>, CONTROLLER_HEALTH_N_BUCKETS> update_times_;
+  std::array<std::atomic<uint64_t>, FLIGHT_RECORD_N_FLAGS>       flags_;
+
+  std::atomic<uint64_t> n_solves_;
+  std::atomic<uint64_t> n_iterations_;
+  std::atomic<uint64_t> n_truncated_;
+  std::atomic<uint64_t> n_fast_path_;
+
+  std::vector<std::atomic<double>> estimates_;
+
+  std::array<std::atomic<uint64_t>, CPU_N_CATEGORIES> cpu_calls_;
+  std::array<std::atomic<uint64_t>, CPU_N_CATEGORIES> cpu_time_;
+  std::array<std::atomic<uint64_t>, CPU_N_CATEGORIES> wall_time_;
+
+  // | -------------- the state of the previous call -------------- |
+
+  std::mutex mutex_window_;
+
+  ros::Time                                         last_time_;
+  uint64_t                                          last_n_updates_;
+  std::array<uint64_t, CONTROLLER_HEALTH_N_BUCKETS> last_update_times_;
+  std::array<uint64_t, FLIGHT_RECORD_N_FLAGS>       last_flags_;
+  uint64_t                                          last_n_solves_;
+  uint64_t                                          last_n_iterations_;
+  uint64_t                                          last_n_truncated_;
+  uint64_t                                          last_n_fast_path_;
+  std::vector<double>                               last_estimates_;
+  std::array<uint64_t, CPU_N_CATEGORIES>            last_cpu_calls_;
+  std::array<uint64_t, CPU_N_CATEGORIES>            last_cpu_time_;
+  std::array<uint64_t, CPU_N_CATEGORIES>            last_wall_time_;
+};
+
+//}
+
+/* class CpuTimeScope //{ */
+
+/**
+ * @brief measures the thread CPU time and the wall time of a scope and accounts it to the ControllerHealth
+ *
+ * The aliases of a controller share the process of the control manager, the per-thread clock
+ * separates their CPU use from each other and from the rest of the process.
+ */
+class CpuTimeScope {
+
+public:
+  CpuTimeScope(ControllerHealth& health, const CpuCategory_t category);
+  ~CpuTimeScope();
+
+  CpuTimeScope(const CpuTimeScope&) = delete;
+  CpuTimeScope& operator=(const CpuTimeScope&) = delete;
+
+private:
+  ControllerHealth& health_;
+  CpuCategory_t     category_;
+
+  uint64_t cpu_start_;
+  uint64_t wall_start_;
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
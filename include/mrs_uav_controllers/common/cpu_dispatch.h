@@ -0,0 +1,91 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_CPU_DISPATCH_H
+#define MRS_UAV_CONTROLLERS_COMMON_CPU_DISPATCH_H
+
+/**
+ * Runtime selection of the instruction set of the numeric kernels.
+ *
+ * A kernel is compiled once per instruction set from one always_inline body, and a GNU ifunc resolver
+ * picks the variant when the library is loaded, so one binary runs on every x64 machine and uses the
+ * widest vectors available. The resolver runs before the relocations of the library are done, so it
+ * may only call the static inline detectCpuIsa() below.
+ *
+ * Dispatch is used on x64 with GCC/Clang and ELF. Elsewhere (arm64, where NEON is the baseline, or
+ * with -DCPU_DISPATCH=OFF) the kernels are compiled once with the flags of the build.
+ */
+
+#if defined(__x86_64__) && defined(__GNUC__) && defined(__ELF__) && !defined(MRS_UAV_CONTROLLERS_NO_CPU_DISPATCH)
+#define MRS_UAV_CONTROLLERS_CPU_DISPATCH
+#endif
+
+// forces the kernel body into each of the variants
+#define CPU_DISPATCH_INLINE static inline __attribute__((always_inline))
+
+#define CPU_DISPATCH_TARGET_AVX512 __attribute__((target("avx512f,avx512vl,avx2,fma")))
+#define CPU_DISPATCH_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define CPU_DISPATCH_TARGET_SSE42 __attribute__((target("sse4.2")))
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+typedef enum
+{
+  CPU_ISA_DEFAULT = 0,  // the flags of the build
+  CPU_ISA_SSE42,
+  CPU_ISA_AVX2,    // + FMA
+  CPU_ISA_AVX512,  // F + VL, + FMA
+} CpuIsa_t;
+
+/* detectCpuIsa() //{ */
+
+static inline CpuIsa_t detectCpuIsa(void) {
+
+#ifdef MRS_UAV_CONTROLLERS_CPU_DISPATCH
+
+  // has to be called explicitly, the resolvers run before the constructors
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("fma")) {
+    return CPU_ISA_AVX512;
+  }
+
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return CPU_ISA_AVX2;
+  }
+
+  if (__builtin_cpu_supports("sse4.2")) {
+    return CPU_ISA_SSE42;
+  }
+
+#endif
+
+  return CPU_ISA_DEFAULT;
+}
+
+//}
+
+/* getCpuIsaName() //{ */
+
+static inline const char* getCpuIsaName(const CpuIsa_t isa) {
+
+  switch (isa) {
+    case CPU_ISA_SSE42:
+      return "sse4.2";
+    case CPU_ISA_AVX2:
+      return "avx2";
+    case CPU_ISA_AVX512:
+      return "avx512";
+    default:
+      return "default";
+  }
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,154 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_FLATNESS_H
+#define MRS_UAV_CONTROLLERS_COMMON_FLATNESS_H
+
+#include <eigen3/Eigen/Eigen>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// how the desired orientation is constructed from the desired force and the heading
+enum RotationType_t
+{
+  ROTATION_LEE  = 0,  // the body y is orthogonal to the heading vector
+  ROTATION_BACA = 1,  // the body x is the oblique projection of the heading vector along the world z
+};
+
+/* FlatReference_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d jerk;                  // [m/s^3]
+  Eigen::Vector3d snap;                  // [m/s^4]
+  double          heading;               // [rad]
+  double          heading_rate;          // [rad/s]
+  double          heading_acceleration;  // [rad/s^2]
+} FlatReference_t;
+
+//}
+
+/* FlatnessFeedforward_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d attitude_rate;         // [rad/s] in the body frame
+  Eigen::Vector3d angular_acceleration;  // [rad/s^2] in the body frame
+} FlatnessFeedforward_t;
+
+//}
+
+/* flatnessFeedforward() //{ */
+
+/**
+ * @brief the body rates and angular accelerations of the desired orientation given by the derivatives of the flat outputs
+ *
+ * The roll and pitch parts follow from differentiating a + g = c * z_b, the yaw parts from differentiating
+ * the constraint which defines the body x for the given rotation type.
+ *
+ * @tparam rotation_type RotationType_t
+ * @param Rd the desired orientation
+ * @param c the desired collective acceleration along the desired body z [m/s^2]
+ * @param reference
+ * @param feedforward the output
+ *
+ * @return false if the orientation is singular for the rotation type or c is not positive
+ */
+template <int rotation_type>
+bool flatnessFeedforward(const Eigen::Matrix3d& Rd, const double c, const FlatReference_t& reference, FlatnessFeedforward_t& feedforward) {
+
+  static_assert(rotation_type == ROTATION_LEE || rotation_type == ROTATION_BACA, "unknown rotation type");
+
+  if (!(c > 1e-3)) {
+    return false;
+  }
+
+  const Eigen::Vector3d xb = Rd.col(0);
+  const Eigen::Vector3d yb = Rd.col(1);
+  const Eigen::Vector3d zb = Rd.col(2);
+
+  const Eigen::Vector3d& j = reference.jerk;
+  const Eigen::Vector3d& s = reference.snap;
+
+  // | ---------------------- roll and pitch ---------------------- |
+
+  const double p = -yb.dot(j) / c;
+  const double q = xb.dot(j) / c;
+
+  // the derivative of the collective acceleration
+  const double c_dot = zb.dot(j);
+
+  // | -------------------------- yaw -------------------------- |
+
+  const double psi      = reference.heading;
+  const double psi_dot  = reference.heading_rate;
+  const double psi_ddot = reference.heading_acceleration;
+
+  const Eigen::Vector3d xc(cos(psi), sin(psi), 0);
+  const Eigen::Vector3d yc(-sin(psi), cos(psi), 0);
+
+  double r;
+
+  if constexpr (rotation_type == ROTATION_LEE) {
+
+    // x_c . y_b = 0
+    const double denominator = xc.dot(xb);
+
+    if (fabs(denominator) < 1e-3) {
+      return false;
+    }
+
+    r = (psi_dot * yc.dot(yb) + p * xc.dot(zb)) / denominator;
+
+  } else {
+
+    // y_c . x_b = 0
+    const double denominator = yc.dot(yb);
+
+    if (fabs(denominator) < 1e-3) {
+      return false;
+    }
+
+    r = (psi_dot * xc.dot(xb) + q * yc.dot(zb)) / denominator;
+  }
+
+  // | ------------------- angular acceleration ------------------- |
+
+  const double alpha_x = (-yb.dot(s) - 2.0 * c_dot * p + c * q * r) / c;
+  const double alpha_y = (xb.dot(s) - 2.0 * c_dot * q - c * p * r) / c;
+
+  double alpha_z;
+
+  if constexpr (rotation_type == ROTATION_LEE) {
+
+    const Eigen::Vector3d xc_dot  = psi_dot * yc;
+    const Eigen::Vector3d xc_ddot = psi_ddot * yc - psi_dot * psi_dot * xc;
+    const Eigen::Vector3d yb_dot  = -r * xb + p * zb;
+
+    alpha_z = p * q + (xc_ddot.dot(yb) + 2.0 * xc_dot.dot(yb_dot) + (alpha_x + q * r) * xc.dot(zb)) / xc.dot(xb);
+
+  } else {
+
+    const Eigen::Vector3d yc_dot  = -psi_dot * xc;
+    const Eigen::Vector3d yc_ddot = -psi_ddot * xc - psi_dot * psi_dot * yc;
+    const Eigen::Vector3d xb_dot  = r * yb - q * zb;
+
+    alpha_z = -p * q - (yc_ddot.dot(xb) + 2.0 * yc_dot.dot(xb_dot) + (p * r - alpha_y) * yc.dot(zb)) / yc.dot(yb);
+  }
+
+  feedforward.attitude_rate        = Eigen::Vector3d(p, q, r);
+  feedforward.angular_acceleration = Eigen::Vector3d(alpha_x, alpha_y, alpha_z);
+
+  return feedforward.attitude_rate.allFinite() && feedforward.angular_acceleration.allFinite();
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,179 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_FLIGHT_RECORDER_H
+#define MRS_UAV_CONTROLLERS_COMMON_FLIGHT_RECORDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// flags of the FlightRecord_t
+#define FLIGHT_RECORD_TILT_SATURATED (1u << 0)
+#define FLIGHT_RECORD_THRUST_SATURATED (1u << 1)
+#define FLIGHT_RECORD_TILT_FAILSAFE (1u << 2)
+#define FLIGHT_RECORD_NULL_OUTPUT (1u << 3)
+#define FLIGHT_RECORD_RAMPUP (1u << 4)
+#define FLIGHT_RECORD_MPC_FAILED (1u << 5)
+#define FLIGHT_RECORD_DISTURBANCE_SATURATED (1u << 6)
+#define FLIGHT_RECORD_INTEGRAL_SATURATED (1u << 7)
+#define FLIGHT_RECORD_RATE_SATURATED (1u << 8)
+#define FLIGHT_RECORD_ATTITUDE_SINGULAR (1u << 9)
+#define FLIGHT_RECORD_N_FLAGS 10
+
+#define FLIGHT_RECORDER_MAGIC "MRSFLREC"
+#define FLIGHT_RECORDER_VERSION 1
+
+/* FlightRecord_t //{ */
+
+/**
+ * @brief one tick of a controller, all the vectors are in the frame of the odometry unless stated otherwise
+ */
+typedef struct
+{
+  double stamp;  // [s] of the odometry
+  double time;   // [s] of the output
+  double dt;     // [s]
+
+  // | ------------------------- state ------------------------- |
+
+  double position[3];
+  double velocity[3];
+  double acceleration[3];
+  double orientation[4];    // x, y, z, w
+  double attitude_rate[3];  // body frame
+
+  // | ----------------------- reference ----------------------- |
+
+  double reference_position[3];
+  double reference_velocity[3];
+  double reference_acceleration[3];
+  double reference_jerk[3];
+  double reference_heading;
+
+  // | ------------------ intermediate terms ------------------ |
+
+  double feedforward[3];        // [N]
+  double position_feedback[3];  // [N]
+  double velocity_feedback[3];  // [N]
+  double integral_feedback[3];  // [N]
+  double attitude_error[3];     // Eq
+  double attitude_rate_feedforward[3];
+  double theta;                 // [rad] the tilt of the desired force
+  double disturbance[3];        // [m/s^2] estimated by an observer
+
+  // | ------------------------ solver ------------------------ |
+
+  double  mpc_input[3];
+  int32_t mpc_iterations[3];
+  double  mpc_solve_time;  // [s] all the axes together
+
+  // | ------------------------ output ------------------------ |
+
+  double desired_orientation[4];  // x, y, z, w
+  double output_attitude_rate[3];
+  double thrust;
+  double thrust_force;  // [N]
+  double total_mass;    // [kg]
+  double mass_difference;
+
+  uint32_t flags;  // FLIGHT_RECORD_*
+} FlightRecord_t;
+
+//}
+
+/* FlightRecorderHeader_t //{ */
+
+typedef struct
+{
+  char     magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t capacity;
+  uint64_t n_written;  // all the records ever written, the next one goes to n_written % capacity
+  char     controller[64];
+  char     reserved[32];
+} FlightRecorderHeader_t;
+
+//}
+
+/* FlightRecordColumn_t //{ */
+
+typedef enum
+{
+  COLUMN_DOUBLE,
+  COLUMN_INT32,
+  COLUMN_UINT32,
+} FlightRecordColumnType_t;
+
+typedef struct
+{
+  std::string              name;
+  size_t                   offset;
+  FlightRecordColumnType_t type;
+  int                      count;  // the number of elements, the arrays are expanded to name_x, name_y, ...
+} FlightRecordColumn_t;
+
+/**
+ * @brief the layout of the FlightRecord_t, for the decoders
+ */
+const std::vector<FlightRecordColumn_t>& getFlightRecordColumns(void);
+
+//}
+
+/**
+ * @brief <directory>/<name>_<local start time>_<pid>.frec, a restarted node does not reuse the file of the previous run
+ */
+std::string getFlightRecorderPath(const std::string& directory, const std::string& name);
+
+/* class FlightRecorder //{ */
+
+/**
+ * @brief black-box recorder, a ring of fixed-size records in a memory-mapped file
+ *
+ * The file is created and mapped in the constructor. Writing a record is then just a copy into the mapping,
+ * there are no system calls and no allocations. The kernel writes the pages back to the file, so the records
+ * survive a crash of the process.
+ */
+class FlightRecorder {
+
+public:
+  /**
+   * @param path the file, it must not exist yet, an existing recording is never overwritten
+   * @param capacity how many records does the ring hold
+   * @param controller the name of the controller, stored in the header
+   */
+  FlightRecorder(const std::string& path, const size_t capacity, const std::string& controller);
+
+  ~FlightRecorder();
+
+  FlightRecorder(const FlightRecorder&) = delete;
+  FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+  bool        isOpen(void) const;
+  std::string getError(void) const;
+
+  void write(const FlightRecord_t& record);
+
+private:
+  size_t capacity_;
+  size_t size_ = 0;  // of the mapping
+
+  void*                   mapping_ = nullptr;
+  FlightRecorderHeader_t* header_  = nullptr;
+  FlightRecord_t*         records_ = nullptr;
+
+  std::string error_;
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,114 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_FLIGHT_RECORDER_UTILS_H
+#define MRS_UAV_CONTROLLERS_COMMON_FLIGHT_RECORDER_UTILS_H
+
+#include <mrs_uav_controllers/common/flight_recorder.h>
+#include <mrs_uav_controllers/common/state_predictor.h>
+
+#include <mrs_msgs/UavState.h>
+#include <mrs_msgs/PositionCommand.h>
+#include <mrs_msgs/AttitudeCommand.h>
+
+#include <eigen3/Eigen/Eigen>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* copying the messages into the FlightRecord_t //{ */
+
+inline void recordVector(double* target, const Eigen::Vector3d& vector) {
+
+  target[0] = vector[0];
+  target[1] = vector[1];
+  target[2] = vector[2];
+}
+
+inline void recordState(FlightRecord_t& record, const mrs_msgs::UavState& uav_state) {
+
+  record.stamp = uav_state.header.stamp.toSec();
+
+  record.position[0] = uav_state.pose.position.x;
+  record.position[1] = uav_state.pose.position.y;
+  record.position[2] = uav_state.pose.position.z;
+
+  record.velocity[0] = uav_state.velocity.linear.x;
+  record.velocity[1] = uav_state.velocity.linear.y;
+  record.velocity[2] = uav_state.velocity.linear.z;
+
+  record.acceleration[0] = uav_state.acceleration.linear.x;
+  record.acceleration[1] = uav_state.acceleration.linear.y;
+  record.acceleration[2] = uav_state.acceleration.linear.z;
+
+  record.orientation[0] = uav_state.pose.orientation.x;
+  record.orientation[1] = uav_state.pose.orientation.y;
+  record.orientation[2] = uav_state.pose.orientation.z;
+  record.orientation[3] = uav_state.pose.orientation.w;
+
+  record.attitude_rate[0] = uav_state.velocity.angular.x;
+  record.attitude_rate[1] = uav_state.velocity.angular.y;
+  record.attitude_rate[2] = uav_state.velocity.angular.z;
+}
+
+inline void recordState(FlightRecord_t& record, const ros::Time& stamp, const PredictedState_t& state) {
+
+  record.stamp = stamp.toSec();
+
+  recordVector(record.position, state.position);
+  recordVector(record.velocity, state.velocity);
+  recordVector(record.acceleration, state.acceleration);
+  recordVector(record.attitude_rate, state.attitude_rate);
+
+  record.orientation[0] = state.orientation.x();
+  record.orientation[1] = state.orientation.y();
+  record.orientation[2] = state.orientation.z();
+  record.orientation[3] = state.orientation.w();
+}
+
+inline void recordReference(FlightRecord_t& record, const mrs_msgs::PositionCommand& reference) {
+
+  record.reference_position[0] = reference.position.x;
+  record.reference_position[1] = reference.position.y;
+  record.reference_position[2] = reference.position.z;
+
+  record.reference_velocity[0] = reference.velocity.x;
+  record.reference_velocity[1] = reference.velocity.y;
+  record.reference_velocity[2] = reference.velocity.z;
+
+  record.reference_acceleration[0] = reference.acceleration.x;
+  record.reference_acceleration[1] = reference.acceleration.y;
+  record.reference_acceleration[2] = reference.acceleration.z;
+
+  record.reference_jerk[0] = reference.jerk.x;
+  record.reference_jerk[1] = reference.jerk.y;
+  record.reference_jerk[2] = reference.jerk.z;
+
+  record.reference_heading = reference.heading;
+}
+
+inline void recordOutput(FlightRecord_t& record, const mrs_msgs::AttitudeCommand& output) {
+
+  record.time = output.header.stamp.toSec();
+
+  record.desired_orientation[0] = output.attitude.x;
+  record.desired_orientation[1] = output.attitude.y;
+  record.desired_orientation[2] = output.attitude.z;
+  record.desired_orientation[3] = output.attitude.w;
+
+  record.output_attitude_rate[0] = output.attitude_rate.x;
+  record.output_attitude_rate[1] = output.attitude_rate.y;
+  record.output_attitude_rate[2] = output.attitude_rate.z;
+
+  record.thrust          = output.thrust;
+  record.total_mass      = output.total_mass;
+  record.mass_difference = output.mass_difference;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
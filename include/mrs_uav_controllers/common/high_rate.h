@@ -0,0 +1,86 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_HIGH_RATE_H
+#define MRS_UAV_CONTROLLERS_COMMON_HIGH_RATE_H
+
+#include <ros/ros.h>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <optional>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* HighRateParams_t //{ */
+
+typedef struct
+{
+  bool   enabled;
+  double min_dt;                // [s] an odometry closer than this to the last processed one is skipped
+  int    transform_decimation;  // [-] the transformer is queried on every n-th update, the orientation of the UAV state is used in between
+  double update_budget;         // [s] replaces the max_update_time of the diagnostics
+} HighRateParams_t;
+
+//}
+
+/* class Decimator //{ */
+
+/**
+ * @brief runs a stage of the update on every n-th call only
+ */
+class Decimator {
+
+public:
+  Decimator(const int period = 1);
+
+  /**
+   * @return true on the first call after reset() and then on every period-th call
+   */
+  bool tick(void);
+
+  /**
+   * @brief the next tick() returns true, e.g., after an activation
+   */
+  void reset(void);
+
+  int getPeriod(void) const;
+
+private:
+  int period_;
+  int counter_;
+};
+
+//}
+
+/**
+ * @brief the dt since the last processed odometry
+ *
+ * An odometry which comes closer than min_dt is skipped without moving last_stamp, its time is
+ * accounted in the next processed update, so the integrators see the whole elapsed time even when
+ * the odometry jitters around min_dt. An odometry from the past (e.g., a restarted simulation)
+ * restarts the dt from its stamp.
+ *
+ * @param stamp of the current odometry
+ * @param last_stamp of the last processed odometry, updated when the odometry is processed
+ *
+ * @return the dt [s], nothing when the odometry should be skipped
+ */
+std::optional<double> odometryDt(const ros::Time& stamp, ros::Time& last_stamp, const double min_dt);
+
+/**
+ * @brief rotates a vector from the frame of the odometry to fcu_untilted, as the transformer would, by the heading of the UAV
+ */
+Eigen::Vector3d toUntiltedFrame(const Eigen::Vector3d& vector, const double heading);
+
+/**
+ * @brief rotates a vector from fcu_untilted to the frame of the odometry
+ */
+Eigen::Vector3d fromUntiltedFrame(const Eigen::Vector3d& vector, const double heading);
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif  // MRS_UAV_CONTROLLERS_COMMON_HIGH_RATE_H
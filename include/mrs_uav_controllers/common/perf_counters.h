@@ -0,0 +1,91 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_PERF_COUNTERS_H
+#define MRS_UAV_CONTROLLERS_COMMON_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+typedef enum
+{
+  PERF_CYCLES = 0,
+  PERF_INSTRUCTIONS,
+  PERF_CACHE_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_N_COUNTERS,
+} PerfCounter_t;
+
+/* PerfCounterValues_t //{ */
+
+typedef struct
+{
+  uint64_t value[PERF_N_COUNTERS];
+  bool     available[PERF_N_COUNTERS];
+  uint64_t n_samples;  // how many start() - stop() pairs were accumulated
+} PerfCounterValues_t;
+
+//}
+
+/* class PerfCounters //{ */
+
+/**
+ * @brief hardware performance counters of the calling thread, user space only, via perf_event_open()
+ *
+ * The counters run continuously and are read before and after the measured code, the difference is
+ * accumulated. When the counters are not available (containers, perf_event_paranoid, VMs without a
+ * PMU), isAvailable() returns false and start() and stop() do nothing, the caller reports only the
+ * timings. A single counter which the CPU does not support is marked as unavailable.
+ */
+class PerfCounters {
+
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool        isAvailable(void) const;
+  std::string getError(void) const;
+
+  void start(void);
+  void stop(void);
+
+  void                reset(void);
+  PerfCounterValues_t getValues(void) const;
+
+  static const char* getName(const PerfCounter_t counter);
+
+private:
+  int fd_[PERF_N_COUNTERS];
+  int group_fd_ = -1;
+
+  // the position of the counters in the read group, -1 = not available
+  int index_[PERF_N_COUNTERS];
+  int n_opened_ = 0;
+
+  std::string error_;
+
+  uint64_t start_values_[PERF_N_COUNTERS];
+
+  PerfCounterValues_t values_;
+
+  bool read(uint64_t* values);
+};
+
+//}
+
+/**
+ * @brief the counters as a json object, averaged per sample, the unavailable counters are null
+ */
+std::string perfCountersToJson(const PerfCounterValues_t& values);
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
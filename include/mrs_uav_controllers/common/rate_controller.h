@@ -0,0 +1,77 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_RATE_CONTROLLER_H
+#define MRS_UAV_CONTROLLERS_COMMON_RATE_CONTROLLER_H
+
+#include <eigen3/Eigen/Eigen>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* RateControllerParams_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d inertia;         // [kg m^2] the diagonal of the inertia matrix
+  Eigen::Vector3d gains;           // [1/s] the attitude rate feedback
+  double          feedforward_tc;  // [s] time constant of the filter of the desired attitude rate derivative
+} RateControllerParams_t;
+
+//}
+
+/* class RateController //{ */
+
+/**
+ * @brief the attitude rate loop of the UAV closed in the controller
+ *
+ * Produces the body torque: tau = J * (Kw * (w_d - w) + dw_d/dt) + w x J w,
+ * where the derivative of the desired rate is obtained by a filtered difference.
+ */
+class RateController {
+
+public:
+  RateController(const RateControllerParams_t& params);
+
+  /**
+   * @brief forgets the last desired rate, the feedforward starts from zero
+   */
+  void reset(void);
+
+  /**
+   * @brief produces the body torque
+   *
+   * @param desired_rate the desired attitude rate in the body frame [rad/s]
+   * @param rate the measured attitude rate in the body frame [rad/s]
+   * @param dt the time since the last call [s]
+   *
+   * @return the torque in the body frame [N m]
+   */
+  Eigen::Vector3d update(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, const double dt);
+
+  /**
+   * @brief produces the body torque with a known angular acceleration feedforward
+   *
+   * The derivative of the desired rate is not estimated, e.g., when the feedforward comes from the differential flatness.
+   *
+   * @param angular_acceleration the desired angular acceleration in the body frame [rad/s^2]
+   */
+  Eigen::Vector3d update(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, const double dt, const Eigen::Vector3d& angular_acceleration);
+
+private:
+  RateControllerParams_t params_;
+
+  Eigen::Vector3d torque(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, const Eigen::Vector3d& angular_acceleration) const;
+
+  bool            first_update_ = true;
+  Eigen::Vector3d last_desired_rate_;
+  Eigen::Vector3d desired_rate_derivative_;
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_SHADOW_MODE_H
+#define MRS_UAV_CONTROLLERS_COMMON_SHADOW_MODE_H
+
+#include <ros/ros.h>
+
+#include <mrs_msgs/UavState.h>
+#include <mrs_msgs/PositionCommand.h>
+#include <mrs_msgs/AttitudeCommand.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* ShadowModeParams_t //{ */
+
+typedef struct
+{
+  bool             enabled;
+  int              queue_size;        // [-] the oldest frame is dropped when the worker falls behind
+  double           log_period;        // [s] of the divergence summary
+  double           max_stamp_offset;  // [s] between the stamp of the active output and the iteration it is paired with
+  std::vector<int> cpus;              // the worker is pinned to these cores, empty = any core
+} ShadowModeParams_t;
+
+//}
+
+/* ShadowFrame_t //{ */
+
+/**
+ * @brief the snapshot of one iteration of the control manager
+ */
+typedef struct
+{
+  mrs_msgs::UavState::ConstPtr        uav_state;
+  mrs_msgs::PositionCommand::ConstPtr control_reference;
+  mrs_msgs::AttitudeCommand::ConstPtr active_output;  // of the active controller for this state and reference
+  ros::WallTime                       received;       // when the active output came
+  bool                                restart;        // the first frame after start() or resume()
+} ShadowFrame_t;
+
+//}
+
+/* class ShadowMode //{ */
+
+/**
+ * @brief evaluates an inactive controller on the live state on a low-priority worker thread
+ *
+ * The control manager calls update() of every loaded controller in each iteration, the inactive one
+ * passes its inputs to addInputs() and returns. The output of the active controller, which the control
+ * manager publishes, is paired with the inputs of the iteration closest to its stamp, within
+ * max_stamp_offset, so the frame holds the inputs the active controller used. Outputs without such an
+ * iteration are dropped. The update of the shadow runs on its own thread with SCHED_IDLE, so it takes the
+ * cores the control loop leaves idle. The queue is bounded, the oldest frame is dropped when the worker
+ * falls behind.
+ *
+ * The update function has to work on its own copy of the controller, never on the instance the control
+ * manager updates. On a restarted frame, the copy takes over the state of the active controller as in
+ * activate(), from frame.active_output. pause() never waits for the worker, the evaluation which is
+ * running meanwhile is abandoned and its output is not compared. The divergence of the outputs (the
+ * attitude, the thrust and the attitude rate) is summarized in the log every log_period.
+ */
+class ShadowMode {
+
+public:
+  /**
+   * @brief the update of the controller, called from the worker thread
+   *
+   * @return the output of the controller, nullptr when it has nothing to compare
+   */
+  typedef std::function<mrs_msgs::AttitudeCommand::ConstPtr(const ShadowFrame_t& frame)> update_t;
+
+  ShadowMode(const std::string& name, const ShadowModeParams_t& params, const update_t& update);
+  ~ShadowMode();
+
+  ShadowMode(const ShadowMode&) = delete;
+  ShadowMode& operator=(const ShadowMode&) = delete;
+
+  /**
+   * @brief subscribes the active output in the namespace of the controller and starts the worker, paused
+   */
+  void start(ros::NodeHandle& nh);
+
+  /**
+   * @brief remembers the inputs of the current iteration of the control manager, called in update() of the inactive controller
+   */
+  void addInputs(const mrs_msgs::UavState::ConstPtr& uav_state, const mrs_msgs::PositionCommand::ConstPtr& control_reference);
+
+  /**
+   * @brief drops the queued frames and abandons the running update without waiting for it, called in activate()
+   */
+  void pause(void);
+
+  /**
+   * @brief evaluates the next frames again, starting with a restarted one, called in deactivate()
+   */
+  void resume(void);
+
+private:
+  std::string        name_;
+  ShadowModeParams_t params_;
+  update_t           update_;
+
+  ros::Subscriber subscriber_active_output_;
+
+  void callbackActiveOutput(const mrs_msgs::AttitudeCommand::ConstPtr& msg);
+
+  // | ------------- the inputs of the last iterations ------------- |
+
+  typedef struct
+  {
+    ros::Time                           time;  // of the call of update()
+    mrs_msgs::UavState::ConstPtr        uav_state;
+    mrs_msgs::PositionCommand::ConstPtr control_reference;
+  } Inputs_t;
+
+  std::mutex           mutex_inputs_;
+  std::deque<Inputs_t> inputs_;
+
+  std::atomic<uint64_t> n_unmatched_;  // the active outputs without the inputs
+
+  // | ------------------------ queue ------------------------- |
+
+  std::mutex                mutex_queue_;
+  std::condition_variable   queue_cv_;
+  std::deque<ShadowFrame_t> queue_;
+  bool                      paused_     = true;
+  bool                      restart_    = true;
+  bool                      stop_       = false;
+  uint64_t                  generation_ = 0;  // bumped by pause(), the output of an older frame is abandoned
+
+  std::atomic<uint64_t> n_dropped_;
+
+  std::thread worker_thread_;
+
+  void workerThread(void);
+
+  // | ----------------- divergence, the worker ---------------- |
+
+  typedef struct
+  {
+    uint64_t n_frames;
+    uint64_t n_abandoned;
+    uint64_t n_outputs;
+    uint64_t n_rate_outputs;
+    double   attitude_sum;  // [rad]
+    double   attitude_max;
+    double   thrust_sum;  // [-]
+    double   thrust_max;
+    double   rate_sum;  // [rad/s]
+    double   rate_max;
+    double   lag_sum;  // [s] from the active output to the end of the shadow update
+    double   lag_max;
+  } Divergence_t;
+
+  Divergence_t  divergence_;
+  uint64_t      last_n_dropped_   = 0;
+  uint64_t      last_n_unmatched_ = 0;
+  ros::WallTime last_log_time_;
+
+  void addDivergence(const ShadowFrame_t& frame, const mrs_msgs::AttitudeCommand::ConstPtr& output);
+  void logDivergence(void);
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif  // MRS_UAV_CONTROLLERS_COMMON_SHADOW_MODE_H
@@ -0,0 +1,116 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_STATE_PREDICTOR_H
+#define MRS_UAV_CONTROLLERS_COMMON_STATE_PREDICTOR_H
+
+#include <ros/ros.h>
+
+#include <mrs_msgs/UavState.h>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <mutex>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* StatePredictorParams_t //{ */
+
+typedef struct
+{
+  bool   enabled;
+  bool   measure_delay;    // the age of the odometry is measured from its stamp, the fixed delay is used otherwise
+  double fixed_delay;      // [s]
+  double actuation_delay;  // [s] added on top, e.g., the attitude loop of the autopilot
+  double max_delay;        // [s] the prediction horizon is saturated to this
+  int    history_length;   // how many past commands are kept
+} StatePredictorParams_t;
+
+//}
+
+/* PredictedState_t //{ */
+
+/**
+ * @brief the fields of the UAV state which are propagated, in the frame of the odometry
+ *
+ * The header and the rest of the message stay in the measured UavState, which is not copied.
+ */
+typedef struct
+{
+  Eigen::Vector3d    position;
+  Eigen::Vector3d    velocity;
+  Eigen::Vector3d    acceleration;
+  Eigen::Quaterniond orientation;
+  Eigen::Vector3d    attitude_rate;  // body frame
+} PredictedState_t;
+
+//}
+
+/* class StatePredictor //{ */
+
+/**
+ * @brief forward prediction of the UAV state over the odometry and actuation latency
+ *
+ * The controllers store every command they produce. The state is then propagated from the stamp of
+ * the odometry to the present (plus the actuation delay) using the commands which were active meanwhile:
+ * the position and the velocity by the commanded acceleration, the orientation by the commanded attitude rate.
+ */
+class StatePredictor {
+
+public:
+  StatePredictor(const StatePredictorParams_t& params);
+
+  /**
+   * @brief stores a command
+   *
+   * @param stamp when the command was produced
+   * @param acceleration the expected acceleration in the world frame of the odometry
+   * @param attitude_rate the commanded attitude rate in the body frame
+   */
+  void addCommand(const ros::Time& stamp, const Eigen::Vector3d& acceleration, const Eigen::Vector3d& attitude_rate);
+
+  /**
+   * @brief forgets the stored commands, e.g., when the odometry frame changes
+   */
+  void reset(void);
+
+  /**
+   * @brief predicts the state at the present time from the state measured at its stamp
+   *
+   * @return the measured state when the prediction is disabled or there is nothing to predict with
+   */
+  PredictedState_t predict(const mrs_msgs::UavState& uav_state, const ros::Time& now);
+
+  // the length of the last prediction [s]
+  double getLastDelay(void);
+
+private:
+  StatePredictorParams_t params_;
+
+  typedef struct
+  {
+    ros::Time       stamp;
+    Eigen::Vector3d acceleration;
+    Eigen::Vector3d attitude_rate;
+  } CommandRecord_t;
+
+  // ring buffer of the commands
+  std::vector<CommandRecord_t> history_;
+  int                          head_ = 0;  // where the next command is written
+  int                          size_ = 0;
+  std::mutex                   mutex_history_;
+
+  double last_delay_ = 0;
+
+  const CommandRecord_t& getRecord(const int i) const;  // i-th oldest record
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef MRS_UAV_CONTROLLERS_COMMON_TRACING_H
+#define MRS_UAV_CONTROLLERS_COMMON_TRACING_H
+
+/**
+ * USDT (static user-space) tracepoints of the controllers, provider "mrs_uav_controllers"
+ *
+ * The probes compile to a single nop and a note in the ELF, they cost nothing until perf or bpftrace
+ * attaches to them, e.g.:
+ *
+ *   bpftrace -e 'usdt:/path/libSe3Controller.so:mrs_uav_controllers:update_entry { @t[tid] = nsecs; }
+ *                usdt:/path/libSe3Controller.so:mrs_uav_controllers:update_exit /@t[tid]/ { @us = hist((nsecs - @t[tid]) / 1000); }'
+ *
+ * The first argument of every probe is the name of the controller (char*). The probes are:
+ *
+ *   update_entry(name), update_exit(name), also for the copy of the shadow mode on the thread of its worker
+ *   mpc_solve_entry(name), mpc_solve_exit(name, iterations, success, fast_path), the axes are solved in the order x, y, z
+ *   transform_entry(name), transform_exit(name, success)
+ *   activate(name), deactivate(name), switch_odometry_source(name, frame)
+ *   attitude_loop(name, published), every IMU message of the IMU-rate attitude loop of the Se3Controller
+ *
+ * The probes are compiled out when <sys/sdt.h> (systemtap-sdt-dev) is not available or when
+ * MRS_UAV_CONTROLLERS_NO_USDT is defined (cmake -DUSDT_PROBES=OFF).
+ */
+
+#if !defined(MRS_UAV_CONTROLLERS_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define MRS_UAV_CONTROLLERS_USDT 1
+#endif
+#endif
+
+#ifdef MRS_UAV_CONTROLLERS_USDT
+
+#define CONTROLLER_TRACE1(probe, a1) DTRACE_PROBE1(mrs_uav_controllers, probe, a1)
+#define CONTROLLER_TRACE2(probe, a1, a2) DTRACE_PROBE2(mrs_uav_controllers, probe, a1, a2)
+#define CONTROLLER_TRACE4(probe, a1, a2, a3, a4) DTRACE_PROBE4(mrs_uav_controllers, probe, a1, a2, a3, a4)
+
+#else
+
+#define CONTROLLER_TRACE1(probe, a1) \
+  do {                               \
+  } while (0)
+#define CONTROLLER_TRACE2(probe, a1, a2) \
+  do {                                   \
+  } while (0)
+#define CONTROLLER_TRACE4(probe, a1, a2, a3, a4) \
+  do {                                           \
+  } while (0)
+
+#endif
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* class UpdateTrace //{ */
+
+/**
+ * @brief fires update_entry when constructed and update_exit when destroyed, covers all the returns of update()
+ */
+class UpdateTrace {
+
+public:
+  explicit UpdateTrace(const char* name) : name_(name) {
+    CONTROLLER_TRACE1(update_entry, name_);
+  }
+
+  ~UpdateTrace() {
+    CONTROLLER_TRACE1(update_exit, name_);
+  }
+
+  UpdateTrace(const UpdateTrace&) = delete;
+  UpdateTrace& operator=(const UpdateTrace&) = delete;
+
+private:
+  const char* name_;
+};
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,137 @@
+#ifndef MRS_UAV_CONTROLLERS_INDI_CONTROLLER_INDI_CORE_H
+#define MRS_UAV_CONTROLLERS_INDI_CONTROLLER_INDI_CORE_H
+
+#include <eigen3/Eigen/Eigen>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace indi_controller
+{
+
+/* IndiParams_t //{ */
+
+typedef struct
+{
+  double g;  // [m/s^2]
+
+  Eigen::Vector3d kp;  // [1/s^2] position gains
+  Eigen::Vector3d kv;  // [1/s] velocity gains
+  Eigen::Vector3d kq;  // [1/s] attitude gains
+
+  double filter_cutoff;  // [Hz] of the synchronous filters of the acceleration and of the force
+  double max_increment;  // [N] the force increment is saturated to this, 0 = no saturation
+  double max_tilt;       // [rad] the tilt of the force is saturated to this, 0 = no saturation
+} IndiParams_t;
+
+//}
+
+/* IndiState_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d position;      // [m] world frame
+  Eigen::Vector3d velocity;      // [m/s] world frame
+  Eigen::Vector3d acceleration;  // [m/s^2] world frame, measured, without the gravity
+  Eigen::Matrix3d R;             // the orientation of the UAV
+} IndiState_t;
+
+//}
+
+/* IndiReference_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d position;
+  Eigen::Vector3d velocity;
+  Eigen::Vector3d acceleration;
+
+  // 0/1 masks of the used parts of the reference
+  Eigen::Vector3d use_position;
+  Eigen::Vector3d use_velocity;
+  Eigen::Vector3d use_acceleration;
+
+  double          heading;
+  Eigen::Vector3d attitude_rate;  // the attitude rate feedforward in the body frame
+} IndiReference_t;
+
+//}
+
+/* IndiOutput_t //{ */
+
+typedef struct
+{
+  Eigen::Vector3d force;          // [N] the desired force in the world frame
+  Eigen::Matrix3d Rd;             // the desired orientation
+  Eigen::Vector3d attitude_rate;  // [rad/s] the desired attitude rate in the body frame
+  double          thrust_force;   // [N] the force projected to the current body z
+  bool            tilt_saturated;
+} IndiOutput_t;
+
+//}
+
+/* class IndiCore //{ */
+
+/**
+ * @brief incremental nonlinear dynamic inversion of the translational dynamics
+ *
+ * The force is not computed from the model, but as an increment over the force which is being applied:
+ * F = F_f + m * (a_d - a_f), where a_f is the measured acceleration and F_f the applied force, both passed
+ * through the same low-pass filter. The disturbances are therefore rejected as soon as they are
+ * measured, without waiting for the integrators. The update uses only fixed-size types and does not allocate.
+ */
+class IndiCore {
+
+public:
+  IndiCore(const IndiParams_t& params);
+
+  void                setParams(const IndiParams_t& params);
+  const IndiParams_t& getParams(void) const;
+
+  /**
+   * @brief initializes the filters
+   *
+   * @param mass the mass of the UAV [kg]
+   * @param thrust_force the thrust which is being applied [N]
+   * @param R the current orientation
+   */
+  void reset(const double mass, const double thrust_force, const Eigen::Matrix3d& R);
+
+  /**
+   * @brief the control update
+   *
+   * @param state the UAV state
+   * @param reference the control reference
+   * @param mass the mass of the UAV [kg]
+   * @param dt the time since the last update [s]
+   * @param output
+   *
+   * @return false when the result is not finite
+   */
+  bool update(const IndiState_t& state, const IndiReference_t& reference, const double mass, const double dt, IndiOutput_t& output);
+
+  /**
+   * @brief corrects the applied thrust when the output was changed after the update, e.g., by saturation
+   *
+   * @param thrust_force [N]
+   */
+  void setAppliedThrustForce(const double thrust_force);
+
+private:
+  IndiParams_t params_;
+
+  Eigen::Vector3d acceleration_filtered_;  // including the gravity
+  Eigen::Vector3d force_filtered_;
+  double          last_thrust_force_;
+  bool            first_update_;
+};
+
+//}
+
+}  // namespace indi_controller
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_ADMM_KERNELS_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_ADMM_KERNELS_H
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/**
+ * The dense kernels of the ADMM iteration, on raw column-major data. They are compiled for several
+ * instruction sets and the variant is chosen when the library is loaded (common/cpu_dispatch.h).
+ * The arrays must not overlap.
+ */
+
+/**
+ * @brief y = A * x, A is column-major, rows x cols
+ */
+void admmMatVec(const double* A, const int rows, const int cols, const double* x, double* y);
+
+/**
+ * @brief the relaxation, the projection and the dual update of one ADMM iteration, over the m constraints
+ *
+ *   z_relaxed = alpha * z_tilde + (1 - alpha) * z
+ *   z         = min(max(z_relaxed + y / rho, l), u)
+ *   y         = y + rho * (z_relaxed - z)
+ *   rhs       = rho * z - y  (the constraint part of the right-hand side of the next iteration)
+ */
+void admmUpdate(const int m, const double alpha, const double rho, const double* z_tilde, const double* l, const double* u, double* z, double* y,
+                double* rhs);
+
+/**
+ * @brief the instruction set of the kernels selected on this machine
+ */
+const char* getAdmmKernelIsa(void);
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,86 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_ADMM_SOLVER_BACKEND_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_ADMM_SOLVER_BACKEND_H
+
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* class AdmmSolverBackend //{ */
+
+/**
+ * @brief dense, condensed QP solved by the ADMM (the OSQP iteration) built from the sources of this package
+ *
+ *   min  0.5 U' P U + q' U
+ *   s.t. l <= A U <= u
+ *
+ * The rows of A constrain the predicted velocity, the predicted acceleration, the input and the input rate.
+ * The matrix A depends only on the model, P depends on the Q and S weights. The factorization of the
+ * KKT matrix is therefore cached for the few weight combinations the controller switches between.
+ */
+class AdmmSolverBackend : public MpcSolverBackend {
+
+public:
+  AdmmSolverBackend(const MpcModel& model, const MpcSolverParams_t& params);
+
+  std::string getName(void) const;
+
+  bool solve(const MpcProblem_t& problem, MpcSolution_t& solution);
+
+  void prepare(const Eigen::Vector3d& Q, const Eigen::Vector3d& S);
+
+private:
+  MpcModel          model_;
+  MpcSolverParams_t params_;
+
+  int n_;  // number of the decision variables (inputs)
+  int m_;  // number of the constraints
+
+  Eigen::MatrixXd A_;    // constraints
+  Eigen::MatrixXd At_;   // A', stored for the column-major kernel (admm_kernels.h)
+  Eigen::MatrixXd AtA_;  // A' * A
+
+  typedef struct
+  {
+    Eigen::Vector3d            Q;
+    Eigen::Vector3d            S;
+    double                     rho;
+    Eigen::MatrixXd            P;
+    Eigen::LLT<Eigen::MatrixXd> kkt;
+  } Factorization_t;
+
+  std::vector<Factorization_t> factorizations_;
+  int                          next_factorization_ = 0;
+
+  const Factorization_t& getFactorization(const Eigen::Vector3d& Q, const Eigen::Vector3d& S);
+
+  // preallocated workspace
+  Eigen::VectorXd weights_;  // diagonal of the state penalization over the horizon
+  Eigen::VectorXd error_;    // predicted free-response error
+  Eigen::VectorXd q_;
+  Eigen::VectorXd l_;
+  Eigen::VectorXd u_;
+  Eigen::VectorXd x_;
+  Eigen::VectorXd x_tilde_;
+  Eigen::VectorXd z_;
+  Eigen::VectorXd z_tilde_;
+  Eigen::VectorXd y_;
+  Eigen::VectorXd rhs_;
+  Eigen::VectorXd tmp_m_;
+  Eigen::VectorXd rhs_m_;  // rho * z - y
+  Eigen::VectorXd tmp_n_;
+  Eigen::VectorXd free_response_;
+
+  bool warm_start_valid_ = false;
+};
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_DISTURBANCE_OBSERVER_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_DISTURBANCE_OBSERVER_H
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* class DisturbanceObserver //{ */
+
+/**
+ * @brief Luenberger observer of a constant acceleration disturbance of a single axis
+ *
+ *   dv/dt = a_cmd + d
+ *   dd/dt = 0
+ *
+ * The velocity is measured, the poles of the error dynamics are placed by the bandwidth and the damping:
+ * s^2 + 2 * damping * bandwidth * s + bandwidth^2.
+ */
+class DisturbanceObserver {
+
+public:
+  DisturbanceObserver(const double bandwidth, const double damping, const double max_disturbance);
+
+  void reset(const double velocity, const double disturbance);
+
+  /**
+   * @brief one step of the observer
+   *
+   * @param velocity the measured velocity
+   * @param acceleration_cmd the acceleration commanded during the last step
+   * @param dt the duration of the last step
+   */
+  void update(const double velocity, const double acceleration_cmd, const double dt);
+
+  double getDisturbance(void) const;
+
+  // the disturbance is kept, e.g., after a change of the frame of the velocity
+  void setDisturbance(const double disturbance);
+
+  // true when the last update had to saturate the disturbance
+  bool isSaturated(void) const;
+
+private:
+  double l_v_;  // [1/s]
+  double l_d_;  // [1/s^2]
+
+  double max_disturbance_;
+
+  double velocity_    = 0;
+  double disturbance_ = 0;
+  bool   saturated_   = false;
+};
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_LEGACY_SOLVER_BACKEND_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_LEGACY_SOLVER_BACKEND_H
+
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+
+#include <mpc_controller_solver.h>
+
+#include <mutex>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* class LegacySolverBackend //{ */
+
+/**
+ * @brief adapter for the prebuilt mrs_mpc_solvers::mpc_controller::Solver
+ *
+ * The library keeps a global workspace shared by all its instances,
+ * therefore the whole setter sequence has to be repeated for every solve.
+ * The library is compiled for a fixed horizon and supports only the two-step time schedule.
+ */
+class LegacySolverBackend : public MpcSolverBackend {
+
+public:
+  LegacySolverBackend(const MpcModel& model, const MpcSolverParams_t& params);
+
+  std::string getName(void) const;
+
+  bool solve(const MpcProblem_t& problem, MpcSolution_t& solution);
+
+  // the whole setter sequence is repeated for every solve
+  bool takesWeightsFromProblem(void) const;
+
+  static bool supportsModel(const MpcModel& model);
+
+private:
+  // the library is not safe to construct while another instance is solving
+  static std::mutex mutex_library_;
+
+  double dt1_;
+  double dt2_;
+
+  std::unique_ptr<mrs_mpc_solvers::mpc_controller::Solver> solver_;
+
+  // preallocated buffers for the setters of the library
+  std::vector<double> Q_;
+  std::vector<double> S_;
+  Eigen::MatrixXd     reference_;
+  Eigen::MatrixXd     initial_state_;
+  Eigen::VectorXd     delta_;
+};
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
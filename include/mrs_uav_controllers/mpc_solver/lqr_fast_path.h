@@ -0,0 +1,68 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_LQR_FAST_PATH_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_LQR_FAST_PATH_H
+
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* class LqrFastPath //{ */
+
+/**
+ * @brief unconstrained optimum of the MPC problem by the finite-horizon Riccati recursion
+ *
+ * The time-varying gains depend only on the model and the Q and S weights, they are precomputed
+ * by prepare(). Every solve then only runs the backward pass of the reference-dependent term
+ * and the forward rollout of the closed loop, which is checked against the box constraints.
+ */
+class LqrFastPath {
+
+public:
+  LqrFastPath(const MpcModel& model);
+
+  /**
+   * @brief precomputes the gains for the given weights, should be called for all the weights the controller uses
+   */
+  void prepare(const Eigen::Vector3d& Q, const Eigen::Vector3d& S);
+
+  /**
+   * @brief computes the unconstrained optimum and checks the constraints along the predicted trajectory
+   *
+   * @return true if the unconstrained optimum respects all the constraints, the solution is filled only then
+   */
+  bool solve(const MpcProblem_t& problem, MpcSolution_t& solution);
+
+private:
+  MpcModel model_;
+
+  int n_;
+
+  typedef struct
+  {
+    Eigen::Vector3d                 Q;
+    Eigen::Vector3d                 S;
+    std::vector<Eigen::RowVector3d> K;    // state feedback gains
+    std::vector<Eigen::Matrix3d>    Acl;  // closed-loop state matrices, A - B * K
+    std::vector<double>             g;    // inverse of the input hessian
+  } Gains_t;
+
+  std::vector<Gains_t> gains_;
+  int                  next_gains_ = 0;
+
+  const Gains_t* findGains(const Eigen::Vector3d& Q, const Eigen::Vector3d& S) const;
+
+  std::vector<Eigen::Vector3d> p_;  // preallocated linear terms of the value function
+
+  Eigen::VectorXd reference_;  // preallocated reference shifted by the effect of the disturbance
+};
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_MPC_MODEL_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_MPC_MODEL_H
+
+#include <eigen3/Eigen/Eigen>
+
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/**
+ * @brief Linear model of a single axis of the MPC, shared by all solver backends.
+ *
+ * The state is [position, velocity, acceleration], the input is the desired acceleration.
+ * The acceleration follows a first-order lag: a_{k+1} = p1 * a_k + p2 * u_k.
+ * Every step of the horizon can have its own length, see the create*Schedule() functions.
+ */
+class MpcModel {
+
+public:
+  /**
+   * @brief the original schedule: the first step is dt1 long, all the others are dt2 long
+   */
+  MpcModel(const int horizon_length, const double dt1, const double dt2, const double p1, const double p2);
+
+  /**
+   * @brief arbitrary schedule, the horizon length is given by the number of the steps
+   */
+  MpcModel(const std::vector<double>& dts, const double p1, const double p2);
+
+  int    horizonLength(void) const;
+  double dt(const int k) const;
+  double dt1(void) const;
+  double dt2(void) const;
+  double p1(void) const;
+  double p2(void) const;
+
+  // the time the horizon spans [s]
+  double horizonTime(void) const;
+
+  // true if all the steps after the first one have the same length
+  bool isTwoStep(void) const;
+
+  const Eigen::Matrix3d& A(const int k) const;
+  const Eigen::Vector3d& B(const int k) const;
+
+  // the effect of a unit acceleration disturbance during the step k
+  const Eigen::Vector3d& E(const int k) const;
+
+  // stacked prediction X = Phi * x0 + Gamma * U + Delta * d, where X = [x_1; ...; x_N], U = [u_0; ...; u_{N-1}]
+  // and d is a constant acceleration disturbance
+  const Eigen::MatrixXd& Phi(void) const;
+  const Eigen::MatrixXd& Gamma(void) const;
+  const Eigen::VectorXd& Delta(void) const;
+
+private:
+  int    horizon_length_;
+  double p1_, p2_;
+
+  std::vector<double>          dts_;
+  std::vector<Eigen::Matrix3d> A_;
+  std::vector<Eigen::Vector3d> B_;
+  std::vector<Eigen::Vector3d> E_;
+
+  Eigen::MatrixXd Phi_;
+  Eigen::MatrixXd Gamma_;
+  Eigen::VectorXd Delta_;
+
+  void compile(void);
+};
+
+/**
+ * @brief dt1 for the first step, dt2 for all the others
+ */
+std::vector<double> createTwoStepSchedule(const int horizon_length, const double dt1, const double dt2);
+
+/**
+ * @brief dt1 for the first step, then the steps grow geometrically from dt2 by the ratio, saturated at max_dt
+ */
+std::vector<double> createGeometricSchedule(const int horizon_length, const double dt1, const double dt2, const double ratio, const double max_dt);
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
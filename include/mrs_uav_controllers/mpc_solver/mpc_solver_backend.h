@@ -0,0 +1,141 @@
+#ifndef MRS_UAV_CONTROLLERS_MPC_SOLVER_MPC_SOLVER_BACKEND_H
+#define MRS_UAV_CONTROLLERS_MPC_SOLVER_MPC_SOLVER_BACKEND_H
+
+#include <mrs_uav_controllers/mpc_solver/mpc_model.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* MpcProblem_t //{ */
+
+/**
+ * @brief All the data of a single solve of one MPC axis.
+ *
+ * The controller keeps one instance per axis and fills it in place every tick,
+ * the backends only read it.
+ */
+typedef struct
+{
+  Eigen::Vector3d initial_state;  // [position, velocity, acceleration]
+  Eigen::VectorXd reference;      // stacked [position, velocity, acceleration] for the states x_1 ... x_N
+
+  Eigen::Vector3d Q;  // state error penalization
+  Eigen::Vector3d S;  // last state error penalization
+
+  double max_speed;
+  double max_acceleration;
+  double max_u;
+  double max_du;
+
+  double last_input;  // the input applied during the last control step
+
+  double disturbance;  // constant acceleration disturbance acting on the velocity over the whole horizon
+
+} MpcProblem_t;
+
+//}
+
+/* MpcSolution_t //{ */
+
+typedef struct
+{
+  double first_input = 0;
+  int    iterations  = 0;
+  bool   fast_path   = false;  // solved by the LqrFastPath, the backend did not run
+} MpcSolution_t;
+
+//}
+
+/* MpcSolverParams_t //{ */
+
+typedef struct
+{
+  std::string     name;
+  bool            verbose;
+  int             max_iterations;
+  Eigen::Vector3d Q;  // the initial state error penalization
+  Eigen::Vector3d S;  // the initial last state error penalization
+} MpcSolverParams_t;
+
+//}
+
+/* class MpcSolverBackend //{ */
+
+class MpcSolverBackend {
+
+public:
+  virtual ~MpcSolverBackend(){};
+
+  virtual std::string getName(void) const = 0;
+
+  /**
+   * @brief solves the problem
+   *
+   * @param problem the problem to solve
+   * @param solution the first control input and the solver stats
+   *
+   * @return true if the solution is usable
+   */
+  virtual bool solve(const MpcProblem_t& problem, MpcSolution_t& solution) = 0;
+
+  /**
+   * @brief precomputes everything that depends on the Q and S weights, so that a later solve() with them does not have to
+   *
+   * Can be expensive, it is meant to be called on a backend which is not being used for solving yet.
+   */
+  virtual void prepare([[maybe_unused]] const Eigen::Vector3d& Q, [[maybe_unused]] const Eigen::Vector3d& S){};
+
+  /**
+   * @brief whether solve() takes the Q and S weights only from the problem, then the backend can be kept when they change
+   */
+  virtual bool takesWeightsFromProblem(void) const {
+    return false;
+  };
+};
+
+//}
+
+/**
+ * @brief prepares an empty problem for the given model
+ */
+MpcProblem_t createMpcProblem(const MpcModel& model);
+
+/**
+ * @brief returns the backends that have been compiled in
+ */
+std::vector<std::string> getAvailableMpcSolverBackends(void);
+
+/**
+ * @brief checks whether the backend can solve problems of the given model (its horizon length and time-step schedule)
+ */
+bool isMpcSolverBackendCompatible(const std::string& type, const MpcModel& model);
+
+/**
+ * @brief creates a solver backend by its name
+ *
+ * @return nullptr when the backend is not available or it is not compatible with the model
+ */
+std::unique_ptr<MpcSolverBackend> createMpcSolverBackend(const std::string& type, const MpcModel& model, const MpcSolverParams_t& params);
+
+/**
+ * @brief solves a representative problem with every available backend and returns the name of the fastest one
+ *
+ * @param n_solves how many times each backend solves the problem
+ * @param timings filled with the mean solve time [s] of each backend, in the order of getAvailableMpcSolverBackends(),
+ *                incompatible backends get infinity
+ */
+std::string benchmarkMpcSolverBackends(const MpcModel& model, const MpcSolverParams_t& params, const MpcProblem_t& problem, const int n_solves,
+                                       std::vector<double>& timings);
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
+
+#endif
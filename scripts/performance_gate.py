@@ -0,0 +1,183 @@
+#!/usr/bin/env python3
+
+# Runs the benchmarks and compares the median and p99 times and the allocations per update against
+# the baseline of this architecture, benchmark/baselines/<arch>/<benchmark>.json.
+#
+#   performance_gate.py --arch x86_64 --baselines benchmark/baselines --output /tmp/gate <benchmark executables>
+#
+# --update overwrites the baselines with the measured values instead of comparing. A baseline may hold
+# only some of the metrics, the missing ones are reported and not gated.
+# --speedup prints the speedup against the baselines instead of gating, e.g., of a PGO build against
+# the baselines of the default build written to another directory with --update.
+
+import argparse
+import json
+import os
+import platform
+import subprocess
+import sys
+
+# | -------------------------- parsing ------------------------- |
+
+# the measurements, keyed by the names along the path, e.g. "mpc_solver/two_step N=26/admm"
+def flatten(node, path, results):
+
+    if isinstance(node, dict):
+
+        if "name" in node:
+            path = path + [node["name"]]
+
+        if "median_time" in node:
+            results["/".join(path)] = {metric: node[metric] for metric in ("median_time", "p99_time", "allocations")}
+            return
+
+        for key, value in node.items():
+            if isinstance(value, dict):
+                flatten(value, path + [key], results)
+            elif isinstance(value, list):
+                flatten(value, path, results)
+
+    elif isinstance(node, list):
+
+        for value in node:
+            flatten(value, path, results)
+
+def runBenchmark(executable, output, repeat):
+
+    name = os.path.basename(executable)
+
+    results = {}
+
+    for i in range(repeat):
+
+        json_file = os.path.join(output, "{}_{}.json".format(name, i))
+
+        subprocess.run([executable, "--json", json_file], check=True, stdout=subprocess.DEVNULL)
+
+        with open(json_file) as f:
+            data = json.load(f)
+
+        run = {}
+        flatten(data, [data["benchmark"]], run)
+
+        # the best of the repetitions, the noise of the machine only ever adds time
+        for key, value in run.items():
+            if key not in results:
+                results[key] = value
+            else:
+                results[key] = {metric: min(results[key][metric], value[metric]) for metric in value}
+
+    return data["benchmark"], results
+
+# | ------------------------ comparison ------------------------ |
+
+def compare(name, results, baseline, args):
+
+    failed = False
+
+    for key, measured in sorted(results.items()):
+
+        if key not in baseline:
+            print("{:<40} no baseline".format(key))
+            continue
+
+        reference = baseline[key]
+
+        # the absolute tolerance is only for the timer jitter, it must stay well below the relative
+        # thresholds of the fastest update (the INDI one takes about 170 ns on x86_64)
+        thresholds = {
+            "median_time": (args.median_threshold, args.time_tolerance),
+            "p99_time": (args.p99_threshold, args.time_tolerance),
+            "allocations": (0.0, args.allocation_threshold),
+        }
+
+        for metric, (relative, absolute) in thresholds.items():
+
+            # a baseline may hold only some metrics, e.g., the allocations, which do not depend on the machine
+            if metric not in reference:
+                print("{:<40} {:<12} {:>12.6g} no baseline".format(key, metric, measured[metric]))
+                continue
+
+            limit = max(reference[metric] * (1.0 + relative), reference[metric] + absolute)
+
+            status = "ok"
+
+            if measured[metric] > limit:
+                status = "REGRESSION"
+                failed = True
+
+            print("{:<40} {:<12} {:>12.6g} baseline {:>12.6g} limit {:>12.6g} {}".format(key, metric, measured[metric], reference[metric], limit, status))
+
+    return not failed
+
+def speedup(name, results, baseline):
+
+    for key, measured in sorted(results.items()):
+
+        if key not in baseline or "median_time" not in baseline[key]:
+            continue
+
+        print("{:<40} median {:6.3f}x  p99 {:6.3f}x".format(key, baseline[key]["median_time"] / measured["median_time"], baseline[key]["p99_time"] / measured["p99_time"]))
+
+# | --------------------------- main --------------------------- |
+
+def main():
+
+    parser = argparse.ArgumentParser(description="the performance regression gate of the controller benchmarks")
+    parser.add_argument("benchmarks", nargs="+", help="the benchmark executables")
+    parser.add_argument("--arch", default=platform.machine(), help="the architecture of the baselines, e.g., x86_64, aarch64")
+    parser.add_argument("--baselines", required=True, help="the directory with the baselines of all architectures")
+    parser.add_argument("--output", required=True, help="the directory for the json of the benchmarks")
+    parser.add_argument("--repeat", type=int, default=3, help="the number of runs of each benchmark, the best one is compared")
+    parser.add_argument("--median-threshold", type=float, default=0.15, help="the allowed relative increase of the median time")
+    parser.add_argument("--p99-threshold", type=float, default=0.30, help="the allowed relative increase of the p99 time")
+    parser.add_argument("--time-tolerance", type=float, default=2e-8, help="[s] the allowed absolute increase of the times, the timer jitter")
+    parser.add_argument("--allocation-threshold", type=float, default=0.0, help="the allowed increase of the allocations per update")
+    parser.add_argument("--update", action="store_true", help="overwrite the baselines with the measured values")
+    parser.add_argument("--speedup", action="store_true", help="print the speedup against the baselines instead of gating")
+    args = parser.parse_args()
+
+    os.makedirs(args.output, exist_ok=True)
+
+    baseline_dir = os.path.join(args.baselines, args.arch)
+
+    success = True
+
+    for executable in args.benchmarks:
+
+        name, results = runBenchmark(executable, args.output, args.repeat)
+
+        baseline_file = os.path.join(baseline_dir, name + ".json")
+
+        if args.update:
+
+            os.makedirs(baseline_dir, exist_ok=True)
+
+            with open(baseline_file, "w") as f:
+                json.dump(results, f, indent=2, sort_keys=True)
+                f.write("\n")
+
+            print("{}: the baseline was written to {}".format(name, baseline_file))
+            continue
+
+        if not os.path.exists(baseline_file):
+            print("{}: there is no baseline for {}, create it with --update on the reference machine".format(name, args.arch))
+            success = False
+            continue
+
+        with open(baseline_file) as f:
+            baseline = json.load(f)
+
+        if args.speedup:
+            speedup(name, results, baseline)
+        else:
+            success &= compare(name, results, baseline, args)
+
+    if not success:
+        print("the performance gate failed")
+        return 1
+
+    return 0
+
+if __name__ == "__main__":
+    sys.exit(main())
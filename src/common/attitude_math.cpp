@@ -0,0 +1,99 @@
+#include <mrs_uav_controllers/common/attitude_math.h>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* getHeading() //{ */
+
+std::optional<double> getHeading(const Eigen::Matrix3d& R) noexcept {
+
+  const double x = R(0, 0);
+  const double y = R(1, 0);
+
+  if (x * x + y * y < 1e-12) {
+    return std::nullopt;
+  }
+
+  return atan2(y, x);
+}
+
+//}
+
+/* getHeadingRate() //{ */
+
+std::optional<double> getHeadingRate(const Eigen::Matrix3d& R, const Eigen::Vector3d& attitude_rate) noexcept {
+
+  // the heading is atan2(R(1, 0), R(0, 0)), its derivative with dR/dt = R * [w]x
+  const double x = R(0, 0);
+  const double y = R(1, 0);
+
+  const double denominator = x * x + y * y;
+
+  if (denominator < 1e-6) {
+    return std::nullopt;
+  }
+
+  // the first column of R * [w]x = R * (w x e_1)
+  const Eigen::Vector3d x_dot = R * Eigen::Vector3d(0, attitude_rate[2], -attitude_rate[1]);
+
+  return (x * x_dot[1] - y * x_dot[0]) / denominator;
+}
+
+//}
+
+/* getYawRateIntrinsic() //{ */
+
+std::optional<double> getYawRateIntrinsic(const Eigen::Matrix3d& R, const double heading_rate) noexcept {
+
+  // the heading rate is linear in the yaw rate
+  std::optional<double> unit_heading_rate = getHeadingRate(R, Eigen::Vector3d(0, 0, 1));
+
+  if (!unit_heading_rate || fabs(unit_heading_rate.value()) < 1e-3) {
+
+    // no yaw rate is needed when no heading rate is wanted
+    if (heading_rate == 0) {
+      return 0.0;
+    }
+
+    return std::nullopt;
+  }
+
+  return heading_rate / unit_heading_rate.value();
+}
+
+//}
+
+/* setHeading() //{ */
+
+std::optional<Eigen::Matrix3d> setHeading(const Eigen::Matrix3d& R, const double heading) noexcept {
+
+  const Eigen::Vector3d zb = R.col(2);
+
+  if (fabs(zb[2]) < 1e-3) {
+    return std::nullopt;
+  }
+
+  // the heading vector moved along the world z into the plane orthogonal to the body z
+  Eigen::Vector3d xb(cos(heading), sin(heading), 0);
+  xb[2] = -(zb[0] * xb[0] + zb[1] * xb[1]) / zb[2];
+  xb.normalize();
+
+  Eigen::Matrix3d R_new;
+
+  R_new.col(0) = xb;
+  R_new.col(1) = zb.cross(xb);
+  R_new.col(2) = zb;
+
+  return R_new;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
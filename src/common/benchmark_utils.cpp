@@ -0,0 +1,173 @@
+#include <mrs_uav_controllers/common/benchmark_utils.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifndef MRS_UAV_CONTROLLERS_BUILD
+#define MRS_UAV_CONTROLLERS_BUILD "unknown"
+#endif
+
+// | ------------------ the allocation counting ----------------- |
+
+namespace
+{
+
+std::atomic<uint64_t> allocation_count(0);
+
+}  // namespace
+
+#ifdef __GLIBC__
+
+// Eigen allocates through malloc() directly, so the allocator is wrapped instead of operator new
+extern "C" {
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+
+void* malloc(size_t size) {
+
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size) {
+
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+
+  return __libc_realloc(ptr, size);
+}
+}
+
+#endif
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* getAllocationCount() //{ */
+
+uint64_t getAllocationCount(void) {
+
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+//}
+
+/* samplePercentile() //{ */
+
+double samplePercentile(std::vector<double> samples, const double p) {
+
+  if (samples.empty()) {
+    return 0;
+  }
+
+  size_t rank = size_t(std::ceil(std::clamp(p, 0.0, 1.0) * double(samples.size())));
+
+  rank = std::clamp(rank, size_t(1), samples.size());
+
+  std::nth_element(samples.begin(), samples.begin() + (rank - 1), samples.end());
+
+  return samples[rank - 1];
+}
+
+//}
+
+/* readTimestamp() //{ */
+
+uint64_t readTimestamp(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+  // the fences keep the timed code between the two reads
+  _mm_lfence();
+  uint64_t tsc = __rdtsc();
+  _mm_lfence();
+
+  return tsc;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+
+  return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+#endif
+}
+
+//}
+
+/* getTimestampPeriod() //{ */
+
+double getTimestampPeriod(void) {
+
+#if defined(__x86_64__) || defined(__i386__)
+  static const double period = [] {
+    auto     start     = std::chrono::steady_clock::now();
+    uint64_t tsc_start = readTimestamp();
+
+    while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(50)) {
+    }
+
+    uint64_t tsc_end = readTimestamp();
+    double   elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return elapsed / double(std::max(tsc_end - tsc_start, uint64_t(1)));
+  }();
+
+  return period;
+#else
+  return 1e-9;
+#endif
+}
+
+//}
+
+/* getTimestampOverhead() //{ */
+
+uint64_t getTimestampOverhead(void) {
+
+  uint64_t overhead = std::numeric_limits<uint64_t>::max();
+
+  for (int i = 0; i < 1000; i++) {
+
+    uint64_t t0 = readTimestamp();
+    uint64_t t1 = readTimestamp();
+
+    overhead = std::min(overhead, t1 - t0);
+  }
+
+  return overhead;
+}
+
+//}
+
+/* getBuildDescription() //{ */
+
+const char* getBuildDescription(void) {
+
+  return MRS_UAV_CONTROLLERS_BUILD;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
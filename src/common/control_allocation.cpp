@@ -0,0 +1,157 @@
+#include <mrs_uav_controllers/common/control_allocation.h>
+
+#include <algorithm>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* ControlAllocation() //{ */
+
+ControlAllocation::ControlAllocation(const std::vector<Motor_t>& motors, const double torque_coefficient,
+                                     const mrs_lib::quadratic_thrust_model::MotorParams_t& motor_params)
+    : n_motors_(std::min(int(motors.size()), CONTROL_ALLOCATION_MAX_MOTORS)), fully_actuated_(false), motor_params_(motor_params) {
+
+  // the wrench produced by the motor forces
+  Eigen::MatrixXd allocation = Eigen::MatrixXd::Zero(4, n_motors_);
+
+  for (int i = 0; i < n_motors_; i++) {
+    allocation(0, i) = 1.0;
+    allocation(1, i) = motors[i].y;
+    allocation(2, i) = -motors[i].x;
+    allocation(3, i) = motors[i].direction * torque_coefficient;
+  }
+
+  auto decomposition = allocation.completeOrthogonalDecomposition();
+
+  rank_  = int(decomposition.rank());
+  mixer_ = decomposition.pseudoInverse();
+}
+
+ControlAllocation::ControlAllocation(const std::vector<TiltedMotor_t>& motors, const double torque_coefficient,
+                                     const mrs_lib::quadratic_thrust_model::MotorParams_t& motor_params)
+    : n_motors_(std::min(int(motors.size()), CONTROL_ALLOCATION_MAX_MOTORS)), fully_actuated_(true), motor_params_(motor_params) {
+
+  // the wrench [force, torque] produced by the motor forces
+  Eigen::MatrixXd allocation = Eigen::MatrixXd::Zero(6, n_motors_);
+
+  for (int i = 0; i < n_motors_; i++) {
+
+    Eigen::Vector3d axis = motors[i].axis.normalized();
+
+    allocation.block<3, 1>(0, i) = axis;
+    allocation.block<3, 1>(3, i) = motors[i].position.cross(axis) + motors[i].direction * torque_coefficient * axis;
+  }
+
+  auto decomposition = allocation.completeOrthogonalDecomposition();
+
+  rank_  = int(decomposition.rank());
+  mixer_ = decomposition.pseudoInverse();
+}
+
+//}
+
+/* numberOfMotors() //{ */
+
+int ControlAllocation::numberOfMotors(void) const {
+
+  return n_motors_;
+}
+
+//}
+
+/* isFullyActuated() //{ */
+
+bool ControlAllocation::isFullyActuated(void) const {
+
+  return fully_actuated_;
+}
+
+//}
+
+/* rank() //{ */
+
+int ControlAllocation::rank(void) const {
+
+  return rank_;
+}
+
+//}
+
+/* mix() //{ */
+
+bool ControlAllocation::mix(const double thrust_force, const Eigen::Vector3d& torque, MotorVector_t& throttles) const {
+
+  MotorVector_t forces;
+
+  if (fully_actuated_) {
+
+    Eigen::Matrix<double, 6, 1> wrench;
+    wrench << 0, 0, thrust_force, torque;
+
+    forces = mixer_ * wrench;
+
+  } else {
+
+    Eigen::Vector4d wrench(thrust_force, torque[0], torque[1], torque[2]);
+
+    forces = mixer_ * wrench;
+  }
+
+  return forcesToThrottles(forces, throttles);
+}
+
+bool ControlAllocation::mix(const Eigen::Vector3d& force, const Eigen::Vector3d& torque, MotorVector_t& throttles) const {
+
+  if (!fully_actuated_) {
+    throttles.setZero(n_motors_);
+    return true;
+  }
+
+  Eigen::Matrix<double, 6, 1> wrench;
+  wrench << force, torque;
+
+  MotorVector_t forces = mixer_ * wrench;
+
+  return forcesToThrottles(forces, throttles);
+}
+
+//}
+
+/* forcesToThrottles() //{ */
+
+bool ControlAllocation::forcesToThrottles(MotorVector_t& forces, MotorVector_t& throttles) const {
+
+  throttles.resize(n_motors_);
+
+  bool saturated = false;
+
+  for (int i = 0; i < n_motors_; i++) {
+
+    if (forces[i] < 0) {
+      forces[i] = 0;
+      saturated = true;
+    }
+
+    // the thrust model is defined for all the motors together
+    throttles[i] = mrs_lib::quadratic_thrust_model::forceToThrust(motor_params_, n_motors_ * forces[i]);
+
+    if (throttles[i] > 1.0) {
+      throttles[i] = 1.0;
+      saturated    = true;
+    } else if (throttles[i] < 0.0) {
+      throttles[i] = 0.0;
+      saturated    = true;
+    }
+  }
+
+  return saturated;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,420 @@
+#include <mrs_uav_controllers/common/controller_health.h>
+
+#include <algorithm>
+#include <cmath>
+#include <time.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// the names of the FLIGHT_RECORD_* flags in the diagnostics
+static const char* const flag_names[FLIGHT_RECORD_N_FLAGS] = {
+    "tilt saturated", "thrust saturated", "tilt failsafe", "null output", "rampup", "mpc failed", "disturbance saturated", "integral saturated", "rate saturated",
+    "attitude singular",
+};
+
+// the names of the CpuCategory_t in the diagnostics
+static const char* const cpu_category_names[CPU_N_CATEGORIES] = {"update", "drs", "service", "subscriber", "background"};
+
+/* clock helpers //{ */
+
+uint64_t clockNs(const clockid_t clock) {
+
+  struct timespec time;
+
+  if (clock_gettime(clock, &time) != 0) {
+    return 0;
+  }
+
+  return uint64_t(time.tv_sec) * 1000000000ull + uint64_t(time.tv_nsec);
+}
+
+//}
+
+/* bucket helpers //{ */
+
+size_t updateTimeBucket(const double duration) {
+
+  double us = duration * 1e6;
+
+  if (!(us > 1.0)) {
+    return 0;
+  }
+
+  return std::min(size_t(CONTROLLER_HEALTH_BUCKETS_PER_OCTAVE * std::log2(us)), size_t(CONTROLLER_HEALTH_N_BUCKETS - 1));
+}
+
+// the upper bound of the bucket [s], the percentiles are reported conservatively
+double bucketUpperBound(const size_t bucket) {
+
+  return 1e-6 * std::exp2(double(bucket + 1) / CONTROLLER_HEALTH_BUCKETS_PER_OCTAVE);
+}
+
+double percentile(const std::array<uint64_t, CONTROLLER_HEALTH_N_BUCKETS>& histogram, const uint64_t total, const double p) {
+
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t target = uint64_t(std::ceil(p * double(total)));
+  uint64_t sum    = 0;
+
+  for (size_t i = 0; i < histogram.size(); i++) {
+
+    sum += histogram[i];
+
+    if (sum >= target) {
+      return bucketUpperBound(i);
+    }
+  }
+
+  return bucketUpperBound(histogram.size() - 1);
+}
+
+//}
+
+/* keyValue() //{ */
+
+diagnostic_msgs::KeyValue keyValue(const std::string& key, const double value) {
+
+  diagnostic_msgs::KeyValue key_value;
+
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.6g", value);
+
+  key_value.key   = key;
+  key_value.value = buffer;
+
+  return key_value;
+}
+
+//}
+
+/* ControllerHealth() //{ */
+
+ControllerHealth::ControllerHealth(const std::string& name, const std::vector<std::string>& estimates, const ControllerHealthParams_t& params)
+    : name_(name), estimate_names_(estimates), params_(params), estimates_(estimates.size()) {
+
+  n_updates_    = 0;
+  n_solves_     = 0;
+  n_iterations_ = 0;
+  n_truncated_  = 0;
+  n_fast_path_  = 0;
+
+  for (auto& bucket : update_times_) {
+    bucket = 0;
+  }
+
+  for (auto& flag : flags_) {
+    flag = 0;
+  }
+
+  for (auto& estimate : estimates_) {
+    estimate = 0;
+  }
+
+  for (size_t i = 0; i < CPU_N_CATEGORIES; i++) {
+    cpu_calls_[i] = 0;
+    cpu_time_[i]  = 0;
+    wall_time_[i] = 0;
+  }
+
+  last_n_updates_    = 0;
+  last_n_solves_     = 0;
+  last_n_iterations_ = 0;
+  last_n_truncated_  = 0;
+  last_n_fast_path_  = 0;
+
+  last_update_times_.fill(0);
+  last_flags_.fill(0);
+  last_estimates_.resize(estimates.size(), 0);
+  last_cpu_calls_.fill(0);
+  last_cpu_time_.fill(0);
+  last_wall_time_.fill(0);
+}
+
+//}
+
+/* advertise() //{ */
+
+void ControllerHealth::advertise(ros::NodeHandle& nh) {
+
+  if (params_.rate <= 0) {
+    return;
+  }
+
+  publisher_diagnostics_ = nh.advertise<diagnostic_msgs::DiagnosticArray>("diagnostics_out", 1);
+
+  timer_diagnostics_ = nh.createTimer(ros::Rate(params_.rate), &ControllerHealth::timerDiagnostics, this);
+}
+
+//}
+
+/* addUpdate() //{ */
+
+void ControllerHealth::addUpdate(const double duration, const uint32_t flags) {
+
+  update_times_[updateTimeBucket(duration)].fetch_add(1, std::memory_order_relaxed);
+
+  for (size_t i = 0; i < FLIGHT_RECORD_N_FLAGS; i++) {
+    if (flags & (1u << i)) {
+      flags_[i].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  // the counter goes last, the reader never sees more updates than the histogram holds
+  n_updates_.fetch_add(1, std::memory_order_release);
+}
+
+//}
+
+/* addSolve() //{ */
+
+void ControllerHealth::addSolve(const int iterations, const bool truncated, const bool fast_path) {
+
+  n_iterations_.fetch_add(uint64_t(std::max(iterations, 0)), std::memory_order_relaxed);
+
+  if (truncated) {
+    n_truncated_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (fast_path) {
+    n_fast_path_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  n_solves_.fetch_add(1, std::memory_order_release);
+}
+
+//}
+
+/* setEstimate() //{ */
+
+void ControllerHealth::setEstimate(const size_t index, const double value) {
+
+  if (index < estimates_.size()) {
+    estimates_[index].store(value, std::memory_order_relaxed);
+  }
+}
+
+//}
+
+/* addCpuTime() //{ */
+
+void ControllerHealth::addCpuTime(const CpuCategory_t category, const uint64_t cpu_time, const uint64_t wall_time) {
+
+  cpu_time_[category].fetch_add(cpu_time, std::memory_order_relaxed);
+  wall_time_[category].fetch_add(wall_time, std::memory_order_relaxed);
+  cpu_calls_[category].fetch_add(1, std::memory_order_release);
+}
+
+//}
+
+/* getDiagnostics() //{ */
+
+diagnostic_msgs::DiagnosticStatus ControllerHealth::getDiagnostics(const ros::Time& now) {
+
+  std::scoped_lock lock(mutex_window_);
+
+  diagnostic_msgs::DiagnosticStatus status;
+
+  status.name        = name_;
+  status.hardware_id = "controller";
+
+  // | ---------------- differentiate the counters --------------- |
+
+  uint64_t n_updates = n_updates_.load(std::memory_order_acquire);
+  uint64_t n_solves  = n_solves_.load(std::memory_order_acquire);
+
+  std::array<uint64_t, CONTROLLER_HEALTH_N_BUCKETS> update_times;
+  std::array<uint64_t, FLIGHT_RECORD_N_FLAGS>       flags;
+
+  std::array<uint64_t, CONTROLLER_HEALTH_N_BUCKETS> window_update_times;
+
+  uint64_t window_histogram_total = 0;
+
+  for (size_t i = 0; i < CONTROLLER_HEALTH_N_BUCKETS; i++) {
+    update_times[i]        = update_times_[i].load(std::memory_order_relaxed);
+    window_update_times[i] = update_times[i] - last_update_times_[i];
+    window_histogram_total += window_update_times[i];
+  }
+
+  for (size_t i = 0; i < FLIGHT_RECORD_N_FLAGS; i++) {
+    flags[i] = flags_[i].load(std::memory_order_relaxed);
+  }
+
+  uint64_t n_iterations = n_iterations_.load(std::memory_order_relaxed);
+  uint64_t n_truncated  = n_truncated_.load(std::memory_order_relaxed);
+  uint64_t n_fast_path  = n_fast_path_.load(std::memory_order_relaxed);
+
+  uint64_t window_updates = n_updates - last_n_updates_;
+  uint64_t window_solves  = n_solves - last_n_solves_;
+  double   window_time    = last_time_.isZero() ? 0.0 : (now - last_time_).toSec();
+
+  double p50 = percentile(window_update_times, window_histogram_total, 0.50);
+  double p99 = percentile(window_update_times, window_histogram_total, 0.99);
+
+  status.values.push_back(keyValue("updates", double(window_updates)));
+  status.values.push_back(keyValue("update rate [Hz]", window_time > 0 ? double(window_updates) / window_time : 0.0));
+  status.values.push_back(keyValue("update time p50 [s]", p50));
+  status.values.push_back(keyValue("update time p99 [s]", p99));
+
+  // the duty cycles of the flags
+  std::array<double, FLIGHT_RECORD_N_FLAGS> duty;
+
+  for (size_t i = 0; i < FLIGHT_RECORD_N_FLAGS; i++) {
+    duty[i] = window_updates > 0 ? double(flags[i] - last_flags_[i]) / double(window_updates) : 0.0;
+    status.values.push_back(keyValue(std::string(flag_names[i]) + " [-]", duty[i]));
+  }
+
+  if (n_solves > 0) {
+    status.values.push_back(keyValue("solver iterations [-]", window_solves > 0 ? double(n_iterations - last_n_iterations_) / double(window_solves) : 0.0));
+    status.values.push_back(keyValue("solver truncated [-]", window_solves > 0 ? double(n_truncated - last_n_truncated_) / double(window_solves) : 0.0));
+    status.values.push_back(keyValue("solver fast path [-]", window_solves > 0 ? double(n_fast_path - last_n_fast_path_) / double(window_solves) : 0.0));
+  }
+
+  // the estimates converge when their rate of change goes to zero
+  for (size_t i = 0; i < estimates_.size(); i++) {
+
+    double value = estimates_[i].load(std::memory_order_relaxed);
+    double rate  = window_time > 0 ? (value - last_estimates_[i]) / window_time : 0.0;
+
+    status.values.push_back(keyValue(estimate_names_[i], value));
+    status.values.push_back(keyValue(estimate_names_[i] + " rate [1/s]", rate));
+
+    last_estimates_[i] = value;
+  }
+
+  // the CPU use of this instance, the percentage is of one core over the window
+  double total_cpu_time = 0;
+
+  for (size_t i = 0; i < CPU_N_CATEGORIES; i++) {
+
+    uint64_t calls     = cpu_calls_[i].load(std::memory_order_acquire);
+    uint64_t cpu_time  = cpu_time_[i].load(std::memory_order_relaxed);
+    uint64_t wall_time = wall_time_[i].load(std::memory_order_relaxed);
+
+    uint64_t window_calls     = calls - last_cpu_calls_[i];
+    double   window_cpu_time  = 1e-9 * double(cpu_time - last_cpu_time_[i]);
+    double   window_wall_time = 1e-9 * double(wall_time - last_wall_time_[i]);
+
+    last_cpu_calls_[i] = calls;
+    last_cpu_time_[i]  = cpu_time;
+    last_wall_time_[i] = wall_time;
+
+    total_cpu_time += window_cpu_time;
+
+    if (calls == 0) {
+      continue;
+    }
+
+    std::string category = std::string("cpu ") + cpu_category_names[i];
+
+    status.values.push_back(keyValue(category + " calls", double(window_calls)));
+    status.values.push_back(keyValue(category + " [%]", window_time > 0 ? 100.0 * window_cpu_time / window_time : 0.0));
+    status.values.push_back(keyValue(category + " cpu time per call [s]", window_calls > 0 ? window_cpu_time / double(window_calls) : 0.0));
+    status.values.push_back(keyValue(category + " wall time per call [s]", window_calls > 0 ? window_wall_time / double(window_calls) : 0.0));
+  }
+
+  status.values.push_back(keyValue("cpu total [%]", window_time > 0 ? 100.0 * total_cpu_time / window_time : 0.0));
+
+  // | ------------------------ the level ----------------------- |
+
+  double thrust_duty = duty[__builtin_ctz(FLIGHT_RECORD_THRUST_SATURATED)];
+  double null_duty   = duty[__builtin_ctz(FLIGHT_RECORD_NULL_OUTPUT)];
+
+  if (window_updates == 0) {
+
+    status.level   = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "inactive";
+
+  } else if (null_duty > 0) {
+
+    status.level   = diagnostic_msgs::DiagnosticStatus::ERROR;
+    status.message = "null output";
+
+  } else if (params_.max_update_time > 0 && p99 > params_.max_update_time) {
+
+    status.level   = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "the update time is over the limit";
+
+  } else if (thrust_duty > 0.5) {
+
+    status.level   = diagnostic_msgs::DiagnosticStatus::WARN;
+    status.message = "the thrust is saturated";
+
+  } else {
+
+    status.level   = diagnostic_msgs::DiagnosticStatus::OK;
+    status.message = "ok";
+  }
+
+  // | -------------------- remember the window ------------------- |
+
+  last_time_         = now;
+  last_n_updates_    = n_updates;
+  last_n_solves_     = n_solves;
+  last_n_iterations_ = n_iterations;
+  last_n_truncated_  = n_truncated;
+  last_n_fast_path_  = n_fast_path;
+  last_update_times_ = update_times;
+  last_flags_        = flags;
+
+  return status;
+}
+
+//}
+
+/* CpuTimeScope() //{ */
+
+CpuTimeScope::CpuTimeScope(ControllerHealth& health, const CpuCategory_t category) : health_(health), category_(category) {
+
+  cpu_start_  = clockNs(CLOCK_THREAD_CPUTIME_ID);
+  wall_start_ = clockNs(CLOCK_MONOTONIC);
+}
+
+//}
+
+/* ~CpuTimeScope() //{ */
+
+CpuTimeScope::~CpuTimeScope() {
+
+  uint64_t cpu_end  = clockNs(CLOCK_THREAD_CPUTIME_ID);
+  uint64_t wall_end = clockNs(CLOCK_MONOTONIC);
+
+  health_.addCpuTime(category_, cpu_end - std::min(cpu_start_, cpu_end), wall_end - std::min(wall_start_, wall_end));
+}
+
+//}
+
+// --------------------------------------------------------------
+// |                          callbacks                         |
+// --------------------------------------------------------------
+
+/* timerDiagnostics() //{ */
+
+void ControllerHealth::timerDiagnostics([[maybe_unused]] const ros::TimerEvent& event) {
+
+  CpuTimeScope cpu_time_scope(*this, CPU_BACKGROUND);
+
+  diagnostic_msgs::DiagnosticArray diagnostics;
+
+  diagnostics.header.stamp = ros::Time::now();
+
+  diagnostics.status.push_back(getDiagnostics(diagnostics.header.stamp));
+
+  try {
+    publisher_diagnostics_.publish(diagnostics);
+  }
+  catch (...) {
+    ROS_ERROR("[%s]: exception caught during publishing topic '%s'", name_.c_str(), publisher_diagnostics_.getTopic().c_str());
+  }
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
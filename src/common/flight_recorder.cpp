@@ -0,0 +1,187 @@
+#include <mrs_uav_controllers/common/flight_recorder.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <type_traits>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+static_assert(std::is_trivially_copyable<FlightRecord_t>::value, "the flight record has to be copyable as bytes");
+static_assert(sizeof(FlightRecorderHeader_t) % alignof(FlightRecord_t) == 0, "the records after the header would be misaligned");
+
+/* getFlightRecordColumns() //{ */
+
+const std::vector<FlightRecordColumn_t>& getFlightRecordColumns(void) {
+
+  // clang-format off
+  static const std::vector<FlightRecordColumn_t> columns = {
+    {"stamp",                     offsetof(FlightRecord_t, stamp),                     COLUMN_DOUBLE, 1},
+    {"time",                      offsetof(FlightRecord_t, time),                      COLUMN_DOUBLE, 1},
+    {"dt",                        offsetof(FlightRecord_t, dt),                        COLUMN_DOUBLE, 1},
+    {"position",                  offsetof(FlightRecord_t, position),                  COLUMN_DOUBLE, 3},
+    {"velocity",                  offsetof(FlightRecord_t, velocity),                  COLUMN_DOUBLE, 3},
+    {"acceleration",              offsetof(FlightRecord_t, acceleration),              COLUMN_DOUBLE, 3},
+    {"orientation",               offsetof(FlightRecord_t, orientation),               COLUMN_DOUBLE, 4},
+    {"attitude_rate",             offsetof(FlightRecord_t, attitude_rate),             COLUMN_DOUBLE, 3},
+    {"reference_position",        offsetof(FlightRecord_t, reference_position),        COLUMN_DOUBLE, 3},
+    {"reference_velocity",        offsetof(FlightRecord_t, reference_velocity),        COLUMN_DOUBLE, 3},
+    {"reference_acceleration",    offsetof(FlightRecord_t, reference_acceleration),    COLUMN_DOUBLE, 3},
+    {"reference_jerk",            offsetof(FlightRecord_t, reference_jerk),            COLUMN_DOUBLE, 3},
+    {"reference_heading",         offsetof(FlightRecord_t, reference_heading),         COLUMN_DOUBLE, 1},
+    {"feedforward",               offsetof(FlightRecord_t, feedforward),               COLUMN_DOUBLE, 3},
+    {"position_feedback",         offsetof(FlightRecord_t, position_feedback),         COLUMN_DOUBLE, 3},
+    {"velocity_feedback",         offsetof(FlightRecord_t, velocity_feedback),         COLUMN_DOUBLE, 3},
+    {"integral_feedback",         offsetof(FlightRecord_t, integral_feedback),         COLUMN_DOUBLE, 3},
+    {"attitude_error",            offsetof(FlightRecord_t, attitude_error),            COLUMN_DOUBLE, 3},
+    {"attitude_rate_feedforward", offsetof(FlightRecord_t, attitude_rate_feedforward), COLUMN_DOUBLE, 3},
+    {"theta",                     offsetof(FlightRecord_t, theta),                     COLUMN_DOUBLE, 1},
+    {"disturbance",               offsetof(FlightRecord_t, disturbance),               COLUMN_DOUBLE, 3},
+    {"mpc_input",                 offsetof(FlightRecord_t, mpc_input),                 COLUMN_DOUBLE, 3},
+    {"mpc_iterations",            offsetof(FlightRecord_t, mpc_iterations),            COLUMN_INT32,  3},
+    {"mpc_solve_time",            offsetof(FlightRecord_t, mpc_solve_time),            COLUMN_DOUBLE, 1},
+    {"desired_orientation",       offsetof(FlightRecord_t, desired_orientation),       COLUMN_DOUBLE, 4},
+    {"output_attitude_rate",      offsetof(FlightRecord_t, output_attitude_rate),      COLUMN_DOUBLE, 3},
+    {"thrust",                    offsetof(FlightRecord_t, thrust),                    COLUMN_DOUBLE, 1},
+    {"thrust_force",              offsetof(FlightRecord_t, thrust_force),              COLUMN_DOUBLE, 1},
+    {"total_mass",                offsetof(FlightRecord_t, total_mass),                COLUMN_DOUBLE, 1},
+    {"mass_difference",           offsetof(FlightRecord_t, mass_difference),           COLUMN_DOUBLE, 1},
+    {"flags",                     offsetof(FlightRecord_t, flags),                     COLUMN_UINT32, 1},
+  };
+  // clang-format on
+
+  return columns;
+}
+
+//}
+
+/* getFlightRecorderPath() //{ */
+
+std::string getFlightRecorderPath(const std::string& directory, const std::string& name) {
+
+  time_t    now = time(nullptr);
+  struct tm local;
+
+  char stamp[32] = "";
+
+  if (localtime_r(&now, &local)) {
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d_%H-%M-%S", &local);
+  }
+
+  // the pid tells apart the runs which started within the same second
+  return directory + "/" + name + "_" + stamp + "_" + std::to_string(getpid()) + ".frec";
+}
+
+//}
+
+/* FlightRecorder() //{ */
+
+FlightRecorder::FlightRecorder(const std::string& path, const size_t capacity, const std::string& controller) : capacity_(capacity) {
+
+  if (capacity_ == 0) {
+    error_ = "the capacity has to be positive";
+    return;
+  }
+
+  size_ = sizeof(FlightRecorderHeader_t) + capacity_ * sizeof(FlightRecord_t);
+
+  // the recording of an incident is kept for the investigation, whatever starts after it
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+
+  if (fd < 0) {
+    error_ = "could not open '" + path + "': " + strerror(errno);
+    return;
+  }
+
+  if (ftruncate(fd, off_t(size_)) != 0) {
+    error_ = "could not resize '" + path + "': " + strerror(errno);
+    close(fd);
+    return;
+  }
+
+  void* mapping = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+  // the mapping keeps the file
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    error_ = "could not map '" + path + "': " + strerror(errno);
+    return;
+  }
+
+  mapping_ = mapping;
+  header_  = static_cast<FlightRecorderHeader_t*>(mapping_);
+  records_ = reinterpret_cast<FlightRecord_t*>(static_cast<char*>(mapping_) + sizeof(FlightRecorderHeader_t));
+
+  std::memset(header_, 0, sizeof(FlightRecorderHeader_t));
+  std::memcpy(header_->magic, FLIGHT_RECORDER_MAGIC, sizeof(header_->magic));
+  std::strncpy(header_->controller, controller.c_str(), sizeof(header_->controller) - 1);
+
+  header_->version     = FLIGHT_RECORDER_VERSION;
+  header_->record_size = uint32_t(sizeof(FlightRecord_t));
+  header_->capacity    = capacity_;
+  header_->n_written   = 0;
+}
+
+//}
+
+/* ~FlightRecorder() //{ */
+
+FlightRecorder::~FlightRecorder() {
+
+  if (mapping_) {
+    msync(mapping_, size_, MS_ASYNC);
+    munmap(mapping_, size_);
+  }
+}
+
+//}
+
+/* isOpen() //{ */
+
+bool FlightRecorder::isOpen(void) const {
+
+  return mapping_ != nullptr;
+}
+
+//}
+
+/* getError() //{ */
+
+std::string FlightRecorder::getError(void) const {
+
+  return error_;
+}
+
+//}
+
+/* write() //{ */
+
+void FlightRecorder::write(const FlightRecord_t& record) {
+
+  if (!mapping_) {
+    return;
+  }
+
+  uint64_t n = header_->n_written;
+
+  std::memcpy(&records_[n % capacity_], &record, sizeof(FlightRecord_t));
+
+  // a reader of the live file sees the counter only after the record
+  __atomic_store_n(&header_->n_written, n + 1, __ATOMIC_RELEASE);
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
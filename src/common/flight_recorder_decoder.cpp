@@ -0,0 +1,141 @@
+/* converts the file of the FlightRecorder to CSV, one column per element, the records in the order they were written */
+
+#include <mrs_uav_controllers/common/flight_recorder.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace mrs_uav_controllers::common;
+
+/* printHeader() //{ */
+
+void printHeader(FILE* out) {
+
+  const char* suffixes[] = {"_x", "_y", "_z", "_w"};
+
+  bool first = true;
+
+  for (const auto& column : getFlightRecordColumns()) {
+    for (int i = 0; i < column.count; i++) {
+      fprintf(out, "%s%s%s", first ? "" : ",", column.name.c_str(), column.count > 1 ? suffixes[i] : "");
+      first = false;
+    }
+  }
+
+  fprintf(out, "\n");
+}
+
+//}
+
+/* printRecord() //{ */
+
+void printRecord(FILE* out, const char* record) {
+
+  bool first = true;
+
+  for (const auto& column : getFlightRecordColumns()) {
+    for (int i = 0; i < column.count; i++) {
+
+      fprintf(out, "%s", first ? "" : ",");
+      first = false;
+
+      switch (column.type) {
+        case COLUMN_DOUBLE: {
+          double value;
+          std::memcpy(&value, record + column.offset + i * sizeof(double), sizeof(double));
+          fprintf(out, "%.9g", value);
+          break;
+        }
+        case COLUMN_INT32: {
+          int32_t value;
+          std::memcpy(&value, record + column.offset + i * sizeof(int32_t), sizeof(int32_t));
+          fprintf(out, "%" PRId32, value);
+          break;
+        }
+        case COLUMN_UINT32: {
+          uint32_t value;
+          std::memcpy(&value, record + column.offset + i * sizeof(uint32_t), sizeof(uint32_t));
+          fprintf(out, "%" PRIu32, value);
+          break;
+        }
+      }
+    }
+  }
+
+  fprintf(out, "\n");
+}
+
+//}
+
+/* main() //{ */
+
+int main(int argc, char** argv) {
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <recording> [output.csv]\n", argv[0]);
+    return 1;
+  }
+
+  std::ifstream file(argv[1], std::ios::binary);
+
+  if (!file) {
+    fprintf(stderr, "could not open '%s'\n", argv[1]);
+    return 1;
+  }
+
+  FlightRecorderHeader_t header;
+
+  if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, FLIGHT_RECORDER_MAGIC, sizeof(header.magic)) != 0) {
+    fprintf(stderr, "'%s' is not a flight recording\n", argv[1]);
+    return 1;
+  }
+
+  if (header.version != FLIGHT_RECORDER_VERSION || header.record_size != sizeof(FlightRecord_t)) {
+    fprintf(stderr, "'%s' has been recorded by a different version (version %" PRIu32 ", record size %" PRIu32 "), expected version %d, record size %zu\n",
+            argv[1], header.version, header.record_size, FLIGHT_RECORDER_VERSION, sizeof(FlightRecord_t));
+    return 1;
+  }
+
+  std::vector<char> records(header.capacity * header.record_size);
+
+  if (!file.read(records.data(), records.size())) {
+    fprintf(stderr, "'%s' is truncated\n", argv[1]);
+    return 1;
+  }
+
+  FILE* out = stdout;
+
+  if (argc > 2) {
+
+    out = fopen(argv[2], "w");
+
+    if (!out) {
+      fprintf(stderr, "could not open '%s' for writing\n", argv[2]);
+      return 1;
+    }
+  }
+
+  // the oldest record which was not overwritten
+  uint64_t n_valid = std::min(header.n_written, header.capacity);
+  uint64_t first   = header.n_written - n_valid;
+
+  fprintf(stderr, "%s: %" PRIu64 " records written, %" PRIu64 " kept\n", header.controller, header.n_written, n_valid);
+
+  printHeader(out);
+
+  for (uint64_t i = first; i < header.n_written; i++) {
+    printRecord(out, records.data() + (i % header.capacity) * header.record_size);
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+
+  return 0;
+}
+
+//}
@@ -0,0 +1,96 @@
+#include <mrs_uav_controllers/common/high_rate.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* Decimator() //{ */
+
+Decimator::Decimator(const int period) : period_(period < 1 ? 1 : period) {
+
+  reset();
+}
+
+//}
+
+/* tick() //{ */
+
+bool Decimator::tick(void) {
+
+  bool run = counter_ == 0;
+
+  if (++counter_ >= period_) {
+    counter_ = 0;
+  }
+
+  return run;
+}
+
+//}
+
+/* reset() //{ */
+
+void Decimator::reset(void) {
+
+  counter_ = 0;
+}
+
+//}
+
+/* getPeriod() //{ */
+
+int Decimator::getPeriod(void) const {
+
+  return period_;
+}
+
+//}
+
+/* odometryDt() //{ */
+
+std::optional<double> odometryDt(const ros::Time& stamp, ros::Time& last_stamp, const double min_dt) {
+
+  double dt = (stamp - last_stamp).toSec();
+
+  if (dt < 0) {
+
+    // the time went backwards, start over from this odometry
+    last_stamp = stamp;
+
+    return std::nullopt;
+  }
+
+  if (dt <= min_dt) {
+    return std::nullopt;
+  }
+
+  last_stamp = stamp;
+
+  return dt;
+}
+
+//}
+
+/* toUntiltedFrame() //{ */
+
+Eigen::Vector3d toUntiltedFrame(const Eigen::Vector3d& vector, const double heading) {
+
+  return Eigen::AngleAxisd(-heading, Eigen::Vector3d::UnitZ()) * vector;
+}
+
+//}
+
+/* fromUntiltedFrame() //{ */
+
+Eigen::Vector3d fromUntiltedFrame(const Eigen::Vector3d& vector, const double heading) {
+
+  return Eigen::AngleAxisd(heading, Eigen::Vector3d::UnitZ()) * vector;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
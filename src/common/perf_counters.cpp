@@ -0,0 +1,248 @@
+#include <mrs_uav_controllers/common/perf_counters.h>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* perfEventOpen() //{ */
+
+int perfEventOpen(const uint64_t config, const int group_fd) {
+
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+
+  attr.size           = sizeof(attr);
+  attr.type           = PERF_TYPE_HARDWARE;
+  attr.config         = config;
+  attr.disabled       = group_fd == -1 ? 1 : 0;  // the group is enabled through the leader
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+  attr.read_format    = PERF_FORMAT_GROUP;
+
+  // this thread, any CPU
+  return int(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+//}
+
+/* PerfCounters() //{ */
+
+PerfCounters::PerfCounters() {
+
+  const uint64_t configs[PERF_N_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+
+    fd_[i]    = perfEventOpen(configs[i], group_fd_);
+    index_[i] = -1;
+
+    if (fd_[i] < 0) {
+
+      if (error_.empty()) {
+        error_ = std::string("perf_event_open(") + getName(PerfCounter_t(i)) + "): " + strerror(errno);
+      }
+
+      continue;
+    }
+
+    if (group_fd_ == -1) {
+      group_fd_ = fd_[i];
+    }
+
+    index_[i] = n_opened_++;
+  }
+
+  if (group_fd_ != -1) {
+    ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+
+  reset();
+}
+
+//}
+
+/* ~PerfCounters() //{ */
+
+PerfCounters::~PerfCounters() {
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+    if (fd_[i] >= 0) {
+      close(fd_[i]);
+    }
+  }
+}
+
+//}
+
+/* isAvailable() //{ */
+
+bool PerfCounters::isAvailable(void) const {
+
+  return group_fd_ != -1;
+}
+
+//}
+
+/* getError() //{ */
+
+std::string PerfCounters::getError(void) const {
+
+  return error_;
+}
+
+//}
+
+/* start() //{ */
+
+void PerfCounters::start(void) {
+
+  if (!isAvailable()) {
+    return;
+  }
+
+  read(start_values_);
+}
+
+//}
+
+/* stop() //{ */
+
+void PerfCounters::stop(void) {
+
+  if (!isAvailable()) {
+    return;
+  }
+
+  uint64_t stop_values[PERF_N_COUNTERS];
+
+  if (!read(stop_values)) {
+    return;
+  }
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+    if (values_.available[i]) {
+      values_.value[i] += stop_values[i] - start_values_[i];
+    }
+  }
+
+  values_.n_samples++;
+}
+
+//}
+
+/* reset() //{ */
+
+void PerfCounters::reset(void) {
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+    values_.value[i]     = 0;
+    values_.available[i] = index_[i] >= 0;
+    start_values_[i]     = 0;
+  }
+
+  values_.n_samples = 0;
+}
+
+//}
+
+/* getValues() //{ */
+
+PerfCounterValues_t PerfCounters::getValues(void) const {
+
+  return values_;
+}
+
+//}
+
+/* getName() //{ */
+
+const char* PerfCounters::getName(const PerfCounter_t counter) {
+
+  switch (counter) {
+    case PERF_CYCLES:
+      return "cycles";
+    case PERF_INSTRUCTIONS:
+      return "instructions";
+    case PERF_CACHE_MISSES:
+      return "cache_misses";
+    case PERF_BRANCH_MISSES:
+      return "branch_misses";
+    default:
+      return "unknown";
+  }
+}
+
+//}
+
+/* read() //{ */
+
+// one read() of the whole group: {nr, values[nr]}
+bool PerfCounters::read(uint64_t* values) {
+
+  uint64_t buffer[1 + PERF_N_COUNTERS];
+
+  ssize_t size = ::read(group_fd_, buffer, sizeof(buffer));
+
+  if (size < ssize_t(sizeof(uint64_t)) || buffer[0] != uint64_t(n_opened_)) {
+    return false;
+  }
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+    values[i] = index_[i] >= 0 ? buffer[1 + index_[i]] : 0;
+  }
+
+  return true;
+}
+
+//}
+
+/* perfCountersToJson() //{ */
+
+std::string perfCountersToJson(const PerfCounterValues_t& values) {
+
+  std::string json = "{";
+
+  char buffer[64];
+
+  for (int i = 0; i < PERF_N_COUNTERS; i++) {
+
+    if (values.available[i] && values.n_samples > 0) {
+      snprintf(buffer, sizeof(buffer), "%.1f", double(values.value[i]) / double(values.n_samples));
+    } else {
+      snprintf(buffer, sizeof(buffer), "null");
+    }
+
+    json += std::string("\"") + PerfCounters::getName(PerfCounter_t(i)) + "\": " + buffer + ", ";
+  }
+
+  bool ipc = values.available[PERF_CYCLES] && values.available[PERF_INSTRUCTIONS] && values.value[PERF_CYCLES] > 0;
+
+  if (ipc) {
+    snprintf(buffer, sizeof(buffer), "%.3f", double(values.value[PERF_INSTRUCTIONS]) / double(values.value[PERF_CYCLES]));
+  } else {
+    snprintf(buffer, sizeof(buffer), "null");
+  }
+
+  json += std::string("\"ipc\": ") + buffer + ", \"samples\": " + std::to_string(values.n_samples) + "}";
+
+  return json;
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,80 @@
+#include <mrs_uav_controllers/common/rate_controller.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* RateController() //{ */
+
+RateController::RateController(const RateControllerParams_t& params) : params_(params) {
+
+  reset();
+}
+
+//}
+
+/* reset() //{ */
+
+void RateController::reset(void) {
+
+  first_update_            = true;
+  last_desired_rate_       = Eigen::Vector3d::Zero();
+  desired_rate_derivative_ = Eigen::Vector3d::Zero();
+}
+
+//}
+
+/* update() //{ */
+
+Eigen::Vector3d RateController::update(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, const double dt) {
+
+  // | ---------- the derivative of the desired attitude rate ---------- |
+
+  if (first_update_ || dt <= 0) {
+
+    desired_rate_derivative_ = Eigen::Vector3d::Zero();
+    first_update_            = false;
+
+  } else {
+
+    double alpha = dt / (params_.feedforward_tc + dt);
+
+    desired_rate_derivative_ += alpha * ((desired_rate - last_desired_rate_) / dt - desired_rate_derivative_);
+  }
+
+  last_desired_rate_ = desired_rate;
+
+  return torque(desired_rate, rate, desired_rate_derivative_);
+}
+
+Eigen::Vector3d RateController::update(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, [[maybe_unused]] const double dt,
+                                       const Eigen::Vector3d& angular_acceleration) {
+
+  // the numerical derivative continues smoothly if the feedforward disappears
+  first_update_            = false;
+  last_desired_rate_       = desired_rate;
+  desired_rate_derivative_ = angular_acceleration;
+
+  return torque(desired_rate, rate, angular_acceleration);
+}
+
+//}
+
+/* torque() //{ */
+
+Eigen::Vector3d RateController::torque(const Eigen::Vector3d& desired_rate, const Eigen::Vector3d& rate, const Eigen::Vector3d& angular_acceleration) const {
+
+  Eigen::Vector3d acceleration = params_.gains.cwiseProduct(desired_rate - rate) + angular_acceleration;
+
+  Eigen::Vector3d J_rate = params_.inertia.cwiseProduct(rate);
+
+  return params_.inertia.cwiseProduct(acceleration) + rate.cross(J_rate);
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,362 @@
+#include <mrs_uav_controllers/common/shadow_mode.h>
+
+#include <eigen3/Eigen/Eigen>
+
+#include <algorithm>
+#include <cmath>
+#include <pthread.h>
+#include <sched.h>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+// the iterations kept for the pairing with the active output, which comes over a topic a moment later
+const size_t INPUT_HISTORY = 20;
+
+/* setIdlePriority() //{ */
+
+// SCHED_IDLE runs the thread only on a core which has nothing else to run
+int setIdlePriority([[maybe_unused]] const pthread_t thread, [[maybe_unused]] const bool idle) {
+
+#ifdef SCHED_IDLE
+  struct sched_param param;
+  param.sched_priority = 0;
+
+  return pthread_setschedparam(thread, idle ? SCHED_IDLE : SCHED_OTHER, &param);
+#else
+  return 0;
+#endif
+}
+
+//}
+
+/* ShadowMode() //{ */
+
+ShadowMode::ShadowMode(const std::string& name, const ShadowModeParams_t& params, const update_t& update)
+    : name_(name), params_(params), update_(update), n_unmatched_(0), n_dropped_(0) {
+
+  params_.queue_size = std::max(params_.queue_size, 1);
+
+  divergence_ = Divergence_t();
+}
+
+//}
+
+/* ~ShadowMode() //{ */
+
+ShadowMode::~ShadowMode() {
+
+  // no new frames from the callback
+  subscriber_active_output_.shutdown();
+
+  {
+    std::scoped_lock lock(mutex_queue_);
+
+    stop_ = true;
+  }
+
+  queue_cv_.notify_one();
+
+  if (worker_thread_.joinable()) {
+    worker_thread_.join();
+  }
+}
+
+//}
+
+/* start() //{ */
+
+void ShadowMode::start(ros::NodeHandle& nh) {
+
+  last_log_time_ = ros::WallTime::now();
+
+  worker_thread_ = std::thread(&ShadowMode::workerThread, this);
+
+  subscriber_active_output_ = nh.subscribe("shadow/active_output_in", 1, &ShadowMode::callbackActiveOutput, this, ros::TransportHints().tcpNoDelay());
+
+  ROS_INFO("[%s]: the shadow mode evaluates the controller while inactive on '%s', queue of %d frames", name_.c_str(),
+           subscriber_active_output_.getTopic().c_str(), params_.queue_size);
+}
+
+//}
+
+/* addInputs() //{ */
+
+void ShadowMode::addInputs(const mrs_msgs::UavState::ConstPtr& uav_state, const mrs_msgs::PositionCommand::ConstPtr& control_reference) {
+
+  std::scoped_lock lock(mutex_inputs_);
+
+  if (inputs_.size() >= INPUT_HISTORY) {
+    inputs_.pop_front();
+  }
+
+  inputs_.push_back({ros::Time::now(), uav_state, control_reference});
+}
+
+//}
+
+/* pause() //{ */
+
+void ShadowMode::pause(void) {
+
+  std::scoped_lock lock(mutex_queue_);
+
+  // the worker keeps its copy of the controller, the running update is only abandoned
+  paused_ = true;
+  queue_.clear();
+  generation_++;
+}
+
+//}
+
+/* resume() //{ */
+
+void ShadowMode::resume(void) {
+
+  {
+    std::scoped_lock lock(mutex_inputs_);
+
+    // from the time before the pause
+    inputs_.clear();
+  }
+
+  std::scoped_lock lock(mutex_queue_);
+
+  paused_  = false;
+  restart_ = true;
+}
+
+//}
+
+// | ------------------------ callbacks ----------------------- |
+
+/* callbackActiveOutput() //{ */
+
+void ShadowMode::callbackActiveOutput(const mrs_msgs::AttitudeCommand::ConstPtr& msg) {
+
+  ShadowFrame_t frame;
+
+  {
+    std::scoped_lock lock(mutex_inputs_);
+
+    // the iteration closest to the stamp of the output, which the active controller took during its update()
+    auto closest = inputs_.end();
+
+    for (auto it = inputs_.begin(); it != inputs_.end(); it++) {
+      if (closest == inputs_.end() || fabs((it->time - msg->header.stamp).toSec()) < fabs((closest->time - msg->header.stamp).toSec())) {
+        closest = it;
+      }
+    }
+
+    if (closest == inputs_.end() || fabs((closest->time - msg->header.stamp).toSec()) > params_.max_stamp_offset) {
+      n_unmatched_++;
+      return;
+    }
+
+    frame.uav_state         = closest->uav_state;
+    frame.control_reference = closest->control_reference;
+
+    // the later outputs belong to the later iterations
+    inputs_.erase(inputs_.begin(), closest + 1);
+  }
+
+  if (!frame.uav_state || !frame.control_reference) {
+    return;
+  }
+
+  frame.active_output = msg;
+  frame.received      = ros::WallTime::now();
+  frame.restart       = false;
+
+  {
+    std::scoped_lock lock(mutex_queue_);
+
+    if (paused_) {
+      return;
+    }
+
+    if (int(queue_.size()) >= params_.queue_size) {
+      queue_.pop_front();
+      n_dropped_++;
+    }
+
+    queue_.push_back(frame);
+  }
+
+  queue_cv_.notify_one();
+}
+
+//}
+
+// | ------------------------- worker ------------------------- |
+
+/* workerThread() //{ */
+
+void ShadowMode::workerThread(void) {
+
+  {
+    int res = setIdlePriority(pthread_self(), true);
+
+    if (res != 0) {
+      ROS_WARN("[%s]: could not lower the priority of the shadow mode worker, error %d", name_.c_str(), res);
+    }
+  }
+
+  if (!params_.cpus.empty()) {
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+
+    for (int cpu : params_.cpus) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE) {
+        CPU_SET(cpu, &cpu_set);
+      }
+    }
+
+    int res = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+
+    if (res != 0) {
+      ROS_WARN("[%s]: could not pin the shadow mode worker to the given cores, error %d", name_.c_str(), res);
+    }
+  }
+
+  while (true) {
+
+    ShadowFrame_t frame;
+    uint64_t      generation;
+
+    {
+      std::unique_lock lock(mutex_queue_);
+
+      queue_cv_.wait(lock, [this] { return stop_ || (!paused_ && !queue_.empty()); });
+
+      if (stop_) {
+        return;
+      }
+
+      frame = queue_.front();
+      queue_.pop_front();
+
+      frame.restart = restart_;
+      restart_      = false;
+
+      generation = generation_;
+    }
+
+    mrs_msgs::AttitudeCommand::ConstPtr output = update_(frame);
+
+    bool abandoned;
+
+    {
+      std::scoped_lock lock(mutex_queue_);
+
+      abandoned = generation != generation_;
+    }
+
+    // the controller was activated meanwhile, the next frame restarts the copy anyway
+    if (abandoned) {
+      divergence_.n_abandoned++;
+    } else {
+      addDivergence(frame, output);
+    }
+
+    if ((ros::WallTime::now() - last_log_time_).toSec() >= params_.log_period) {
+      logDivergence();
+    }
+  }
+}
+
+//}
+
+/* addDivergence() //{ */
+
+void ShadowMode::addDivergence(const ShadowFrame_t& frame, const mrs_msgs::AttitudeCommand::ConstPtr& output) {
+
+  divergence_.n_frames++;
+
+  double lag = (ros::WallTime::now() - frame.received).toSec();
+
+  divergence_.lag_sum += lag;
+  divergence_.lag_max = std::max(divergence_.lag_max, lag);
+
+  if (!output) {
+    return;
+  }
+
+  const mrs_msgs::AttitudeCommand& active = *frame.active_output;
+
+  divergence_.n_outputs++;
+
+  // | ------------------------ attitude ------------------------ |
+
+  Eigen::Quaterniond q_shadow(output->attitude.w, output->attitude.x, output->attitude.y, output->attitude.z);
+  Eigen::Quaterniond q_active(active.attitude.w, active.attitude.x, active.attitude.y, active.attitude.z);
+
+  double attitude_error = 0;
+
+  if (q_shadow.squaredNorm() > 1e-6 && q_active.squaredNorm() > 1e-6) {
+    attitude_error = q_shadow.normalized().angularDistance(q_active.normalized());
+  }
+
+  divergence_.attitude_sum += attitude_error;
+  divergence_.attitude_max = std::max(divergence_.attitude_max, attitude_error);
+
+  // | ------------------------- thrust ------------------------- |
+
+  double thrust_error = fabs(output->thrust - active.thrust);
+
+  divergence_.thrust_sum += thrust_error;
+  divergence_.thrust_max = std::max(divergence_.thrust_max, thrust_error);
+
+  // | ---------------------- attitude rate --------------------- |
+
+  if (output->mode_mask == output->MODE_ATTITUDE_RATE && active.mode_mask == active.MODE_ATTITUDE_RATE) {
+
+    Eigen::Vector3d rate_error(output->attitude_rate.x - active.attitude_rate.x, output->attitude_rate.y - active.attitude_rate.y,
+                               output->attitude_rate.z - active.attitude_rate.z);
+
+    divergence_.n_rate_outputs++;
+    divergence_.rate_sum += rate_error.norm();
+    divergence_.rate_max = std::max(divergence_.rate_max, rate_error.norm());
+  }
+}
+
+//}
+
+/* logDivergence() //{ */
+
+void ShadowMode::logDivergence(void) {
+
+  uint64_t n_dropped   = n_dropped_;
+  uint64_t n_unmatched = n_unmatched_;
+
+  const Divergence_t& d = divergence_;
+
+  if (d.n_frames > 0) {
+
+    double n_outputs      = double(std::max(d.n_outputs, uint64_t(1)));
+    double n_rate_outputs = double(std::max(d.n_rate_outputs, uint64_t(1)));
+
+    ROS_INFO(
+        "[%s]: shadow: %lu frames, %lu dropped, %lu unmatched, %lu abandoned, %lu without output, divergence from the active controller (mean/max): "
+        "attitude %.2f/%.2f deg, thrust %.3f/%.3f, attitude rate %.3f/%.3f rad/s, lag %.1f/%.1f ms",
+        name_.c_str(), (unsigned long)d.n_frames, (unsigned long)(n_dropped - last_n_dropped_), (unsigned long)(n_unmatched - last_n_unmatched_),
+        (unsigned long)d.n_abandoned, (unsigned long)(d.n_frames - d.n_outputs), (d.attitude_sum / n_outputs) * 180.0 / M_PI,
+        d.attitude_max * 180.0 / M_PI, d.thrust_sum / n_outputs, d.thrust_max, d.rate_sum / n_rate_outputs, d.rate_max,
+        1000.0 * d.lag_sum / double(d.n_frames), 1000.0 * d.lag_max);
+  }
+
+  divergence_       = Divergence_t();
+  last_n_dropped_   = n_dropped;
+  last_n_unmatched_ = n_unmatched;
+  last_log_time_    = ros::WallTime::now();
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,206 @@
+#include <mrs_uav_controllers/common/state_predictor.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace common
+{
+
+/* propagate() //{ */
+
+// constant acceleration and attitude rate over the step
+void propagate(const double dt, const Eigen::Vector3d& acceleration, const Eigen::Vector3d& attitude_rate, Eigen::Vector3d& position,
+               Eigen::Vector3d& velocity, Eigen::Quaterniond& orientation) {
+
+  position += velocity * dt + 0.5 * acceleration * dt * dt;
+  velocity += acceleration * dt;
+
+  double angle = attitude_rate.norm() * dt;
+
+  if (angle > 1e-9) {
+    orientation = orientation * Eigen::Quaterniond(Eigen::AngleAxisd(angle, attitude_rate.normalized()));
+    orientation.normalize();
+  }
+}
+
+//}
+
+/* measuredState() //{ */
+
+PredictedState_t measuredState(const mrs_msgs::UavState& uav_state) {
+
+  PredictedState_t state;
+
+  state.position << uav_state.pose.position.x, uav_state.pose.position.y, uav_state.pose.position.z;
+  state.velocity << uav_state.velocity.linear.x, uav_state.velocity.linear.y, uav_state.velocity.linear.z;
+  state.acceleration << uav_state.acceleration.linear.x, uav_state.acceleration.linear.y, uav_state.acceleration.linear.z;
+  state.attitude_rate << uav_state.velocity.angular.x, uav_state.velocity.angular.y, uav_state.velocity.angular.z;
+
+  state.orientation = Eigen::Quaterniond(uav_state.pose.orientation.w, uav_state.pose.orientation.x, uav_state.pose.orientation.y, uav_state.pose.orientation.z);
+
+  if (state.orientation.norm() > 1e-6) {
+    state.orientation.normalize();
+  }
+
+  return state;
+}
+
+//}
+
+/* StatePredictor() //{ */
+
+StatePredictor::StatePredictor(const StatePredictorParams_t& params) : params_(params) {
+
+  history_.resize(std::max(params_.history_length, 1));
+}
+
+//}
+
+/* addCommand() //{ */
+
+void StatePredictor::addCommand(const ros::Time& stamp, const Eigen::Vector3d& acceleration, const Eigen::Vector3d& attitude_rate) {
+
+  if (!params_.enabled || !acceleration.allFinite() || !attitude_rate.allFinite()) {
+    return;
+  }
+
+  std::scoped_lock lock(mutex_history_);
+
+  // the time has to be monotonic, e.g., the simulation could have been restarted
+  if (size_ > 0 && stamp < getRecord(size_ - 1).stamp) {
+    size_ = 0;
+  }
+
+  history_[head_].stamp         = stamp;
+  history_[head_].acceleration  = acceleration;
+  history_[head_].attitude_rate = attitude_rate;
+
+  head_ = (head_ + 1) % int(history_.size());
+  size_ = std::min(size_ + 1, int(history_.size()));
+}
+
+//}
+
+/* reset() //{ */
+
+void StatePredictor::reset(void) {
+
+  std::scoped_lock lock(mutex_history_);
+
+  size_ = 0;
+}
+
+//}
+
+/* predict() //{ */
+
+PredictedState_t StatePredictor::predict(const mrs_msgs::UavState& uav_state, const ros::Time& now) {
+
+  PredictedState_t measured = measuredState(uav_state);
+
+  if (!params_.enabled) {
+    return measured;
+  }
+
+  std::scoped_lock lock(mutex_history_);
+
+  double delay = params_.measure_delay ? (now - uav_state.header.stamp).toSec() : params_.fixed_delay;
+
+  delay = std::clamp(delay + params_.actuation_delay, 0.0, params_.max_delay);
+
+  last_delay_ = delay;
+
+  if (delay <= 0 || size_ == 0) {
+    return measured;
+  }
+
+  if (!measured.position.allFinite() || !measured.velocity.allFinite() || !(fabs(measured.orientation.norm() - 1.0) < 1e-6)) {
+    return measured;
+  }
+
+  Eigen::Vector3d    position      = measured.position;
+  Eigen::Vector3d    velocity      = measured.velocity;
+  Eigen::Vector3d    acceleration  = measured.acceleration;
+  Eigen::Vector3d    attitude_rate = measured.attitude_rate;
+  Eigen::Quaterniond orientation   = measured.orientation;
+
+  ros::Time time   = uav_state.header.stamp;
+  ros::Time target = uav_state.header.stamp + ros::Duration(delay);
+
+  // | ---- before the oldest command, the measured state is used ---- |
+
+  if (getRecord(0).stamp > time) {
+
+    ros::Time until = std::min(getRecord(0).stamp, target);
+
+    if (acceleration.allFinite() && attitude_rate.allFinite()) {
+      propagate((until - time).toSec(), acceleration, attitude_rate, position, velocity, orientation);
+    } else {
+      propagate((until - time).toSec(), Eigen::Vector3d::Zero(), Eigen::Vector3d::Zero(), position, velocity, orientation);
+    }
+
+    time = until;
+  }
+
+  // | ------- then the commands which were active meanwhile ------- |
+
+  for (int i = 0; i < size_ && time < target; i++) {
+
+    const CommandRecord_t& record = getRecord(i);
+
+    // the command is active until the next one comes, the newest one until the target time
+    ros::Time end = i + 1 < size_ ? std::min(getRecord(i + 1).stamp, target) : target;
+
+    if (end <= time) {
+      continue;
+    }
+
+    propagate((end - time).toSec(), record.acceleration, record.attitude_rate, position, velocity, orientation);
+
+    acceleration  = record.acceleration;
+    attitude_rate = record.attitude_rate;
+
+    time = end;
+  }
+
+  PredictedState_t predicted;
+
+  predicted.position      = position;
+  predicted.velocity      = velocity;
+  predicted.acceleration  = acceleration;
+  predicted.orientation   = orientation;
+  predicted.attitude_rate = attitude_rate;
+
+  return predicted;
+}
+
+//}
+
+/* getLastDelay() //{ */
+
+double StatePredictor::getLastDelay(void) {
+
+  std::scoped_lock lock(mutex_history_);
+
+  return last_delay_;
+}
+
+//}
+
+/* getRecord() //{ */
+
+const StatePredictor::CommandRecord_t& StatePredictor::getRecord(const int i) const {
+
+  int n = int(history_.size());
+
+  return history_[(head_ - size_ + i + n) % n];
+}
+
+//}
+
+}  // namespace common
+
+}  // namespace mrs_uav_controllers
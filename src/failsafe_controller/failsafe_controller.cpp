@@ -10,6 +10,11 @@
 #include <mrs_lib/param_loader.h>
 #include <mrs_lib/attitude_converter.h>
 
+#include <mrs_uav_controllers/common/controller_health.h>
+#include <mrs_uav_controllers/common/tracing.h>
+
+#include <chrono>
+
 //}
 
 namespace mrs_uav_controllers
@@ -71,6 +76,10 @@ private:
   ros::Time last_update_time_;
   bool      first_iteration_ = true;
 
+  // | ------------------------- health ------------------------- |
+
+  std::unique_ptr<common::ControllerHealth> health_;
+
   // | ------------------------ profiler ------------------------ |
 
   mrs_lib::Profiler profiler_;
@@ -85,8 +94,8 @@ private:
 
 /* initialize() //{ */
 
-void FailsafeController::initialize(const ros::NodeHandle &parent_nh, [[maybe_unused]] const std::string name, const std::string name_space,
-                                    const double uav_mass, std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
+void FailsafeController::initialize(const ros::NodeHandle &parent_nh, const std::string name, const std::string name_space, const double uav_mass,
+                                    std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
 
   ros::NodeHandle nh_(parent_nh, name_space);
 
@@ -111,6 +120,11 @@ void FailsafeController::initialize(const ros::NodeHandle &parent_nh, [[maybe_un
   param_loader.loadParam("enable_profiler", _profiler_enabled_);
   param_loader.loadParam("initial_thrust_percentage", _initial_thrust_percentage_);
 
+  common::ControllerHealthParams_t health;
+
+  param_loader.loadParam("diagnostics/rate", health.rate);
+  param_loader.loadParam("diagnostics/max_update_time", health.max_update_time);
+
   if (!param_loader.loadedSuccessfully()) {
     ROS_ERROR("[FailsafeController]: Could not load all parameters!");
     ros::shutdown();
@@ -122,6 +136,12 @@ void FailsafeController::initialize(const ros::NodeHandle &parent_nh, [[maybe_un
 
   hover_thrust_ = mrs_lib::quadratic_thrust_model::forceToThrust(common_handlers_->motor_params, _uav_mass_ * common_handlers_->g);
 
+  // | ------------------------- health ------------------------- |
+
+  health_ = std::make_unique<common::ControllerHealth>(name, std::vector<std::string>{}, health);
+
+  health_->advertise(nh_);
+
   // | ------------------------ profiler ------------------------ |
 
   profiler_ = mrs_lib::Profiler(nh_, "FailsafeController", _profiler_enabled_);
@@ -139,6 +159,8 @@ void FailsafeController::initialize(const ros::NodeHandle &parent_nh, [[maybe_un
 
 bool FailsafeController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &last_attitude_cmd) {
 
+  CONTROLLER_TRACE1(activate, "FailsafeController");
+
   std::scoped_lock lock(mutex_hover_thrust_);
 
   if (last_attitude_cmd == mrs_msgs::AttitudeCommand::Ptr()) {
@@ -179,6 +201,8 @@ bool FailsafeController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &las
 
 void FailsafeController::deactivate(void) {
 
+  CONTROLLER_TRACE1(deactivate, "FailsafeController");
+
   is_active_           = false;
   first_iteration_     = false;
   uav_mass_difference_ = 0;
@@ -202,6 +226,11 @@ const mrs_msgs::AttitudeCommand::ConstPtr FailsafeController::update([[maybe_unu
   mrs_lib::Routine    profiler_routine = profiler_.createRoutine("update");
   mrs_lib::ScopeTimer timer = mrs_lib::ScopeTimer("FailsafeController::update", common_handlers_->scope_timer.logger, common_handlers_->scope_timer.enabled);
 
+  common::UpdateTrace update_trace("FailsafeController");
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_UPDATE);
+
+  auto update_start = std::chrono::steady_clock::now();
+
   if (!is_active_) {
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
@@ -276,6 +305,8 @@ const mrs_msgs::AttitudeCommand::ConstPtr FailsafeController::update([[maybe_unu
 
   output_command->controller = "FailsafeController";
 
+  health_->addUpdate(update_start, 0);
+
   last_attitude_cmd_ = output_command;
 
   return output_command;
@@ -299,6 +330,8 @@ const mrs_msgs::ControllerStatus FailsafeController::getStatus() {
 /* switchOdometrySource() //{ */
 
 void FailsafeController::switchOdometrySource([[maybe_unused]] const mrs_msgs::UavState::ConstPtr &new_uav_state) {
+
+  CONTROLLER_TRACE2(switch_odometry_source, "FailsafeController", new_uav_state->header.frame_id.c_str());
 }
 
 //}
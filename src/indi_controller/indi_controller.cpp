@@ -0,0 +1,814 @@
+#define VERSION "1.0.2.0"
+
+/* includes //{ */
+
+#include <ros/ros.h>
+
+#include <mrs_uav_managers/controller.h>
+
+#include <mrs_uav_controllers/indi_controller/indi_core.h>
+
+#include <mrs_uav_controllers/common/flight_recorder_utils.h>
+#include <mrs_uav_controllers/common/controller_health.h>
+#include <mrs_uav_controllers/common/tracing.h>
+#include <mrs_uav_controllers/common/high_rate.h>
+#include <mrs_uav_controllers/common/attitude_math.h>
+#include <mrs_uav_controllers/common/shadow_mode.h>
+
+#include <mrs_lib/profiler.h>
+#include <mrs_lib/param_loader.h>
+#include <mrs_lib/utils.h>
+#include <mrs_lib/mutex.h>
+#include <mrs_lib/attitude_converter.h>
+
+#include <geometry_msgs/Vector3Stamped.h>
+
+#include <chrono>
+
+//}
+
+namespace mrs_uav_controllers
+{
+
+namespace indi_controller
+{
+
+/* //{ class IndiController */
+
+class IndiController : public mrs_uav_managers::Controller {
+
+public:
+  ~IndiController(){};
+
+  void initialize(const ros::NodeHandle& parent_nh, const std::string name, const std::string name_space, const double uav_mass,
+                  std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers);
+  bool activate(const mrs_msgs::AttitudeCommand::ConstPtr& last_attitude_cmd);
+  void deactivate(void);
+
+  const mrs_msgs::AttitudeCommand::ConstPtr update(const mrs_msgs::UavState::ConstPtr& uav_state, const mrs_msgs::PositionCommand::ConstPtr& control_reference);
+  const mrs_msgs::ControllerStatus          getStatus();
+
+  void switchOdometrySource(const mrs_msgs::UavState::ConstPtr& new_uav_state);
+
+  void resetDisturbanceEstimators(void);
+
+  const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr setConstraints(const mrs_msgs::DynamicsConstraintsSrvRequest::ConstPtr& cmd);
+
+private:
+  std::string _version_;
+
+  bool is_initialized_ = false;
+  bool is_active_      = false;
+
+  std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers_;
+
+  // | ------------------------ uav state ----------------------- |
+
+  // the last state, swapped atomically (boost::atomic_store/load) instead of copied under a mutex
+  mrs_msgs::UavState::ConstPtr uav_state_;
+
+  // | ----------------------- constraints ---------------------- |
+
+  mrs_msgs::DynamicsConstraints constraints_;
+  std::mutex                    mutex_constraints_;
+  bool                          got_constraints_ = false;
+
+  // | -------------------------- INDI -------------------------- |
+
+  std::unique_ptr<IndiCore> indi_core_;
+
+  IndiState_t     indi_state_;
+  IndiReference_t indi_reference_;
+  IndiOutput_t    indi_output_;
+
+  double _uav_mass_;
+  double uav_mass_difference_;
+
+  // | --------------------- flight recorder -------------------- |
+
+  std::unique_ptr<common::FlightRecorder> flight_recorder_;
+  common::FlightRecord_t                  flight_record_;
+
+  // | ------------------------- health ------------------------- |
+
+  std::unique_ptr<common::ControllerHealth> health_;
+
+  // | ------------ controller limits and saturations ----------- |
+
+  bool   _tilt_angle_failsafe_enabled_;
+  double _tilt_angle_failsafe_;
+
+  double _thrust_saturation_;
+
+  // | ------------------ activation and output ----------------- |
+
+  mrs_msgs::AttitudeCommand::ConstPtr last_attitude_cmd_;
+  mrs_msgs::AttitudeCommand           activation_attitude_cmd_;
+
+  ros::Time last_update_time_;
+  bool      first_iteration_ = true;
+
+  double last_uav_heading_ = 0;  // the fallback when the heading is singular
+
+  // | ---------------- high-rate odometry, 1 kHz ---------------- |
+
+  common::HighRateParams_t _high_rate_;
+  double                   _min_dt_;  // [s] the closer odometry is skipped
+
+  common::Decimator transform_decimator_;
+
+  // | ------------------------ profiler_ ------------------------ |
+
+  mrs_lib::Profiler profiler_;
+  bool              _profiler_enabled_ = false;
+
+  // | ----------------------- shadow mode ---------------------- |
+
+  // the copy of the controller evaluated by the shadow mode, initialized from the same params without any ROS I/O,
+  // it is updated only by the shadow worker, the control manager never sees it
+  bool                            shadow_instance_ = false;
+  std::unique_ptr<IndiController> shadow_controller_;
+
+  const mrs_msgs::AttitudeCommand::ConstPtr updateShadow(const common::ShadowFrame_t& frame);
+
+  // the last member, its worker is joined before the copy it updates is destroyed
+  std::unique_ptr<common::ShadowMode> shadow_mode_;
+};
+
+//}
+
+// --------------------------------------------------------------
+// |                   controller's interface                   |
+// --------------------------------------------------------------
+
+/* //{ initialize() */
+
+void IndiController::initialize(const ros::NodeHandle& parent_nh, const std::string name, const std::string name_space, const double uav_mass,
+                                std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
+
+  ros::NodeHandle nh_(parent_nh, name_space);
+
+  common_handlers_ = common_handlers;
+  _uav_mass_       = uav_mass;
+
+  ros::Time::waitForValid();
+
+  // | ------------------- loading parameters ------------------- |
+
+  mrs_lib::ParamLoader param_loader(nh_, "IndiController");
+
+  param_loader.loadParam("version", _version_);
+
+  if (_version_ != VERSION) {
+
+    ROS_ERROR("[IndiController]: the version of the binary (%s) does not match the config file (%s), please build me!", VERSION, _version_.c_str());
+    ros::shutdown();
+  }
+
+  param_loader.loadParam("enable_profiler", _profiler_enabled_);
+
+  IndiParams_t params;
+  double       kpxy, kvxy, kpz, kvz, kqxy, kqz;
+
+  param_loader.loadParam("gains/horizontal/kp", kpxy);
+  param_loader.loadParam("gains/horizontal/kv", kvxy);
+  param_loader.loadParam("gains/vertical/kp", kpz);
+  param_loader.loadParam("gains/vertical/kv", kvz);
+  param_loader.loadParam("gains/attitude/kqxy", kqxy);
+  param_loader.loadParam("gains/attitude/kqz", kqz);
+
+  param_loader.loadParam("indi/filter_cutoff", params.filter_cutoff);
+  param_loader.loadParam("indi/max_increment", params.max_increment);
+
+  param_loader.loadParam("constraints/tilt_angle_failsafe/enabled", _tilt_angle_failsafe_enabled_);
+  param_loader.loadParam("constraints/tilt_angle_failsafe/limit", _tilt_angle_failsafe_);
+  param_loader.loadParam("constraints/thrust_saturation", _thrust_saturation_);
+
+  bool        flight_recorder_enabled;
+  std::string flight_recorder_directory;
+  int         flight_recorder_capacity;
+
+  param_loader.loadParam("flight_recorder/enabled", flight_recorder_enabled);
+  param_loader.loadParam("flight_recorder/directory", flight_recorder_directory);
+  param_loader.loadParam("flight_recorder/capacity", flight_recorder_capacity);
+
+  common::ControllerHealthParams_t health;
+
+  param_loader.loadParam("diagnostics/rate", health.rate);
+  param_loader.loadParam("diagnostics/max_update_time", health.max_update_time);
+
+  // high-rate odometry
+  param_loader.loadParam("high_rate/enabled", _high_rate_.enabled);
+  param_loader.loadParam("high_rate/min_dt", _high_rate_.min_dt);
+  param_loader.loadParam("high_rate/transform_decimation", _high_rate_.transform_decimation);
+  param_loader.loadParam("high_rate/update_budget", _high_rate_.update_budget);
+
+  // shadow mode
+  common::ShadowModeParams_t shadow;
+
+  param_loader.loadParam("shadow_mode/enabled", shadow.enabled);
+  param_loader.loadParam("shadow_mode/queue_size", shadow.queue_size);
+  param_loader.loadParam("shadow_mode/log_period", shadow.log_period);
+  param_loader.loadParam("shadow_mode/max_stamp_offset", shadow.max_stamp_offset);
+  param_loader.loadParam("shadow_mode/cpus", shadow.cpus);
+
+  if (_tilt_angle_failsafe_enabled_ && fabs(_tilt_angle_failsafe_) < 1e-3) {
+    ROS_ERROR("[IndiController]: constraints/tilt_angle_failsafe/enabled = 'TRUE' but the limit is too low");
+    ros::shutdown();
+  }
+
+  if (!param_loader.loadedSuccessfully()) {
+    ROS_ERROR("[IndiController]: could not load all parameters!");
+    ros::shutdown();
+  }
+
+  // | ---------------- prepare stuff from params --------------- |
+
+  if (params.filter_cutoff <= 0) {
+    ROS_ERROR("[IndiController]: indi/filter_cutoff has to be positive!");
+    ros::shutdown();
+  }
+
+  params.g        = common_handlers_->g;
+  params.kp       = Eigen::Vector3d(kpxy, kpxy, kpz);
+  params.kv       = Eigen::Vector3d(kvxy, kvxy, kvz);
+  params.kq       = Eigen::Vector3d(kqxy, kqxy, kqz);
+  params.max_tilt = 0;
+
+  indi_core_ = std::make_unique<IndiCore>(params);
+
+  if (flight_recorder_enabled && !shadow_instance_) {
+
+    std::string path = common::getFlightRecorderPath(flight_recorder_directory, name);
+
+    flight_recorder_ = std::make_unique<common::FlightRecorder>(path, size_t(std::max(flight_recorder_capacity, 1)), "IndiController");
+
+    if (flight_recorder_->isOpen()) {
+      ROS_INFO("[IndiController]: recording the flight into '%s'", path.c_str());
+    } else {
+      ROS_ERROR("[IndiController]: could not open the flight recorder: %s", flight_recorder_->getError().c_str());
+      flight_recorder_.reset();
+    }
+  }
+
+  uav_mass_difference_ = 0;
+
+  // | ------------------ high-rate odometry ------------------- |
+
+  if (_high_rate_.enabled) {
+
+    _min_dt_             = _high_rate_.min_dt;
+    transform_decimator_ = common::Decimator(_high_rate_.transform_decimation);
+
+    health.max_update_time = _high_rate_.update_budget;
+
+    ROS_INFO("[IndiController]: high-rate odometry: min dt %.4f s, transforms on every %d. update, budget %.1f us", _min_dt_,
+             transform_decimator_.getPeriod(), 1e6 * _high_rate_.update_budget);
+
+  } else {
+
+    _min_dt_ = 0.001;
+  }
+
+  health_ = std::make_unique<common::ControllerHealth>(name, std::vector<std::string>{}, health);
+
+  // the copy for the shadow mode ends here
+  if (shadow_instance_) {
+
+    profiler_ = mrs_lib::Profiler(nh_, "IndiController", false);
+
+    is_initialized_ = true;
+    return;
+  }
+
+  // | ----------------------- publishers ----------------------- |
+
+  health_->advertise(nh_);
+
+  // | ------------------------ profiler ------------------------ |
+
+  profiler_ = mrs_lib::Profiler(nh_, "IndiController", _profiler_enabled_);
+
+  // | ----------------------- shadow mode ---------------------- |
+
+  if (shadow.enabled) {
+
+    shadow_controller_                   = std::make_unique<IndiController>();
+    shadow_controller_->shadow_instance_ = true;
+    shadow_controller_->initialize(parent_nh, name, name_space, uav_mass, common_handlers);
+
+    shadow_mode_ = std::make_unique<common::ShadowMode>(name, shadow, [this](const common::ShadowFrame_t& frame) { return updateShadow(frame); });
+    shadow_mode_->start(nh_);
+
+    // the controller is loaded inactive
+    shadow_mode_->resume();
+  }
+
+  // | ----------------------- finish init ---------------------- |
+
+  ROS_INFO("[IndiController]: initialized, version %s", VERSION);
+
+  is_initialized_ = true;
+}
+
+//}
+
+/* //{ activate() */
+
+bool IndiController::activate(const mrs_msgs::AttitudeCommand::ConstPtr& last_attitude_cmd) {
+
+  CONTROLLER_TRACE1(activate, "IndiController");
+
+  // the copy of the shadow mode, activated by its worker
+  const bool shadow = shadow_instance_;
+
+  if (last_attitude_cmd == mrs_msgs::AttitudeCommand::Ptr()) {
+
+    ROS_WARN("[IndiController]: activated without getting the last controller's command");
+
+    // the controller stays inactive, the shadow evaluation goes on
+    return false;
+  }
+
+  activation_attitude_cmd_ = *last_attitude_cmd;
+  uav_mass_difference_     = last_attitude_cmd->mass_difference;
+
+  activation_attitude_cmd_.controller_enforcing_constraints = false;
+
+  // the filters start from the force which is being applied
+  {
+    auto uav_state = boost::atomic_load(&uav_state_);
+
+    // level, if there has not been any odometry yet
+    Eigen::Matrix3d R = Eigen::Matrix3d::Identity();
+
+    if (uav_state) {
+
+      const auto& q = uav_state->pose.orientation;
+
+      if (q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w > 0.5) {
+        R = mrs_lib::AttitudeConverter(q);
+      }
+    }
+
+    double thrust_force = mrs_lib::quadratic_thrust_model::thrustToForce(common_handlers_->motor_params, last_attitude_cmd->thrust);
+
+    indi_core_->reset(_uav_mass_ + uav_mass_difference_, thrust_force, R);
+  }
+
+  first_iteration_ = true;
+
+  transform_decimator_.reset();
+
+  // does not wait, the copy keeps evaluating the frame it has, its output is dropped
+  if (shadow_mode_) {
+    shadow_mode_->pause();
+  }
+
+  ROS_INFO("[IndiController]: activated %s, mass difference %.2f kg", shadow ? "in the shadow mode" : "with a last controller's command",
+           uav_mass_difference_);
+
+  is_active_ = true;
+
+  return true;
+}
+
+//}
+
+/* //{ deactivate() */
+
+void IndiController::deactivate(void) {
+
+  CONTROLLER_TRACE1(deactivate, "IndiController");
+
+  is_active_           = false;
+  first_iteration_     = false;
+  uav_mass_difference_ = 0;
+
+  ROS_INFO("[IndiController]: deactivated");
+
+  if (shadow_mode_) {
+    shadow_mode_->resume();
+  }
+}
+
+//}
+
+/* //{ update() */
+
+const mrs_msgs::AttitudeCommand::ConstPtr IndiController::update(const mrs_msgs::UavState::ConstPtr&        uav_state,
+                                                                 const mrs_msgs::PositionCommand::ConstPtr& control_reference) {
+
+  mrs_lib::Routine    profiler_routine = profiler_.createRoutine("update");
+  mrs_lib::ScopeTimer timer = mrs_lib::ScopeTimer("IndiController::update", common_handlers_->scope_timer.logger, common_handlers_->scope_timer.enabled);
+
+  // the copy of the shadow mode, without any output or record
+  const bool shadow = shadow_instance_;
+
+  common::UpdateTrace update_trace("IndiController");
+  common::CpuTimeScope cpu_time_scope(*health_, shadow ? common::CPU_BACKGROUND : common::CPU_UPDATE);
+
+  auto update_start = std::chrono::steady_clock::now();
+
+  boost::atomic_store(&uav_state_, uav_state);
+
+  if (!is_active_) {
+
+    // the same inputs as the active controller has in this iteration
+    if (shadow_mode_) {
+      shadow_mode_->addInputs(uav_state, control_reference);
+    }
+
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  if (control_reference == mrs_msgs::PositionCommand::Ptr()) {
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  // | -------------------- calculate the dt -------------------- |
+
+  if (first_iteration_) {
+
+    last_update_time_ = uav_state->header.stamp;
+
+    first_iteration_ = false;
+
+    ROS_INFO("[IndiController]: first iteration");
+
+    return mrs_msgs::AttitudeCommand::ConstPtr(new mrs_msgs::AttitudeCommand(activation_attitude_cmd_));
+  }
+
+  std::optional<double> odometry_dt = common::odometryDt(uav_state->header.stamp, last_update_time_, _min_dt_);
+
+  if (!odometry_dt) {
+
+    ROS_DEBUG("[IndiController]: the last odometry message came too close or out of order, skipping it");
+
+    if (last_attitude_cmd_ != mrs_msgs::AttitudeCommand::Ptr()) {
+      return last_attitude_cmd_;
+    } else {
+      return mrs_msgs::AttitudeCommand::ConstPtr(new mrs_msgs::AttitudeCommand(activation_attitude_cmd_));
+    }
+  }
+
+  double dt = odometry_dt.value();
+
+  flight_record_ = common::FlightRecord_t();
+
+  // at high rates, the transformer is queried only on every n-th update, the orientation of the UAV state is used in between
+  bool lookup_transforms = transform_decimator_.tick();
+
+  // | --------------------- fill the state --------------------- |
+
+  indi_state_.position << uav_state->pose.position.x, uav_state->pose.position.y, uav_state->pose.position.z;
+  indi_state_.velocity << uav_state->velocity.linear.x, uav_state->velocity.linear.y, uav_state->velocity.linear.z;
+  indi_state_.acceleration << uav_state->acceleration.linear.x, uav_state->acceleration.linear.y, uav_state->acceleration.linear.z;
+  indi_state_.R = mrs_lib::AttitudeConverter(uav_state->pose.orientation);
+
+  std::optional<double> heading = common::getHeading(indi_state_.R);
+
+  if (heading) {
+    last_uav_heading_ = heading.value();
+  } else {
+    flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+    ROS_ERROR_THROTTLE(1.0, "[IndiController]: could not calculate the UAV heading, using the last one");
+  }
+
+  double uav_heading = last_uav_heading_;
+
+  // | ------------------- fill the reference ------------------- |
+
+  indi_reference_.position << control_reference->position.x, control_reference->position.y, control_reference->position.z;
+  indi_reference_.velocity << control_reference->velocity.x, control_reference->velocity.y, control_reference->velocity.z;
+  indi_reference_.acceleration << control_reference->acceleration.x, control_reference->acceleration.y, control_reference->acceleration.z;
+
+  indi_reference_.use_position << double(control_reference->use_position_horizontal), double(control_reference->use_position_horizontal),
+      double(control_reference->use_position_vertical);
+
+  // even when use_position_vertical to provide dampening
+  indi_reference_.use_velocity << double(control_reference->use_velocity_horizontal), double(control_reference->use_velocity_horizontal),
+      double(control_reference->use_velocity_vertical || control_reference->use_position_vertical);
+
+  indi_reference_.use_acceleration = Eigen::Vector3d::Constant(double(control_reference->use_acceleration));
+
+  if (control_reference->use_heading) {
+    indi_reference_.heading = control_reference->heading;
+  } else {
+    ROS_ERROR_THROTTLE(1.0, "[IndiController]: desired heading was not specified, using current heading instead!");
+    indi_reference_.heading = uav_heading;
+  }
+
+  indi_reference_.attitude_rate = Eigen::Vector3d::Zero();
+
+  if (control_reference->use_heading_rate) {
+
+    std::optional<double> desired_yaw_rate = common::getYawRateIntrinsic(indi_state_.R, control_reference->heading_rate);
+
+    if (desired_yaw_rate) {
+      indi_reference_.attitude_rate[2] = desired_yaw_rate.value();
+    } else {
+      flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+      ROS_ERROR_THROTTLE(1.0, "[IndiController]: could not calculate the desired_yaw_rate feedforward, skipping it");
+    }
+  }
+
+  // | ------------------------- the tilt ------------------------ |
+
+  {
+    auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
+
+    IndiParams_t params = indi_core_->getParams();
+
+    params.max_tilt = fabs(constraints.tilt) > 1e-3 ? constraints.tilt : 0.0;
+
+    indi_core_->setParams(params);
+  }
+
+  // | ----------------------- the control ---------------------- |
+
+  double total_mass = _uav_mass_ + uav_mass_difference_;
+
+  if (!indi_core_->update(indi_state_, indi_reference_, total_mass, dt, indi_output_)) {
+
+    ROS_ERROR("[IndiController]: NaN detected in the output, returning null");
+
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  if (flight_recorder_) {
+
+    flight_record_.dt    = dt;
+    flight_record_.theta = acos(indi_output_.force.normalized()[2]);
+
+    common::recordState(flight_record_, *uav_state);
+    common::recordReference(flight_record_, *control_reference);
+    common::recordVector(flight_record_.attitude_rate_feedforward, indi_reference_.attitude_rate);
+  }
+
+  if (indi_output_.tilt_saturated) {
+    flight_record_.flags |= FLIGHT_RECORD_TILT_SATURATED;
+    ROS_WARN_THROTTLE(1.0, "[IndiController]: tilt is being saturated to %.2f deg", (indi_core_->getParams().max_tilt / M_PI) * 180.0);
+  }
+
+  if (_tilt_angle_failsafe_enabled_) {
+
+    double theta = acos(indi_output_.force.normalized()[2]);
+
+    if (theta > _tilt_angle_failsafe_) {
+
+      ROS_ERROR("[IndiController]: the produced tilt angle (%.2f deg) would be over the failsafe limit (%.2f deg), returning null", (180.0 / M_PI) * theta,
+                (180.0 / M_PI) * _tilt_angle_failsafe_);
+
+      flight_record_.flags |= FLIGHT_RECORD_TILT_FAILSAFE | FLIGHT_RECORD_NULL_OUTPUT;
+
+      if (!shadow) {
+
+        if (flight_recorder_) {
+          flight_recorder_->write(flight_record_);
+        }
+
+        health_->addUpdate(update_start, flight_record_.flags);
+      }
+
+      return mrs_msgs::AttitudeCommand::ConstPtr();
+    }
+  }
+
+  // | ----------------------- the thrust ----------------------- |
+
+  double thrust = 0;
+
+  if (control_reference->use_thrust) {
+    thrust = control_reference->thrust;
+  } else {
+    thrust = mrs_lib::quadratic_thrust_model::forceToThrust(common_handlers_->motor_params, indi_output_.thrust_force);
+  }
+
+  if (!std::isfinite(thrust)) {
+
+    thrust = 0;
+    ROS_ERROR("[IndiController]: NaN detected in variable 'thrust', setting it to 0!!!");
+
+  } else if (thrust > _thrust_saturation_) {
+
+    thrust = _thrust_saturation_;
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
+    ROS_WARN_THROTTLE(0.1, "[IndiController]: saturating thrust to %.2f", _thrust_saturation_);
+
+  } else if (thrust < 0.0) {
+
+    thrust = 0.0;
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
+    ROS_WARN_THROTTLE(0.1, "[IndiController]: saturating thrust to 0");
+  }
+
+  // the filter of the applied force has to see what is really applied
+  indi_core_->setAppliedThrustForce(mrs_lib::quadratic_thrust_model::thrustToForce(common_handlers_->motor_params, thrust));
+
+  // | --------------- saturate the attitude rate --------------- |
+
+  Eigen::Vector3d t = indi_output_.attitude_rate;
+
+  if (got_constraints_) {
+
+    auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
+
+    if (fabs(t[0]) > constraints.roll_rate || fabs(t[1]) > constraints.pitch_rate || fabs(t[2]) > constraints.yaw_rate) {
+      flight_record_.flags |= FLIGHT_RECORD_RATE_SATURATED;
+    }
+
+    t[0] = std::clamp(t[0], -constraints.roll_rate, constraints.roll_rate);
+    t[1] = std::clamp(t[1], -constraints.pitch_rate, constraints.pitch_rate);
+    t[2] = std::clamp(t[2], -constraints.yaw_rate, constraints.yaw_rate);
+
+  } else {
+    ROS_WARN_THROTTLE(1.0, "[IndiController]: missing dynamics constraints");
+  }
+
+  // --------------------------------------------------------------
+  // |                 produce the control output                 |
+  // --------------------------------------------------------------
+
+  mrs_msgs::AttitudeCommand::Ptr output_command(new mrs_msgs::AttitudeCommand);
+  output_command->header.stamp = ros::Time::now();
+
+  // | ------------ compensated desired acceleration ------------ |
+
+  {
+    Eigen::Vector3d world_accel = indi_output_.force / total_mass - Eigen::Vector3d(0, 0, common_handlers_->g);
+
+    if (!lookup_transforms) {
+
+      Eigen::Vector3d body_accel = indi_state_.R.transpose() * world_accel;
+
+      output_command->desired_acceleration.x = body_accel[0];
+      output_command->desired_acceleration.y = body_accel[1];
+      output_command->desired_acceleration.z = body_accel[2];
+
+    } else {
+
+      geometry_msgs::Vector3Stamped world_accel_stamped;
+
+      world_accel_stamped.header.stamp    = ros::Time::now();
+      world_accel_stamped.header.frame_id = uav_state->header.frame_id;
+      world_accel_stamped.vector.x        = world_accel[0];
+      world_accel_stamped.vector.y        = world_accel[1];
+      world_accel_stamped.vector.z        = world_accel[2];
+
+      CONTROLLER_TRACE1(transform_entry, "IndiController");
+      auto res = common_handlers_->transformer->transformSingle(world_accel_stamped, "fcu");
+      CONTROLLER_TRACE2(transform_exit, "IndiController", bool(res));
+
+      if (res) {
+        output_command->desired_acceleration.x = res.value().vector.x;
+        output_command->desired_acceleration.y = res.value().vector.y;
+        output_command->desired_acceleration.z = res.value().vector.z;
+      }
+    }
+  }
+
+  // | --------------- fill the resulting command --------------- |
+
+  output_command->attitude = mrs_lib::AttitudeConverter(indi_output_.Rd);
+
+  output_command->attitude_rate.x = t[0];
+  output_command->attitude_rate.y = t[1];
+  output_command->attitude_rate.z = t[2];
+
+  output_command->mode_mask = output_command->MODE_ATTITUDE_RATE;
+
+  output_command->thrust = thrust;
+
+  output_command->mass_difference = uav_mass_difference_;
+  output_command->total_mass      = total_mass;
+
+  output_command->controller_enforcing_constraints = false;
+
+  output_command->controller = "IndiController";
+
+  // | -------------------- record the update ------------------- |
+
+  if (flight_recorder_ && !shadow) {
+
+    flight_record_.thrust_force = indi_output_.thrust_force;
+
+    common::recordOutput(flight_record_, *output_command);
+
+    flight_recorder_->write(flight_record_);
+  }
+
+  if (!shadow) {
+    health_->addUpdate(update_start, flight_record_.flags);
+  }
+
+  last_attitude_cmd_ = output_command;
+
+  return output_command;
+}
+
+//}
+
+/* //{ getStatus() */
+
+const mrs_msgs::ControllerStatus IndiController::getStatus() {
+
+  mrs_msgs::ControllerStatus controller_status;
+
+  controller_status.active = is_active_;
+
+  return controller_status;
+}
+
+//}
+
+/* switchOdometrySource() //{ */
+
+void IndiController::switchOdometrySource(const mrs_msgs::UavState::ConstPtr& new_uav_state) {
+
+  CONTROLLER_TRACE2(switch_odometry_source, "IndiController", new_uav_state->header.frame_id.c_str());
+
+  ROS_INFO("[IndiController]: switching the odometry source");
+
+  // the filtered force and acceleration are in the old frame, start again from the current thrust
+  if (last_attitude_cmd_) {
+
+    Eigen::Matrix3d R = mrs_lib::AttitudeConverter(new_uav_state->pose.orientation);
+
+    double thrust_force = mrs_lib::quadratic_thrust_model::thrustToForce(common_handlers_->motor_params, last_attitude_cmd_->thrust);
+
+    indi_core_->reset(_uav_mass_ + uav_mass_difference_, thrust_force, R);
+  }
+
+  // so is the state of the copy, it starts over from the next active output
+  if (shadow_mode_ && !is_active_) {
+    shadow_mode_->resume();
+  }
+}
+
+//}
+
+/* resetDisturbanceEstimators() //{ */
+
+void IndiController::resetDisturbanceEstimators(void) {
+
+  // the disturbances are not integrated, the increments are based on the measured acceleration
+}
+
+//}
+
+/* setConstraints() //{ */
+
+const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr IndiController::setConstraints([
+    [maybe_unused]] const mrs_msgs::DynamicsConstraintsSrvRequest::ConstPtr& constraints) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SERVICE);
+
+  if (!is_initialized_) {
+    return mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr(new mrs_msgs::DynamicsConstraintsSrvResponse());
+  }
+
+  mrs_lib::set_mutexed(mutex_constraints_, constraints->constraints, constraints_);
+
+  got_constraints_ = true;
+
+  if (shadow_controller_) {
+    shadow_controller_->setConstraints(constraints);
+  }
+
+  ROS_INFO("[IndiController]: updating constraints");
+
+  mrs_msgs::DynamicsConstraintsSrvResponse res;
+  res.success = true;
+  res.message = "constraints updated";
+
+  return mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr(new mrs_msgs::DynamicsConstraintsSrvResponse(res));
+}
+
+//}
+
+/* updateShadow() //{ */
+
+const mrs_msgs::AttitudeCommand::ConstPtr IndiController::updateShadow(const common::ShadowFrame_t& frame) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+  // the filters of the copy start from the orientation of this frame
+  boost::atomic_store(&shadow_controller_->uav_state_, frame.uav_state);
+
+  // the copy starts as if the control manager switched to it, from the output of the active controller
+  if (frame.restart && !shadow_controller_->activate(frame.active_output)) {
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  return shadow_controller_->update(frame.uav_state, frame.control_reference);
+}
+
+//}
+
+}  // namespace indi_controller
+
+}  // namespace mrs_uav_controllers
+
+#include <pluginlib/class_list_macros.h>
+PLUGINLIB_EXPORT_CLASS(mrs_uav_controllers::indi_controller::IndiController, mrs_uav_managers::Controller)
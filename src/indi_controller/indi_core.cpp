@@ -0,0 +1,159 @@
+#include <mrs_uav_controllers/indi_controller/indi_core.h>
+
+#include <algorithm>
+
+namespace mrs_uav_controllers
+{
+
+namespace indi_controller
+{
+
+/* IndiCore() //{ */
+
+IndiCore::IndiCore(const IndiParams_t& params) : params_(params) {
+
+  reset(0, 0, Eigen::Matrix3d::Identity());
+}
+
+//}
+
+/* setParams() //{ */
+
+void IndiCore::setParams(const IndiParams_t& params) {
+
+  params_ = params;
+}
+
+//}
+
+/* getParams() //{ */
+
+const IndiParams_t& IndiCore::getParams(void) const {
+
+  return params_;
+}
+
+//}
+
+/* reset() //{ */
+
+void IndiCore::reset(const double mass, const double thrust_force, const Eigen::Matrix3d& R) {
+
+  force_filtered_        = thrust_force * R.col(2);
+  acceleration_filtered_ = mass > 0 ? Eigen::Vector3d(force_filtered_ / mass) : Eigen::Vector3d(0, 0, params_.g);
+  last_thrust_force_     = thrust_force;
+  first_update_          = true;
+}
+
+//}
+
+/* update() //{ */
+
+bool IndiCore::update(const IndiState_t& state, const IndiReference_t& reference, const double mass, const double dt, IndiOutput_t& output) {
+
+  // | ------------- the synchronous low-pass filters ------------- |
+
+  // the force which has been applied since the last update
+  const Eigen::Vector3d force_applied = last_thrust_force_ * state.R.col(2);
+
+  const Eigen::Vector3d acceleration_measured = state.acceleration + Eigen::Vector3d(0, 0, params_.g);
+
+  if (first_update_ || dt <= 0) {
+
+    first_update_ = false;
+
+  } else {
+
+    const double tc    = 1.0 / (2.0 * M_PI * params_.filter_cutoff);
+    const double alpha = dt / (tc + dt);
+
+    force_filtered_ += alpha * (force_applied - force_filtered_);
+    acceleration_filtered_ += alpha * (acceleration_measured - acceleration_filtered_);
+  }
+
+  // | ------------------ the desired acceleration ----------------- |
+
+  const Eigen::Vector3d Ep = reference.use_position.cwiseProduct(reference.position - state.position);
+  const Eigen::Vector3d Ev = reference.use_velocity.cwiseProduct(reference.velocity - state.velocity);
+
+  const Eigen::Vector3d acceleration_desired = reference.use_acceleration.cwiseProduct(reference.acceleration) + params_.kp.cwiseProduct(Ep) +
+                                               params_.kv.cwiseProduct(Ev) + Eigen::Vector3d(0, 0, params_.g);
+
+  // | --------------------- the increment --------------------- |
+
+  Eigen::Vector3d increment = mass * (acceleration_desired - acceleration_filtered_);
+
+  if (params_.max_increment > 0 && increment.norm() > params_.max_increment) {
+    increment *= params_.max_increment / increment.norm();
+  }
+
+  Eigen::Vector3d f = force_filtered_ + increment;
+
+  // the downwards force should not flip the UAV
+  if (f[2] < 0) {
+    f << 0, 0, 1;
+  }
+
+  // | ------------------- saturate the tilt ------------------- |
+
+  Eigen::Vector3d f_norm = f.normalized();
+
+  output.tilt_saturated = false;
+
+  const double theta = acos(std::min(1.0, f_norm[2]));
+
+  if (params_.max_tilt > 0 && theta > params_.max_tilt) {
+
+    const double phi = atan2(f_norm[1], f_norm[0]);
+
+    f_norm << sin(params_.max_tilt) * cos(phi), sin(params_.max_tilt) * sin(phi), cos(params_.max_tilt);
+
+    f = f.norm() * f_norm;
+
+    output.tilt_saturated = true;
+  }
+
+  // | ---------------- the desired orientation ---------------- |
+
+  const Eigen::Vector3d bxd(cos(reference.heading), sin(reference.heading), 0);
+
+  output.Rd.col(2) = f_norm;
+  output.Rd.col(1) = f_norm.cross(bxd).normalized();
+  output.Rd.col(0) = output.Rd.col(1).cross(f_norm).normalized();
+
+  // | ------------------- the attitude rate ------------------- |
+
+  const Eigen::Matrix3d E = 0.5 * (output.Rd.transpose() * state.R - state.R.transpose() * output.Rd);
+
+  const Eigen::Vector3d Eq((E(2, 1) - E(1, 2)) / 2.0, (E(0, 2) - E(2, 0)) / 2.0, (E(1, 0) - E(0, 1)) / 2.0);
+
+  output.attitude_rate = -params_.kq.cwiseProduct(Eq) + reference.attitude_rate;
+
+  // | ----------------------- the thrust ----------------------- |
+
+  output.force        = f;
+  output.thrust_force = std::max(0.0, f.dot(state.R.col(2)));
+
+  if (!output.force.allFinite() || !output.attitude_rate.allFinite() || !std::isfinite(output.thrust_force)) {
+    return false;
+  }
+
+  last_thrust_force_ = output.thrust_force;
+
+  return true;
+}
+
+//}
+
+/* setAppliedThrustForce() //{ */
+
+void IndiCore::setAppliedThrustForce(const double thrust_force) {
+
+  last_thrust_force_ = thrust_force;
+}
+
+//}
+
+}  // namespace indi_controller
+
+}  // namespace mrs_uav_controllers
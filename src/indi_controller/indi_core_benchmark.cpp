@@ -0,0 +1,223 @@
+/* the update time of the INDI controller and its response to a step disturbance, on a point mass with a first-order thrust response */
+
+#include <mrs_uav_controllers/indi_controller/indi_core.h>
+#include <mrs_uav_controllers/common/perf_counters.h>
+#include <mrs_uav_controllers/common/benchmark_utils.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace mrs_uav_controllers::indi_controller;
+using namespace mrs_uav_controllers::common;
+
+/* main() //{ */
+
+int main(int argc, char** argv) {
+
+  int n_updates = 100000;
+
+  bool        counters = false;
+  std::string json_file;
+
+  // indi_controller_benchmark [n_updates] [--counters] [--json <file>]
+  for (int i = 1; i < argc; i++) {
+
+    if (strcmp(argv[i], "--counters") == 0) {
+      counters = true;
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_file = argv[++i];
+    } else {
+      n_updates = std::atoi(argv[i]);
+    }
+  }
+
+  // the defaults of config/default/indi.yaml
+  IndiParams_t params;
+  params.g             = 9.81;
+  params.kp            = Eigen::Vector3d(4.0, 4.0, 8.0);
+  params.kv            = Eigen::Vector3d(3.0, 3.0, 5.0);
+  params.kq            = Eigen::Vector3d(5.0, 5.0, 3.0);
+  params.filter_cutoff = 5.0;
+  params.max_increment = 20.0;
+  params.max_tilt      = 0;
+
+  const double mass = 2.0;
+  const double dt   = 0.01;
+  const double tau  = 0.03;  // [s] the time constant of the thrust response
+
+  // | ---------------------- the update time --------------------- |
+
+  IndiCore indi(params);
+
+  IndiState_t     state;
+  IndiReference_t reference;
+  IndiOutput_t    output;
+
+  state.position     = Eigen::Vector3d::Zero();
+  state.velocity     = Eigen::Vector3d::Zero();
+  state.acceleration = Eigen::Vector3d::Zero();
+  state.R            = Eigen::Matrix3d::Identity();
+
+  reference.position         = Eigen::Vector3d(1.0, -1.0, 0.5);
+  reference.velocity         = Eigen::Vector3d::Zero();
+  reference.acceleration     = Eigen::Vector3d::Zero();
+  reference.use_position     = Eigen::Vector3d::Ones();
+  reference.use_velocity     = Eigen::Vector3d::Ones();
+  reference.use_acceleration = Eigen::Vector3d::Ones();
+  reference.heading          = 0;
+  reference.attitude_rate    = Eigen::Vector3d::Zero();
+
+  indi.reset(mass, mass * params.g, state.R);
+
+  // the update takes a few hundred ns, so every update is timed by the timestamp counter, whose overhead is
+  // subtracted, the steady clock would be as slow as the update itself
+  const double   timestamp_period   = getTimestampPeriod();
+  const uint64_t timestamp_overhead = getTimestampOverhead();
+
+  n_updates = std::max(n_updates, 1);
+
+  double max_time = 0;
+
+  std::vector<double> durations(n_updates, 0.0);
+
+  uint64_t allocations_start = getAllocationCount();
+
+  auto start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < n_updates; i++) {
+
+    uint64_t t0 = readTimestamp();
+
+    indi.update(state, reference, mass, dt, output);
+
+    uint64_t ticks = readTimestamp() - t0;
+
+    // perturb the measurement so that the work is not optimized away
+    state.acceleration[0] = 1e-3 * (i % 7);
+
+    double duration = double(ticks > timestamp_overhead ? ticks - timestamp_overhead : 0) * timestamp_period;
+
+    max_time     = std::max(max_time, duration);
+    durations[i] = duration;
+  }
+
+  double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  double allocations = double(getAllocationCount() - allocations_start) / double(std::max(n_updates, 1));
+
+  double median_time = samplePercentile(durations, 0.50);
+  double p99_time    = samplePercentile(durations, 0.99);
+
+  printf("update: mean %.3f us, median %.3f us, p99 %.3f us, max %.3f us, %.2f allocations (%d updates, timestamp overhead %.1f ns)\n",
+         1e6 * total / n_updates, 1e6 * median_time, 1e6 * p99_time, 1e6 * max_time, allocations, n_updates, 1e9 * double(timestamp_overhead) * timestamp_period);
+
+  // | ----------------- the performance counters ----------------- |
+
+  // a separate pass, the reads of the counters would distort the timings above
+  std::string counters_json = "null";
+
+  if (counters) {
+
+    PerfCounters perf_counters;
+
+    if (perf_counters.isAvailable()) {
+
+      for (int i = 0; i < n_updates; i++) {
+
+        perf_counters.start();
+
+        indi.update(state, reference, mass, dt, output);
+
+        perf_counters.stop();
+
+        state.acceleration[0] = 1e-3 * (i % 7);
+      }
+
+      PerfCounterValues_t values = perf_counters.getValues();
+
+      counters_json = perfCountersToJson(values);
+
+      printf("update: %s\n", counters_json.c_str());
+
+    } else {
+      printf("the performance counters are not available: %s\n", perf_counters.getError().c_str());
+    }
+  }
+
+  // | ------------------ the step disturbance ------------------ |
+
+  // a horizontal force disturbance appears after 1 s, the position error is reported afterwards
+  const Eigen::Vector3d disturbance(2.0, 0, -2.0);  // [N]
+
+  reference.position = Eigen::Vector3d::Zero();
+
+  state.position     = Eigen::Vector3d::Zero();
+  state.velocity     = Eigen::Vector3d::Zero();
+  state.acceleration = Eigen::Vector3d::Zero();
+
+  indi.reset(mass, mass * params.g, state.R);
+
+  Eigen::Vector3d force_applied(0, 0, mass * params.g);
+
+  double max_error = 0;
+
+  for (int i = 0; i < int(5.0 / dt); i++) {
+
+    double time = i * dt;
+
+    if (!indi.update(state, reference, mass, dt, output)) {
+      printf("the update failed\n");
+      return 1;
+    }
+
+    // the orientation follows the desired one immediately, the thrust with a lag
+    state.R = output.Rd;
+
+    force_applied += (dt / (tau + dt)) * (output.thrust_force * state.R.col(2) - force_applied);
+
+    Eigen::Vector3d total_force = force_applied - Eigen::Vector3d(0, 0, mass * params.g) + (time >= 1.0 ? disturbance : Eigen::Vector3d::Zero());
+
+    state.acceleration = total_force / mass;
+    state.velocity += state.acceleration * dt;
+    state.position += state.velocity * dt;
+
+    if (time >= 1.0) {
+      max_error = std::max(max_error, state.position.norm());
+    }
+  }
+
+  printf("step disturbance [%.1f, %.1f, %.1f] N: max position error %.3f m, final %.4f m\n", disturbance[0], disturbance[1], disturbance[2], max_error,
+         state.position.norm());
+
+  // | ------------------------ json output ----------------------- |
+
+  if (!json_file.empty()) {
+
+    FILE* file = fopen(json_file.c_str(), "w");
+
+    if (file == nullptr) {
+      printf("could not open '%s'\n", json_file.c_str());
+      return 1;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"indi_controller\",\n");
+    fprintf(file, "  \"build\": \"%s\",\n", getBuildDescription());
+    fprintf(file, "  \"n_updates\": %d,\n", n_updates);
+    fprintf(file, "  \"update\": {\"mean_time\": %.9f, \"median_time\": %.9f, \"p99_time\": %.9f, \"max_time\": %.9f, \"allocations\": %.3f, \"counters\": %s},\n",
+            total / n_updates, median_time, p99_time, max_time, allocations, counters_json.c_str());
+    fprintf(file, "  \"step_disturbance\": {\"max_error\": %.6f, \"final_error\": %.6f}\n", max_error, state.position.norm());
+    fprintf(file, "}\n");
+
+    fclose(file);
+  }
+
+  return 0;
+}
+
+//}
@@ -11,6 +11,12 @@
 #include <mrs_lib/mutex.h>
 #include <mrs_lib/param_loader.h>
 
+#include <mrs_uav_controllers/common/controller_health.h>
+#include <mrs_uav_controllers/common/tracing.h>
+#include <mrs_uav_controllers/common/attitude_math.h>
+
+#include <chrono>
+
 //}
 
 namespace mrs_uav_controllers
@@ -50,8 +56,8 @@ private:
 
   // | ------------------------ uav state ----------------------- |
 
-  mrs_msgs::UavState uav_state_;
-  std::mutex         mutex_uav_state_;
+  // the last measured state, swapped atomically (boost::atomic_store/load) instead of copied under a mutex
+  mrs_msgs::UavState::ConstPtr uav_state_;
 
   // | --------------------- thrust control --------------------- |
 
@@ -64,6 +70,10 @@ private:
 
   double heading_setpoint_;
 
+  // | ------------------------- health ------------------------- |
+
+  std::unique_ptr<common::ControllerHealth> health_;
+
   // | ------------------------ profiler ------------------------ |
 
   mrs_lib::Profiler profiler_;
@@ -78,8 +88,8 @@ private:
 
 /* initialize() //{ */
 
-void MidairActivationController::initialize(const ros::NodeHandle &parent_nh, [[maybe_unused]] const std::string name, const std::string name_space,
-                                            const double uav_mass, std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
+void MidairActivationController::initialize(const ros::NodeHandle &parent_nh, const std::string name, const std::string name_space, const double uav_mass,
+                                            std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
 
   ros::NodeHandle nh_(parent_nh, name_space);
 
@@ -100,12 +110,28 @@ void MidairActivationController::initialize(const ros::NodeHandle &parent_nh, [[
     ros::shutdown();
   }
 
+  common::ControllerHealthParams_t health;
+
+  param_loader.loadParam("diagnostics/rate", health.rate);
+  param_loader.loadParam("diagnostics/max_update_time", health.max_update_time);
+
+  if (!param_loader.loadedSuccessfully()) {
+    ROS_ERROR("[MidairActivationController]: could not load all parameters!");
+    ros::shutdown();
+  }
+
   uav_mass_difference_ = 0;
 
   // | ----------- calculate the default hover thrust ----------- |
 
   hover_thrust_ = mrs_lib::quadratic_thrust_model::forceToThrust(common_handlers_->motor_params, _uav_mass_ * common_handlers_->g);
 
+  // | ------------------------- health ------------------------- |
+
+  health_ = std::make_unique<common::ControllerHealth>(name, std::vector<std::string>{}, health);
+
+  health_->advertise(nh_);
+
   // | ------------------------ profiler ------------------------ |
 
   profiler_ = mrs_lib::Profiler(nh_, "MidairActivationController", _profiler_enabled_);
@@ -123,16 +149,27 @@ void MidairActivationController::initialize(const ros::NodeHandle &parent_nh, [[
 
 bool MidairActivationController::activate([[maybe_unused]] const mrs_msgs::AttitudeCommand::ConstPtr &last_attitude_cmd) {
 
+  CONTROLLER_TRACE1(activate, "MidairActivationController");
+
   ROS_INFO("[MidairActivationController]: activating");
 
-  auto uav_state = mrs_lib::get_mutexed(mutex_uav_state_, uav_state_);
+  auto uav_state = boost::atomic_load(&uav_state_);
 
-  try {
-    heading_setpoint_ = mrs_lib::AttitudeConverter(uav_state.pose.orientation).getHeading();
-  }
-  catch (...) {
-    ROS_WARN_THROTTLE(1.0, "[MidairActivationController]: could not calculate heading");
-    heading_setpoint_ = mrs_lib::AttitudeConverter(uav_state.pose.orientation).getYaw();
+  if (!uav_state) {
+
+    ROS_WARN("[MidairActivationController]: no UAV state received yet, activating with zero heading");
+    heading_setpoint_ = 0;
+
+  } else {
+
+    std::optional<double> heading = common::getHeading(mrs_lib::AttitudeConverter(uav_state->pose.orientation));
+
+    if (heading) {
+      heading_setpoint_ = heading.value();
+    } else {
+      ROS_WARN_THROTTLE(1.0, "[MidairActivationController]: could not calculate heading");
+      heading_setpoint_ = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getYaw();
+    }
   }
 
   ROS_INFO("[MidairActivationController]: activated with heading: %.2f rad", heading_setpoint_);
@@ -152,6 +189,8 @@ bool MidairActivationController::activate([[maybe_unused]] const mrs_msgs::Attit
 
 void MidairActivationController::deactivate(void) {
 
+  CONTROLLER_TRACE1(deactivate, "MidairActivationController");
+
   is_active_           = false;
   uav_mass_difference_ = 0;
 
@@ -169,7 +208,12 @@ const mrs_msgs::AttitudeCommand::ConstPtr MidairActivationController::update([[m
   mrs_lib::ScopeTimer timer =
       mrs_lib::ScopeTimer("MidairActivationController::update", common_handlers_->scope_timer.logger, common_handlers_->scope_timer.enabled);
 
-  mrs_lib::set_mutexed(mutex_uav_state_, *uav_state, uav_state_);
+  common::UpdateTrace update_trace("MidairActivationController");
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_UPDATE);
+
+  auto update_start = std::chrono::steady_clock::now();
+
+  boost::atomic_store(&uav_state_, uav_state);
 
   if (!is_active_) {
     return mrs_msgs::AttitudeCommand::ConstPtr();
@@ -185,7 +229,8 @@ const mrs_msgs::AttitudeCommand::ConstPtr MidairActivationController::update([[m
 
   output_command->header.stamp = ros::Time::now();
 
-  output_command->attitude = mrs_lib::AttitudeConverter(0, 0, 0).setHeading(heading_setpoint_);
+  // level, the heading is the yaw
+  output_command->attitude = mrs_lib::AttitudeConverter(0, 0, heading_setpoint_);
 
   output_command->thrust    = hover_thrust_;
   output_command->mode_mask = output_command->MODE_ATTITUDE;
@@ -201,6 +246,8 @@ const mrs_msgs::AttitudeCommand::ConstPtr MidairActivationController::update([[m
 
   output_command->controller = "MidairActivationController";
 
+  health_->addUpdate(update_start, 0);
+
   return output_command;
 }
 
@@ -222,6 +269,8 @@ const mrs_msgs::ControllerStatus MidairActivationController::getStatus() {
 /* switchOdometrySource() //{ */
 
 void MidairActivationController::switchOdometrySource([[maybe_unused]] const mrs_msgs::UavState::ConstPtr &new_uav_state) {
+
+  CONTROLLER_TRACE2(switch_odometry_source, "MidairActivationController", new_uav_state->header.frame_id.c_str());
 }
 
 //}
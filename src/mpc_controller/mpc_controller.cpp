@@ -6,7 +6,18 @@
 
 #include <mrs_uav_managers/controller.h>
 
-#include <mpc_controller_solver.h>
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+#include <mrs_uav_controllers/mpc_solver/admm_kernels.h>
+#include <mrs_uav_controllers/mpc_solver/lqr_fast_path.h>
+#include <mrs_uav_controllers/mpc_solver/disturbance_observer.h>
+
+#include <mrs_uav_controllers/common/state_predictor.h>
+#include <mrs_uav_controllers/common/flight_recorder_utils.h>
+#include <mrs_uav_controllers/common/controller_health.h>
+#include <mrs_uav_controllers/common/tracing.h>
+#include <mrs_uav_controllers/common/high_rate.h>
+#include <mrs_uav_controllers/common/attitude_math.h>
+#include <mrs_uav_controllers/common/shadow_mode.h>
 
 #include <dynamic_reconfigure/server.h>
 #include <mrs_uav_controllers/mpc_controllerConfig.h>
@@ -21,11 +32,21 @@
 
 #include <geometry_msgs/Vector3Stamped.h>
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
 //}
 
 #define OUTPUT_ATTITUDE_RATE 0
 #define OUTPUT_ATTITUDE_QUATERNION 1
 
+// the fraction of the MPC limits which is given to the trajectory tracker as the constraints
+#define CONSTRAINTS_MARGIN 0.5
+
 namespace mrs_uav_controllers
 {
 
@@ -37,7 +58,7 @@ namespace mpc_controller
 class MpcController : public mrs_uav_managers::Controller {
 
 public:
-  ~MpcController(){};
+  ~MpcController();
 
   void initialize(const ros::NodeHandle &parent_nh, const std::string name, const std::string name_space, const double uav_mass,
                   std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers);
@@ -65,8 +86,8 @@ private:
 
   // | ------------------------ uav state ----------------------- |
 
-  mrs_msgs::UavState uav_state_;
-  std::mutex         mutex_uav_state_;
+  // the last measured state, swapped atomically (boost::atomic_store/load) instead of copied under a mutex
+  mrs_msgs::UavState::ConstPtr uav_state_;
 
   // | --------------- dynamic reconfigure server --------------- |
 
@@ -113,6 +134,18 @@ private:
   double _gains_filter_change_rate_;
   double _gains_filter_min_change_rate_;
 
+  // the filtered gains are echoed to the drs by a timer at a low rate, the control thread does no ROS I/O,
+  // the echo is built from the drs params of a sequence number and dropped when callbackDrs() came since
+  DrsConfig_t drs_write_back_;
+  bool        drs_write_back_pending_  = false;
+  uint64_t    drs_write_back_sequence_ = 0;
+  uint64_t    drs_sequence_            = 0;  // bumped by callbackDrs()
+  std::mutex  mutex_drs_write_back_;
+  ros::Timer  timer_drs_write_back_;
+  double      _gains_filter_write_back_rate_;
+
+  void timerDrsWriteBack(const ros::TimerEvent &event);
+
   // | ----------------------- gain muting ---------------------- |
 
   bool   gains_muted_ = false;  // the current state (may be initialized in activate())
@@ -133,11 +166,22 @@ private:
   ros::Time last_update_time_;
   bool      first_iteration_ = true;
 
+  double last_uav_heading_ = 0;  // the fallback when the heading is singular
+
+  // | ---------------- high-rate odometry, 1 kHz ---------------- |
+
+  common::HighRateParams_t _high_rate_;
+  double                   _min_dt_;  // [s] the closer odometry is skipped
+  int                      _high_rate_mpc_decimation_;
+
+  common::Decimator transform_decimator_;
+  common::Decimator mpc_decimator_;  // the first input of the MPC is held between the solves
+
   // | ----------------- integral terms enabler ----------------- |
 
   ros::ServiceServer service_set_integral_terms_;
   bool               callbackSetIntegralTerms(std_srvs::SetBool::Request &req, std_srvs::SetBool::Response &res);
-  bool               integral_terms_enabled_ = true;
+  std::atomic<bool>  integral_terms_enabled_ = true;  // set by the service, also on the copy of the shadow mode, read by update()
 
   // | --------------------- MPC controller --------------------- |
 
@@ -148,6 +192,12 @@ private:
   double _dt1_;  // the first time step
   double _dt2_;  // all the other steps
 
+  // time step schedule of the horizon
+  std::string         _dt_schedule_type_;  // {"two_step", "geometric", "list"}
+  double              _dt_schedule_ratio_;
+  double              _dt_schedule_max_dt_;
+  std::vector<double> _dt_schedule_list_;
+
   // the last control input
   double mpc_solver_x_u_ = 0;
   double mpc_solver_y_u_ = 0;
@@ -159,20 +209,130 @@ private:
   double _max_speed_horizontal_, _max_acceleration_horizontal_, _max_jerk_;
   double _max_speed_vertical_, _max_acceleration_vertical_, _max_u_vertical_;
 
+  typedef struct
+  {
+    double speed_horizontal;
+    double acceleration_horizontal;
+    double jerk_horizontal;
+    double speed_vertical;
+    double acceleration_vertical;
+    double u_vertical;
+  } MpcLimits_t;
+
+  // the limits from the drs, optionally clamped by the dynamics constraints
+  MpcLimits_t getMpcLimits(const bool clamp_by_constraints);
+
   // Q and S matrix diagonals for horizontal
   std::vector<double> _mat_Q_, _mat_S_;
 
   // Q and S matrix diagonals for vertical
   std::vector<double> _mat_Q_z_, _mat_S_z_;
 
-  // MPC solver handlers
-  std::unique_ptr<mrs_mpc_solvers::mpc_controller::Solver> mpc_solver_x_;
-  std::unique_ptr<mrs_mpc_solvers::mpc_controller::Solver> mpc_solver_y_;
-  std::unique_ptr<mrs_mpc_solvers::mpc_controller::Solver> mpc_solver_z_;
+  // the models of the axes
+  std::unique_ptr<mpc_solver::MpcModel> mpc_model_horizontal_;
+  std::unique_ptr<mpc_solver::MpcModel> mpc_model_vertical_;
+
+  // | -------------------- MPC solver setup -------------------- |
+
+  typedef struct
+  {
+    Eigen::Vector3d Q_horizontal;
+    Eigen::Vector3d S_horizontal;
+    Eigen::Vector3d Q_vertical;
+    Eigen::Vector3d S_vertical;
+  } MpcWeights_t;
+
+  // everything that depends on the Q and S weights, the backends which take the weights from the problem are shared with the previous setup
+  typedef struct
+  {
+    MpcWeights_t                                  weights;
+    std::shared_ptr<mpc_solver::MpcSolverBackend> solver_x;
+    std::shared_ptr<mpc_solver::MpcSolverBackend> solver_y;
+    std::shared_ptr<mpc_solver::MpcSolverBackend> solver_z;
+    std::unique_ptr<mpc_solver::LqrFastPath>      fast_path_horizontal;
+    std::unique_ptr<mpc_solver::LqrFastPath>      fast_path_vertical;
+  } MpcSetup_t;
+
+  std::shared_ptr<MpcSetup_t> createMpcSetup(const MpcWeights_t &weights, const std::shared_ptr<MpcSetup_t> &previous);
+
+  // used only by the control loop
+  std::shared_ptr<MpcSetup_t> mpc_setup_;
+
+  // prepared by the setup thread, swapped in by the control loop at the beginning of the next update(), accessed atomically
+  std::shared_ptr<MpcSetup_t> mpc_setup_pending_;
+
+  // the last one created, used only by the setup thread
+  std::shared_ptr<MpcSetup_t> mpc_setup_last_;
+
+  // | ----------------- background setup thread ---------------- |
+
+  std::thread             mpc_setup_thread_;
+  std::mutex              mutex_mpc_setup_request_;
+  std::condition_variable mpc_setup_request_cv_;
+  MpcWeights_t            mpc_setup_request_;
+  bool                    mpc_setup_requested_   = false;
+  bool                    mpc_setup_thread_stop_ = false;
+
+  void mpcSetupThread(void);
+  void requestMpcSetup(const MpcWeights_t &weights);
+
+  // the problems are filled in place every iteration
+  mpc_solver::MpcProblem_t mpc_problem_x_;
+  mpc_solver::MpcProblem_t mpc_problem_y_;
+  mpc_solver::MpcProblem_t mpc_problem_z_;
 
   // MPC solver params
-  bool _mpc_solver_verbose_ = false;
-  int  _mpc_solver_max_iterations_;
+  mpc_solver::MpcSolverParams_t mpc_solver_params_;
+  std::string                   mpc_solver_backend_type_;
+
+  bool        _mpc_solver_verbose_ = false;
+  int         _mpc_solver_max_iterations_;
+  std::string _mpc_solver_backend_;
+  int         _mpc_solver_benchmark_n_solves_;
+
+  std::string selectMpcSolverBackend(const mpc_solver::MpcModel &model, const mpc_solver::MpcSolverParams_t &params);
+
+  // | ---------------------- LQR fast path --------------------- |
+
+  // the unconstrained optimum is used when it does not violate the constraints, the QP is solved otherwise
+  bool _mpc_fast_path_enabled_;
+
+  void prepareFastPath(mpc_solver::LqrFastPath &fast_path, const Eigen::Vector3d &Q, const Eigen::Vector3d &S);
+
+  bool solveMpc(mpc_solver::MpcSolverBackend &solver, mpc_solver::LqrFastPath &fast_path, const mpc_solver::MpcProblem_t &problem,
+                mpc_solver::MpcSolution_t &solution);
+
+  // | ------------------ disturbance observer ------------------ |
+
+  // offset-free MPC: the disturbances are estimated by the observers and predicted by the MPC, the integrators are not used
+  bool   _disturbance_observer_enabled_;
+  double _disturbance_observer_bandwidth_horizontal_;
+  double _disturbance_observer_damping_horizontal_;
+  double _disturbance_observer_max_horizontal_;
+  double _disturbance_observer_bandwidth_vertical_;
+  double _disturbance_observer_damping_vertical_;
+  double _disturbance_observer_max_vertical_;
+
+  std::unique_ptr<mpc_solver::DisturbanceObserver> disturbance_observer_x_;
+  std::unique_ptr<mpc_solver::DisturbanceObserver> disturbance_observer_y_;
+  std::unique_ptr<mpc_solver::DisturbanceObserver> disturbance_observer_z_;
+
+  bool            disturbance_observer_reset_ = true;  // the velocity estimates should be initialized from the odometry
+  bool            last_output_saturated_      = false;
+  Eigen::Vector3d last_acceleration_cmd_      = Eigen::Vector3d::Zero();
+
+  // | -------------------- state prediction -------------------- |
+
+  std::unique_ptr<common::StatePredictor> state_predictor_;
+
+  // | --------------------- flight recorder -------------------- |
+
+  std::unique_ptr<common::FlightRecorder> flight_recorder_;
+  common::FlightRecord_t                  flight_record_;
+
+  // | ------------------------- health ------------------------- |
+
+  std::unique_ptr<common::ControllerHealth> health_;
 
   // | ------------------------ profiler ------------------------ |
 
@@ -201,6 +361,18 @@ private:
   double    rampup_duration_;
   ros::Time rampup_start_time_;
   ros::Time rampup_last_time_;
+
+  // | ----------------------- shadow mode ---------------------- |
+
+  // the copy of the controller evaluated by the shadow mode, initialized from the same params without any ROS I/O,
+  // it is updated only by the shadow worker, the control manager never sees it
+  bool                           shadow_instance_ = false;
+  std::unique_ptr<MpcController> shadow_controller_;
+
+  const mrs_msgs::AttitudeCommand::ConstPtr updateShadow(const common::ShadowFrame_t &frame);
+
+  // the last member, its worker is joined before the copy it updates is destroyed
+  std::unique_ptr<common::ShadowMode> shadow_mode_;
 };
 
 //}
@@ -209,6 +381,28 @@ private:
 // |                   controller's interface                   |
 // --------------------------------------------------------------
 
+/* ~MpcController() //{ */
+
+MpcController::~MpcController() {
+
+  // the shadow worker may be solving the MPC of the copy
+  shadow_mode_.reset();
+
+  {
+    std::scoped_lock lock(mutex_mpc_setup_request_);
+
+    mpc_setup_thread_stop_ = true;
+  }
+
+  mpc_setup_request_cv_.notify_one();
+
+  if (mpc_setup_thread_.joinable()) {
+    mpc_setup_thread_.join();
+  }
+}
+
+//}
+
 /* //{ initialize() */
 
 void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::string name, const std::string name_space, const double uav_mass,
@@ -240,6 +434,10 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
   param_loader.loadParam("mpc_model/number_of_states", _n_states_);
   param_loader.loadParam("mpc_model/dt1", _dt1_);
   param_loader.loadParam("mpc_model/dt2", _dt2_);
+  param_loader.loadParam("mpc_model/schedule/type", _dt_schedule_type_);
+  param_loader.loadParam("mpc_model/schedule/geometric/ratio", _dt_schedule_ratio_);
+  param_loader.loadParam("mpc_model/schedule/geometric/max_dt", _dt_schedule_max_dt_);
+  param_loader.loadParam("mpc_model/schedule/list", _dt_schedule_list_);
 
   param_loader.loadParam("mpc_parameters/horizon_length", _horizon_length_);
 
@@ -259,12 +457,25 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
 
   param_loader.loadParam("mpc_solver/verbose", _mpc_solver_verbose_);
   param_loader.loadParam("mpc_solver/max_iterations", _mpc_solver_max_iterations_);
+  param_loader.loadParam("mpc_solver/backend", _mpc_solver_backend_);
+  param_loader.loadParam("mpc_solver/benchmark/n_solves", _mpc_solver_benchmark_n_solves_);
+  param_loader.loadParam("mpc_solver/lqr_fast_path/enabled", _mpc_fast_path_enabled_);
 
   // | ------------------------- rampup ------------------------- |
 
   param_loader.loadParam("rampup/enabled", _rampup_enabled_);
   param_loader.loadParam("rampup/speed", _rampup_speed_);
 
+  // | ------------------ disturbance observer ------------------ |
+
+  param_loader.loadParam("disturbance_observer/enabled", _disturbance_observer_enabled_);
+  param_loader.loadParam("disturbance_observer/horizontal/bandwidth", _disturbance_observer_bandwidth_horizontal_);
+  param_loader.loadParam("disturbance_observer/horizontal/damping", _disturbance_observer_damping_horizontal_);
+  param_loader.loadParam("disturbance_observer/horizontal/max_disturbance", _disturbance_observer_max_horizontal_);
+  param_loader.loadParam("disturbance_observer/vertical/bandwidth", _disturbance_observer_bandwidth_vertical_);
+  param_loader.loadParam("disturbance_observer/vertical/damping", _disturbance_observer_damping_vertical_);
+  param_loader.loadParam("disturbance_observer/vertical/max_disturbance", _disturbance_observer_max_vertical_);
+
   // | --------------------- integral gains --------------------- |
 
   param_loader.loadParam("integral_gains/kiw", kiwxy_);
@@ -297,6 +508,7 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
   // gain filtering
   param_loader.loadParam("gains_filter/perc_change_rate", _gains_filter_change_rate_);
   param_loader.loadParam("gains_filter/min_change_rate", _gains_filter_min_change_rate_);
+  param_loader.loadParam("gains_filter/write_back_rate", _gains_filter_write_back_rate_);
 
   // gain muting
   param_loader.loadParam("gain_mute_coefficient", _gain_mute_coefficient_);
@@ -304,6 +516,48 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
   // output mode
   param_loader.loadParam("output_mode", _output_mode_);
 
+  // state prediction
+  common::StatePredictorParams_t state_prediction;
+  std::string                    state_prediction_delay_mode;
+
+  param_loader.loadParam("state_prediction/enabled", state_prediction.enabled);
+  param_loader.loadParam("state_prediction/delay_mode", state_prediction_delay_mode);
+  param_loader.loadParam("state_prediction/fixed_delay", state_prediction.fixed_delay);
+  param_loader.loadParam("state_prediction/actuation_delay", state_prediction.actuation_delay);
+  param_loader.loadParam("state_prediction/max_delay", state_prediction.max_delay);
+  param_loader.loadParam("state_prediction/history_length", state_prediction.history_length);
+
+  // flight recorder
+  bool        flight_recorder_enabled;
+  std::string flight_recorder_directory;
+  int         flight_recorder_capacity;
+
+  param_loader.loadParam("flight_recorder/enabled", flight_recorder_enabled);
+  param_loader.loadParam("flight_recorder/directory", flight_recorder_directory);
+  param_loader.loadParam("flight_recorder/capacity", flight_recorder_capacity);
+
+  // diagnostics
+  common::ControllerHealthParams_t health;
+
+  param_loader.loadParam("diagnostics/rate", health.rate);
+  param_loader.loadParam("diagnostics/max_update_time", health.max_update_time);
+
+  // high-rate odometry
+  param_loader.loadParam("high_rate/enabled", _high_rate_.enabled);
+  param_loader.loadParam("high_rate/min_dt", _high_rate_.min_dt);
+  param_loader.loadParam("high_rate/transform_decimation", _high_rate_.transform_decimation);
+  param_loader.loadParam("high_rate/mpc_decimation", _high_rate_mpc_decimation_);
+  param_loader.loadParam("high_rate/update_budget", _high_rate_.update_budget);
+
+  // shadow mode
+  common::ShadowModeParams_t shadow;
+
+  param_loader.loadParam("shadow_mode/enabled", shadow.enabled);
+  param_loader.loadParam("shadow_mode/queue_size", shadow.queue_size);
+  param_loader.loadParam("shadow_mode/log_period", shadow.log_period);
+  param_loader.loadParam("shadow_mode/max_stamp_offset", shadow.max_stamp_offset);
+  param_loader.loadParam("shadow_mode/cpus", shadow.cpus);
+
   if (!param_loader.loadedSuccessfully()) {
     ROS_ERROR("[%s]: Could not load all parameters!", this->name_.c_str());
     ros::shutdown();
@@ -316,18 +570,156 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
     ros::shutdown();
   }
 
+  if (_n_states_ != 3) {
+    ROS_ERROR("[%s]: mpc_model/number_of_states has to be 3!", this->name_.c_str());
+    ros::shutdown();
+  }
+
+  if (_mat_Q_.size() != 3 || _mat_S_.size() != 3 || _mat_Q_z_.size() != 3 || _mat_S_z_.size() != 3) {
+    ROS_ERROR("[%s]: the Q and S matrix diagonals have to have 3 elements!", this->name_.c_str());
+    ros::shutdown();
+  }
+
   uav_mass_difference_ = 0;
   Iw_w_                = Eigen::Vector2d::Zero(2);
   Ib_b_                = Eigen::Vector2d::Zero(2);
 
+  // | ---------------- prepare the state predictor --------------- |
+
+  if (state_prediction_delay_mode == "measured") {
+    state_prediction.measure_delay = true;
+  } else if (state_prediction_delay_mode == "fixed") {
+    state_prediction.measure_delay = false;
+  } else {
+    ROS_ERROR("[%s]: state_prediction/delay_mode has to be {\"measured\", \"fixed\"}!", this->name_.c_str());
+    ros::shutdown();
+    return;
+  }
+
+  state_predictor_ = std::make_unique<common::StatePredictor>(state_prediction);
+
+  // | --------------- prepare the flight recorder -------------- |
+
+  if (flight_recorder_enabled && !shadow_instance_) {
+
+    std::string path = common::getFlightRecorderPath(flight_recorder_directory, name_);
+
+    flight_recorder_ = std::make_unique<common::FlightRecorder>(path, size_t(std::max(flight_recorder_capacity, 1)), "MpcController");
+
+    if (flight_recorder_->isOpen()) {
+      ROS_INFO("[%s]: recording the flight into '%s'", this->name_.c_str(), path.c_str());
+    } else {
+      ROS_ERROR("[%s]: could not open the flight recorder: %s", this->name_.c_str(), flight_recorder_->getError().c_str());
+      flight_recorder_.reset();
+    }
+  }
+
+  // | ------------------ high-rate odometry ------------------- |
+
+  if (_high_rate_.enabled) {
+
+    _min_dt_             = _high_rate_.min_dt;
+    transform_decimator_ = common::Decimator(_high_rate_.transform_decimation);
+    mpc_decimator_       = common::Decimator(_high_rate_mpc_decimation_);
+
+    health.max_update_time = _high_rate_.update_budget;
+
+    ROS_INFO("[%s]: high-rate odometry: min dt %.4f s, transforms on every %d. update, MPC on every %d. update, budget %.1f us", this->name_.c_str(),
+             _min_dt_, transform_decimator_.getPeriod(), mpc_decimator_.getPeriod(), 1e6 * _high_rate_.update_budget);
+
+  } else {
+
+    _min_dt_ = 0.001;
+  }
+
+  health_ = std::make_unique<common::ControllerHealth>(name_, std::vector<std::string>{"mass difference [kg]", "disturbance [m/s^2]"}, health);
+
+  // | ---------------- prepare the time schedule --------------- |
+
+  std::vector<double> dts;
+
+  if (_dt_schedule_type_ == "two_step") {
+
+    dts = mpc_solver::createTwoStepSchedule(_horizon_length_, _dt1_, _dt2_);
+
+  } else if (_dt_schedule_type_ == "geometric") {
+
+    dts = mpc_solver::createGeometricSchedule(_horizon_length_, _dt1_, _dt2_, _dt_schedule_ratio_, _dt_schedule_max_dt_);
+
+  } else if (_dt_schedule_type_ == "list") {
+
+    // the list defines the horizon length
+    dts              = _dt_schedule_list_;
+    _horizon_length_ = int(dts.size());
+
+  } else {
+    ROS_ERROR("[%s]: mpc_model/schedule/type has to be {two_step, geometric, list}!", this->name_.c_str());
+    ros::shutdown();
+    return;
+  }
+
+  if (dts.empty() || *std::min_element(dts.begin(), dts.end()) <= 0) {
+    ROS_ERROR("[%s]: the MPC time schedule has to contain at least one step and all the steps have to be positive!", this->name_.c_str());
+    ros::shutdown();
+    return;
+  }
+
   // | ----------------- prepare the MPC solver ----------------- |
 
-  mpc_solver_x_ = std::make_unique<mrs_mpc_solvers::mpc_controller::Solver>(
-      mrs_mpc_solvers::mpc_controller::Solver(name_, _mpc_solver_verbose_, _mpc_solver_max_iterations_, _mat_Q_, _mat_S_, _dt1_, _dt2_, 0, 1.0));
-  mpc_solver_y_ = std::make_unique<mrs_mpc_solvers::mpc_controller::Solver>(
-      mrs_mpc_solvers::mpc_controller::Solver(name_, _mpc_solver_verbose_, _mpc_solver_max_iterations_, _mat_Q_, _mat_S_, _dt1_, _dt2_, 0, 1.0));
-  mpc_solver_z_ = std::make_unique<mrs_mpc_solvers::mpc_controller::Solver>(
-      mrs_mpc_solvers::mpc_controller::Solver(name_, _mpc_solver_verbose_, _mpc_solver_max_iterations_, _mat_Q_z_, _mat_S_z_, _dt1_, _dt2_, 0.5, 0.5));
+  mpc_model_horizontal_ = std::make_unique<mpc_solver::MpcModel>(dts, 0, 1.0);
+  mpc_model_vertical_   = std::make_unique<mpc_solver::MpcModel>(dts, 0.5, 0.5);
+
+  ROS_INFO("[%s]: the MPC horizon has %d steps and reaches %.2f s ahead", this->name_.c_str(), mpc_model_horizontal_->horizonLength(),
+           mpc_model_horizontal_->horizonTime());
+
+  MpcWeights_t weights;
+  weights.Q_horizontal = Eigen::Vector3d(_mat_Q_[0], _mat_Q_[1], _mat_Q_[2]);
+  weights.S_horizontal = Eigen::Vector3d(_mat_S_[0], _mat_S_[1], _mat_S_[2]);
+  weights.Q_vertical   = Eigen::Vector3d(_mat_Q_z_[0], _mat_Q_z_[1], _mat_Q_z_[2]);
+  weights.S_vertical   = Eigen::Vector3d(_mat_S_z_[0], _mat_S_z_[1], _mat_S_z_[2]);
+
+  mpc_solver_params_.name           = name_;
+  mpc_solver_params_.verbose        = _mpc_solver_verbose_;
+  mpc_solver_params_.max_iterations = _mpc_solver_max_iterations_;
+  mpc_solver_params_.Q              = weights.Q_horizontal;
+  mpc_solver_params_.S              = weights.S_horizontal;
+
+  // the legacy library serializes all its instances on one mutex, the copy of the shadow mode would hold it on its
+  // SCHED_IDLE worker while the active controller waits for it in its solve()
+  if (shadow_instance_) {
+    _mpc_solver_backend_ = "admm";
+  }
+
+  mpc_solver_backend_type_ = selectMpcSolverBackend(*mpc_model_horizontal_, mpc_solver_params_);
+
+  mpc_setup_      = createMpcSetup(weights, nullptr);
+  mpc_setup_last_ = mpc_setup_;
+
+  if (!mpc_setup_) {
+    ROS_ERROR("[%s]: could not create the MPC solver backend '%s'", this->name_.c_str(), mpc_solver_backend_type_.c_str());
+    ros::shutdown();
+    return;
+  }
+
+  ROS_INFO("[%s]: using the '%s' MPC solver backend (admm kernels: %s)", this->name_.c_str(), mpc_solver_backend_type_.c_str(),
+           mpc_solver::getAdmmKernelIsa());
+
+  mpc_problem_x_ = mpc_solver::createMpcProblem(*mpc_model_horizontal_);
+  mpc_problem_y_ = mpc_solver::createMpcProblem(*mpc_model_horizontal_);
+  mpc_problem_z_ = mpc_solver::createMpcProblem(*mpc_model_vertical_);
+
+  // | --------------- prepare the disturbance observers --------------- |
+
+  disturbance_observer_x_ = std::make_unique<mpc_solver::DisturbanceObserver>(
+      _disturbance_observer_bandwidth_horizontal_, _disturbance_observer_damping_horizontal_, _disturbance_observer_max_horizontal_);
+  disturbance_observer_y_ = std::make_unique<mpc_solver::DisturbanceObserver>(
+      _disturbance_observer_bandwidth_horizontal_, _disturbance_observer_damping_horizontal_, _disturbance_observer_max_horizontal_);
+  disturbance_observer_z_ = std::make_unique<mpc_solver::DisturbanceObserver>(
+      _disturbance_observer_bandwidth_vertical_, _disturbance_observer_damping_vertical_, _disturbance_observer_max_vertical_);
+
+  // the weights can be changed by the dynamic reconfigure, the solver is then re-set up in the background
+  mpc_setup_request_ = weights;
+  mpc_setup_thread_  = std::thread(&MpcController::mpcSetupThread, this);
 
   // | --------------- dynamic reconfigure server --------------- |
 
@@ -340,19 +732,76 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
   drs_params_.kiwxy_lim = kiwxy_lim_;
   drs_params_.kibxy_lim = kibxy_lim_;
 
+  drs_params_.mpc_Q_xy_pos = weights.Q_horizontal[0];
+  drs_params_.mpc_Q_xy_vel = weights.Q_horizontal[1];
+  drs_params_.mpc_Q_xy_acc = weights.Q_horizontal[2];
+  drs_params_.mpc_S_xy_pos = weights.S_horizontal[0];
+  drs_params_.mpc_S_xy_vel = weights.S_horizontal[1];
+  drs_params_.mpc_S_xy_acc = weights.S_horizontal[2];
+
+  drs_params_.max_speed_horizontal        = _max_speed_horizontal_;
+  drs_params_.max_acceleration_horizontal = _max_acceleration_horizontal_;
+  drs_params_.max_jerk_horizontal         = _max_jerk_;
+
+  drs_params_.mpc_Q_z_pos = weights.Q_vertical[0];
+  drs_params_.mpc_Q_z_vel = weights.Q_vertical[1];
+  drs_params_.mpc_Q_z_acc = weights.Q_vertical[2];
+  drs_params_.mpc_S_z_pos = weights.S_vertical[0];
+  drs_params_.mpc_S_z_vel = weights.S_vertical[1];
+  drs_params_.mpc_S_z_acc = weights.S_vertical[2];
+
+  drs_params_.max_speed_vertical        = _max_speed_vertical_;
+  drs_params_.max_acceleration_vertical = _max_acceleration_vertical_;
+  drs_params_.max_u_vertical            = _max_u_vertical_;
+
+  // the copy for the shadow mode ends here, the drs params come from the live instance
+  if (shadow_instance_) {
+
+    profiler = mrs_lib::Profiler(nh_, "MpcController", false);
+
+    is_initialized_ = true;
+    return;
+  }
+
   drs_.reset(new Drs_t(mutex_drs_, nh_));
   drs_->updateConfig(drs_params_);
   Drs_t::CallbackType f = boost::bind(&MpcController::callbackDrs, this, _1, _2);
   drs_->setCallback(f);
 
+  timer_drs_write_back_ = nh_.createTimer(ros::Rate(_gains_filter_write_back_rate_), &MpcController::timerDrsWriteBack, this);
+
   // | --------------------- service servers -------------------- |
 
   service_set_integral_terms_ = nh_.advertiseService("set_integral_terms_in", &MpcController::callbackSetIntegralTerms, this);
 
+  // | ----------------------- publishers ----------------------- |
+
+  health_->advertise(nh_);
+
   // | ------------------------ profiler ------------------------ |
 
   profiler = mrs_lib::Profiler(nh_, "MpcController", profiler_enabled_);
 
+  // | ----------------------- shadow mode ---------------------- |
+
+  if (shadow.enabled) {
+
+    shadow_controller_                   = std::make_unique<MpcController>();
+    shadow_controller_->shadow_instance_ = true;
+    shadow_controller_->initialize(parent_nh, name, name_space, uav_mass, common_handlers);
+
+    if (shadow_controller_->mpc_solver_backend_type_ != mpc_solver_backend_type_) {
+      ROS_WARN("[%s]: the shadow mode solves with the '%s' MPC solver backend, its divergence includes the difference from '%s'", this->name_.c_str(),
+               shadow_controller_->mpc_solver_backend_type_.c_str(), mpc_solver_backend_type_.c_str());
+    }
+
+    shadow_mode_ = std::make_unique<common::ShadowMode>(name_, shadow, [this](const common::ShadowFrame_t &frame) { return updateShadow(frame); });
+    shadow_mode_->start(nh_);
+
+    // the controller is loaded inactive
+    shadow_mode_->resume();
+  }
+
   // | ----------------------- finish init ---------------------- |
 
   ROS_INFO("[%s]: initialized, version %s", this->name_.c_str(), VERSION);
@@ -366,10 +815,16 @@ void MpcController::initialize(const ros::NodeHandle &parent_nh, const std::stri
 
 bool MpcController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &last_attitude_cmd) {
 
+  CONTROLLER_TRACE1(activate, name_.c_str());
+
+  // the copy of the shadow mode, activated by its worker
+  const bool shadow = shadow_instance_;
+
   if (last_attitude_cmd == mrs_msgs::AttitudeCommand::Ptr()) {
 
     ROS_WARN("[%s]: activated without getting the last controllers's command", this->name_.c_str());
 
+    // the controller stays inactive, the shadow evaluation goes on
     return false;
 
   } else {
@@ -391,6 +846,23 @@ bool MpcController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &last_att
     ROS_INFO("[%s]: activated with the last controllers's command", this->name_.c_str());
   }
 
+  // the integrals and the mass difference taken over from the last command are kept as a constant feedforward,
+  // the observers estimate only what is left
+  {
+    std::scoped_lock lock(mutex_integrals_);
+
+    disturbance_observer_x_->reset(0, 0);
+    disturbance_observer_y_->reset(0, 0);
+    disturbance_observer_z_->reset(0, 0);
+
+    disturbance_observer_reset_ = true;
+    last_output_saturated_      = false;
+  }
+
+  state_predictor_->reset();
+  transform_decimator_.reset();
+  mpc_decimator_.reset();
+
   // rampup check
   if (_rampup_enabled_) {
 
@@ -418,7 +890,12 @@ bool MpcController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &last_att
   first_iteration_ = true;
   gains_muted_     = true;
 
-  ROS_INFO("[%s]: activated", this->name_.c_str());
+  // does not wait, the copy keeps evaluating the frame it has, its output is dropped
+  if (shadow_mode_) {
+    shadow_mode_->pause();
+  }
+
+  ROS_INFO("[%s]: activated%s", this->name_.c_str(), shadow ? " in the shadow mode" : "");
 
   is_active_ = true;
 
@@ -431,11 +908,17 @@ bool MpcController::activate(const mrs_msgs::AttitudeCommand::ConstPtr &last_att
 
 void MpcController::deactivate(void) {
 
+  CONTROLLER_TRACE1(deactivate, name_.c_str());
+
   is_active_           = false;
   first_iteration_     = false;
   uav_mass_difference_ = 0;
 
   ROS_INFO("[%s]: deactivated", this->name_.c_str());
+
+  if (shadow_mode_) {
+    shadow_mode_->resume();
+  }
 }
 
 //}
@@ -448,13 +931,23 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
   mrs_lib::Routine    profiler_routine = profiler.createRoutine("update");
   mrs_lib::ScopeTimer timer = mrs_lib::ScopeTimer("MpcController::update", common_handlers_->scope_timer.logger, common_handlers_->scope_timer.enabled);
 
-  {
-    std::scoped_lock lock(mutex_uav_state_);
+  // the copy of the shadow mode, without any output or record
+  const bool shadow = shadow_instance_;
 
-    uav_state_ = *uav_state;
-  }
+  common::UpdateTrace update_trace(name_.c_str());
+  common::CpuTimeScope cpu_time_scope(*health_, shadow ? common::CPU_BACKGROUND : common::CPU_UPDATE);
+
+  auto update_start = std::chrono::steady_clock::now();
+
+  boost::atomic_store(&uav_state_, uav_state);
 
   if (!is_active_) {
+
+    // the same inputs as the active controller has in this iteration
+    if (shadow_mode_) {
+      shadow_mode_->addInputs(uav_state, control_reference);
+    }
+
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
 
@@ -462,9 +955,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
 
-  // | -------------------- calculate the dt -------------------- |
+  // the state predicted over the latency, the header stays in the measured message
+  const common::PredictedState_t state = state_predictor_->predict(*uav_state, ros::Time::now());
 
-  double dt;
+  // | -------------------- calculate the dt -------------------- |
 
   if (first_iteration_) {
 
@@ -473,16 +967,13 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     first_iteration_ = false;
 
     return mrs_msgs::AttitudeCommand::ConstPtr(new mrs_msgs::AttitudeCommand(activation_attitude_cmd_));
-
-  } else {
-
-    dt                = (uav_state->header.stamp - last_update_time_).toSec();
-    last_update_time_ = uav_state->header.stamp;
   }
 
-  if (fabs(dt) <= 0.001) {
+  std::optional<double> odometry_dt = common::odometryDt(uav_state->header.stamp, last_update_time_, _min_dt_);
 
-    ROS_DEBUG("[%s]: the last odometry message came too close (%.2f s)!", this->name_.c_str(), dt);
+  if (!odometry_dt) {
+
+    ROS_DEBUG("[%s]: the last odometry message came too close or out of order, skipping it", this->name_.c_str());
 
     if (last_attitude_cmd_ != mrs_msgs::AttitudeCommand::Ptr()) {
 
@@ -494,17 +985,26 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
   }
 
+  double dt = odometry_dt.value();
+
+  flight_record_ = common::FlightRecord_t();
+
+  // at high rates, the transformer is queried only on every n-th update, the orientation of the UAV state is used in between
+  bool lookup_transforms = transform_decimator_.tick();
+
   // | ----------------- get the current heading ---------------- |
 
-  double uav_heading = 0;
+  std::optional<double> heading = common::getHeading(state.orientation.toRotationMatrix());
 
-  try {
-    uav_heading = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getHeading();
-  }
-  catch (...) {
-    ROS_ERROR_THROTTLE(1.0, "[%s]: could not calculate the UAV heading", name_.c_str());
+  if (heading) {
+    last_uav_heading_ = heading.value();
+  } else {
+    flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+    ROS_ERROR_THROTTLE(1.0, "[%s]: could not calculate the UAV heading, using the last one", name_.c_str());
   }
 
+  double uav_heading = last_uav_heading_;
+
   if (control_reference->disable_antiwindups) {
     ROS_INFO_THROTTLE(1.0, "[%s]: antiwindups disabled by tracker", name_.c_str());
   }
@@ -529,32 +1029,47 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
   if (control_reference->use_heading_rate) {
 
     // to fill in the desired yaw rate (as the last degree of freedom), we need the desired orientation and the current desired roll and pitch rate
-    double desired_yaw_rate = 0;
-    try {
-      desired_yaw_rate = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getYawRateIntrinsic(control_reference->heading_rate);
-    }
-    catch (...) {
-      ROS_ERROR("[%s]: exception caught while calculating the desired_yaw_rate feedforward", name_.c_str());
+    std::optional<double> desired_yaw_rate =
+        common::getYawRateIntrinsic(state.orientation.toRotationMatrix(), control_reference->heading_rate);
+
+    if (!desired_yaw_rate) {
+      flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+      ROS_ERROR_THROTTLE(1.0, "[%s]: could not calculate the desired_yaw_rate feedforward, skipping it", name_.c_str());
     }
 
-    Rw << 0, 0, desired_yaw_rate;
+    Rw << 0, 0, desired_yaw_rate.value_or(0.0);
   }
 
   // Op - position in global frame
   // Ov - velocity in global frame
-  Eigen::Vector3d Op(uav_state->pose.position.x, uav_state->pose.position.y, uav_state->pose.position.z);
-  Eigen::Vector3d Ov(uav_state->velocity.linear.x, uav_state->velocity.linear.y, uav_state->velocity.linear.z);
+  Eigen::Vector3d Op = state.position;
+  Eigen::Vector3d Ov = state.velocity;
 
   // R - current uav attitude
-  Eigen::Matrix3d R = mrs_lib::AttitudeConverter(uav_state->pose.orientation);
+  Eigen::Matrix3d R = state.orientation.toRotationMatrix();
 
   // Ow - UAV angular rate
-  Eigen::Vector3d Ow(uav_state->velocity.angular.x, uav_state->velocity.angular.y, uav_state->velocity.angular.z);
+  Eigen::Vector3d Ow = state.attitude_rate;
 
   // --------------------------------------------------------------
   // |                     MPC lateral control                    |
   // --------------------------------------------------------------
 
+  // | -------- swap in the solver setup prepared offline -------- |
+
+  {
+    std::shared_ptr<MpcSetup_t> pending = std::atomic_exchange(&mpc_setup_pending_, std::shared_ptr<MpcSetup_t>());
+
+    if (pending) {
+      mpc_setup_ = pending;
+    }
+  }
+
+  // | ------------------------- limits ------------------------- |
+
+  MpcLimits_t limits        = getMpcLimits(false);
+  MpcLimits_t solver_limits = getMpcLimits(true);
+
   // | --------------- calculate the control erros -------------- |
 
   Eigen::Vector3d Ep = Op - Rp;
@@ -562,9 +1077,9 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
   // | ------------------- initial conditions ------------------- |
 
-  Eigen::MatrixXd initial_x = Eigen::MatrixXd::Zero(3, 1);
-  Eigen::MatrixXd initial_y = Eigen::MatrixXd::Zero(3, 1);
-  Eigen::MatrixXd initial_z = Eigen::MatrixXd::Zero(3, 1);
+  Eigen::Vector3d initial_x = Eigen::Vector3d::Zero();
+  Eigen::Vector3d initial_y = Eigen::Vector3d::Zero();
+  Eigen::Vector3d initial_z = Eigen::Vector3d::Zero();
 
   /* initial x //{ */
 
@@ -573,25 +1088,25 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     double velocity;
     double coef = 1.5;
 
-    if (fabs(uav_state->acceleration.linear.x) < coef * _max_acceleration_horizontal_) {
-      acceleration = uav_state->acceleration.linear.x;
+    if (fabs(state.acceleration[0]) < coef * limits.acceleration_horizontal) {
+      acceleration = state.acceleration[0];
     } else {
       acceleration = control_reference->acceleration.x;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry x acceleration exceeds constraints (%.2f > %.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->acceleration.linear.x), coef, _max_acceleration_horizontal_);
+                         fabs(state.acceleration[0]), coef, limits.acceleration_horizontal);
     }
 
-    if (fabs(uav_state->velocity.linear.x) < coef * _max_speed_horizontal_) {
-      velocity = uav_state->velocity.linear.x;
+    if (fabs(state.velocity[0]) < coef * limits.speed_horizontal) {
+      velocity = state.velocity[0];
     } else {
       velocity = control_reference->velocity.x;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry x velocity exceeds constraints (%.2f > %0.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->velocity.linear.x), coef, _max_speed_horizontal_);
+                         fabs(state.velocity[0]), coef, limits.speed_horizontal);
     }
 
-    initial_x << uav_state->pose.position.x, velocity, acceleration;
+    initial_x << state.position[0], velocity, acceleration;
   }
 
   //}
@@ -603,25 +1118,25 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     double velocity;
     double coef = 1.5;
 
-    if (fabs(uav_state->acceleration.linear.y) < coef * _max_acceleration_horizontal_) {
-      acceleration = uav_state->acceleration.linear.y;
+    if (fabs(state.acceleration[1]) < coef * limits.acceleration_horizontal) {
+      acceleration = state.acceleration[1];
     } else {
       acceleration = control_reference->acceleration.y;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry y acceleration exceeds constraints (%.2f > %.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->acceleration.linear.y), coef, _max_acceleration_horizontal_);
+                         fabs(state.acceleration[1]), coef, limits.acceleration_horizontal);
     }
 
-    if (fabs(uav_state->velocity.linear.y) < coef * _max_speed_horizontal_) {
-      velocity = uav_state->velocity.linear.y;
+    if (fabs(state.velocity[1]) < coef * limits.speed_horizontal) {
+      velocity = state.velocity[1];
     } else {
       velocity = control_reference->velocity.y;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry y velocity exceeds constraints (%.2f > %0.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->velocity.linear.y), coef, _max_speed_horizontal_);
+                         fabs(state.velocity[1]), coef, limits.speed_horizontal);
     }
 
-    initial_y << uav_state->pose.position.y, velocity, acceleration;
+    initial_y << state.position[1], velocity, acceleration;
   }
 
   //}
@@ -633,50 +1148,50 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     double velocity;
     double coef = 1.5;
 
-    if (fabs(uav_state->acceleration.linear.z) < coef * _max_acceleration_horizontal_) {
-      acceleration = uav_state->acceleration.linear.z;
+    if (fabs(state.acceleration[2]) < coef * limits.acceleration_horizontal) {
+      acceleration = state.acceleration[2];
     } else {
       acceleration = control_reference->acceleration.z;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry z acceleration exceeds constraints (%.2f > %.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->acceleration.linear.z), coef, _max_acceleration_horizontal_);
+                         fabs(state.acceleration[2]), coef, limits.acceleration_horizontal);
     }
 
-    if (fabs(uav_state->velocity.linear.z) < coef * _max_speed_vertical_) {
-      velocity = uav_state->velocity.linear.z;
+    if (fabs(state.velocity[2]) < coef * limits.speed_vertical) {
+      velocity = state.velocity[2];
     } else {
       velocity = control_reference->velocity.z;
 
       ROS_ERROR_THROTTLE(1.0, "[%s]: odometry z velocity exceeds constraints (%.2f > %0.1f * %.2f m), using reference for initial condition", name_.c_str(),
-                         fabs(uav_state->velocity.linear.z), coef, _max_speed_vertical_);
+                         fabs(state.velocity[2]), coef, limits.speed_vertical);
     }
 
-    initial_z << uav_state->pose.position.z, velocity, acceleration;
+    initial_z << state.position[2], velocity, acceleration;
   }
 
   //}
 
   // | ---------------------- set reference --------------------- |
 
-  Eigen::MatrixXd mpc_reference_x = Eigen::MatrixXd::Zero(_horizon_length_ * _n_states_, 1);
-  Eigen::MatrixXd mpc_reference_y = Eigen::MatrixXd::Zero(_horizon_length_ * _n_states_, 1);
-  Eigen::MatrixXd mpc_reference_z = Eigen::MatrixXd::Zero(_horizon_length_ * _n_states_, 1);
+  mpc_problem_x_.reference.setZero();
+  mpc_problem_y_.reference.setZero();
+  mpc_problem_z_.reference.setZero();
 
   // prepare the full reference vector
   for (int i = 0; i < _horizon_length_; i++) {
 
-    mpc_reference_x((i * _n_states_) + 0, 0) = control_reference->position.x;
-    mpc_reference_y((i * _n_states_) + 0, 0) = control_reference->position.y;
-    mpc_reference_z((i * _n_states_) + 0, 0) = control_reference->position.z;
+    mpc_problem_x_.reference((i * _n_states_) + 0) = control_reference->position.x;
+    mpc_problem_y_.reference((i * _n_states_) + 0) = control_reference->position.y;
+    mpc_problem_z_.reference((i * _n_states_) + 0) = control_reference->position.z;
   }
 
   // | ------------------ set the penalizations ----------------- |
 
-  std::vector<double> temp_Q_horizontal = _mat_Q_;
-  std::vector<double> temp_Q_vertical   = _mat_Q_z_;
+  Eigen::Vector3d temp_Q_horizontal = mpc_setup_->weights.Q_horizontal;
+  Eigen::Vector3d temp_Q_vertical   = mpc_setup_->weights.Q_vertical;
 
-  std::vector<double> temp_S_horizontal = _mat_S_;
-  std::vector<double> temp_S_vertical   = _mat_S_z_;
+  Eigen::Vector3d temp_S_horizontal = mpc_setup_->weights.S_horizontal;
+  Eigen::Vector3d temp_S_vertical   = mpc_setup_->weights.S_vertical;
 
   if (!control_reference->use_position_horizontal) {
     temp_Q_horizontal[0] = 0;
@@ -698,43 +1213,127 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     temp_S_vertical[1] = 0;
   }
 
+  // | ------------------ disturbance observers ----------------- |
+
+  Eigen::Vector3d disturbance = Eigen::Vector3d::Zero();
+
+  if (_disturbance_observer_enabled_) {
+
+    std::scoped_lock lock(mutex_integrals_);
+
+    Eigen::Vector3d velocity = state.velocity;
+
+    std::array<mpc_solver::DisturbanceObserver *, 3> observers = {disturbance_observer_x_.get(), disturbance_observer_y_.get(),
+                                                                  disturbance_observer_z_.get()};
+
+    for (int i = 0; i < 3; i++) {
+
+      // the estimate is not updated when the commanded acceleration could not be realized
+      if (disturbance_observer_reset_ || rampup_active_ || last_output_saturated_) {
+        observers[i]->reset(velocity[i], observers[i]->getDisturbance());
+      } else {
+        observers[i]->update(velocity[i], last_acceleration_cmd_[i], dt);
+      }
+
+      disturbance[i] = observers[i]->getDisturbance();
+    }
+
+    disturbance_observer_reset_ = false;
+
+    if (disturbance_observer_x_->isSaturated() || disturbance_observer_y_->isSaturated() || disturbance_observer_z_->isSaturated()) {
+      ROS_WARN_THROTTLE(1.0, "[%s]: the disturbance estimate is being saturated!", this->name_.c_str());
+    }
+  }
+
+  // the acceleration has to counteract the disturbance in the steady state
+  for (int i = 0; i < _horizon_length_; i++) {
+
+    mpc_problem_x_.reference((i * _n_states_) + 2) = -disturbance[0];
+    mpc_problem_y_.reference((i * _n_states_) + 2) = -disturbance[1];
+    mpc_problem_z_.reference((i * _n_states_) + 2) = -disturbance[2];
+  }
+
   // | ------------------------ optimize ------------------------ |
 
-  mpc_solver_x_->lock();
-  mpc_solver_x_->setQ(temp_Q_horizontal);
-  mpc_solver_x_->setS(temp_S_horizontal);
-  mpc_solver_x_->setParams();
-  mpc_solver_x_->setLastInput(mpc_solver_x_u_);
-  mpc_solver_x_->loadReference(mpc_reference_x);
-  mpc_solver_x_->setLimits(_max_speed_horizontal_, 999, _max_acceleration_horizontal_, _max_jerk_, _dt1_, _dt2_);
-  mpc_solver_x_->setInitialState(initial_x);
-  [[maybe_unused]] int iters_x = mpc_solver_x_->solveMPC();
-  mpc_solver_x_u_              = mpc_solver_x_->getFirstControlInput();
-  mpc_solver_x_->unlock();
-
-  mpc_solver_y_->lock();
-  mpc_solver_y_->setQ(temp_Q_horizontal);
-  mpc_solver_y_->setS(temp_S_horizontal);
-  mpc_solver_y_->setParams();
-  mpc_solver_y_->setLastInput(mpc_solver_y_u_);
-  mpc_solver_y_->loadReference(mpc_reference_y);
-  mpc_solver_y_->setLimits(_max_speed_horizontal_, 999, _max_acceleration_horizontal_, _max_jerk_, _dt1_, _dt2_);
-  mpc_solver_y_->setInitialState(initial_y);
-  [[maybe_unused]] int iters_y = mpc_solver_y_->solveMPC();
-  mpc_solver_y_u_              = mpc_solver_y_->getFirstControlInput();
-  mpc_solver_y_->unlock();
-
-  mpc_solver_z_->lock();
-  mpc_solver_z_->setQ(temp_Q_vertical);
-  mpc_solver_z_->setS(temp_S_vertical);
-  mpc_solver_z_->setParams();
-  mpc_solver_z_->setLastInput(mpc_solver_z_u_);
-  mpc_solver_z_->loadReference(mpc_reference_z);
-  mpc_solver_z_->setLimits(_max_speed_vertical_, _max_acceleration_vertical_, _max_u_vertical_, 999.0, _dt1_, _dt2_);
-  mpc_solver_z_->setInitialState(initial_z);
-  [[maybe_unused]] int iters_z = mpc_solver_z_->solveMPC();
-  mpc_solver_z_u_              = mpc_solver_z_->getFirstControlInput();
-  mpc_solver_z_->unlock();
+  mpc_problem_x_.initial_state    = initial_x;
+  mpc_problem_x_.Q                = temp_Q_horizontal;
+  mpc_problem_x_.S                = temp_S_horizontal;
+  mpc_problem_x_.max_speed        = solver_limits.speed_horizontal;
+  mpc_problem_x_.max_acceleration = 999;
+  mpc_problem_x_.max_u            = solver_limits.acceleration_horizontal;
+  mpc_problem_x_.max_du           = solver_limits.jerk_horizontal;
+  mpc_problem_x_.last_input       = mpc_solver_x_u_;
+  mpc_problem_x_.disturbance      = disturbance[0];
+
+  mpc_problem_y_.initial_state    = initial_y;
+  mpc_problem_y_.Q                = temp_Q_horizontal;
+  mpc_problem_y_.S                = temp_S_horizontal;
+  mpc_problem_y_.max_speed        = solver_limits.speed_horizontal;
+  mpc_problem_y_.max_acceleration = 999;
+  mpc_problem_y_.max_u            = solver_limits.acceleration_horizontal;
+  mpc_problem_y_.max_du           = solver_limits.jerk_horizontal;
+  mpc_problem_y_.last_input       = mpc_solver_y_u_;
+  mpc_problem_y_.disturbance      = disturbance[1];
+
+  mpc_problem_z_.initial_state    = initial_z;
+  mpc_problem_z_.Q                = temp_Q_vertical;
+  mpc_problem_z_.S                = temp_S_vertical;
+  mpc_problem_z_.max_speed        = solver_limits.speed_vertical;
+  mpc_problem_z_.max_acceleration = solver_limits.acceleration_vertical;
+  mpc_problem_z_.max_u            = solver_limits.u_vertical;
+  mpc_problem_z_.max_du           = 999.0;
+  mpc_problem_z_.last_input       = mpc_solver_z_u_;
+  mpc_problem_z_.disturbance      = disturbance[2];
+
+  mpc_solver::MpcSolution_t solution_x, solution_y, solution_z;
+
+  // at high rates, the MPC is solved only on every n-th update, its first input is held in between
+  if (mpc_decimator_.tick()) {
+
+    auto solve_start = std::chrono::steady_clock::now();
+
+    if (solveMpc(*mpc_setup_->solver_x, *mpc_setup_->fast_path_horizontal, mpc_problem_x_, solution_x)) {
+      mpc_solver_x_u_ = solution_x.first_input;
+    } else {
+      flight_record_.flags |= FLIGHT_RECORD_MPC_FAILED;
+      ROS_ERROR_THROTTLE(1.0, "[%s]: the MPC solver failed for the x axis", this->name_.c_str());
+    }
+
+    if (solveMpc(*mpc_setup_->solver_y, *mpc_setup_->fast_path_horizontal, mpc_problem_y_, solution_y)) {
+      mpc_solver_y_u_ = solution_y.first_input;
+    } else {
+      flight_record_.flags |= FLIGHT_RECORD_MPC_FAILED;
+      ROS_ERROR_THROTTLE(1.0, "[%s]: the MPC solver failed for the y axis", this->name_.c_str());
+    }
+
+    if (solveMpc(*mpc_setup_->solver_z, *mpc_setup_->fast_path_vertical, mpc_problem_z_, solution_z)) {
+      mpc_solver_z_u_ = solution_z.first_input;
+    } else {
+      flight_record_.flags |= FLIGHT_RECORD_MPC_FAILED;
+      ROS_ERROR_THROTTLE(1.0, "[%s]: the MPC solver failed for the z axis", this->name_.c_str());
+    }
+
+    if (!shadow) {
+      health_->addSolve(solution_x.iterations, solution_x.iterations >= _mpc_solver_max_iterations_, solution_x.fast_path);
+      health_->addSolve(solution_y.iterations, solution_y.iterations >= _mpc_solver_max_iterations_, solution_y.fast_path);
+      health_->addSolve(solution_z.iterations, solution_z.iterations >= _mpc_solver_max_iterations_, solution_z.fast_path);
+    }
+
+    if (flight_recorder_) {
+      flight_record_.mpc_solve_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - solve_start).count();
+    }
+  }
+
+  if (flight_recorder_) {
+
+    flight_record_.mpc_input[0] = mpc_solver_x_u_;
+    flight_record_.mpc_input[1] = mpc_solver_y_u_;
+    flight_record_.mpc_input[2] = mpc_solver_z_u_;
+
+    flight_record_.mpc_iterations[0] = solution_x.iterations;
+    flight_record_.mpc_iterations[1] = solution_y.iterations;
+    flight_record_.mpc_iterations[2] = solution_z.iterations;
+  }
 
   // | ----------- disable lateral feedback if needed ----------- |
 
@@ -766,7 +1365,11 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
   Eigen::Vector2d Ib_w = Eigen::Vector2d(0, 0);
 
-  {
+  if (!lookup_transforms) {
+
+    Ib_w = common::fromUntiltedFrame(Eigen::Vector3d(Ib_b_(0), Ib_b_(1), 0), uav_heading).head<2>();
+
+  } else {
 
     geometry_msgs::Vector3Stamped Ib_b_stamped;
 
@@ -776,7 +1379,9 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     Ib_b_stamped.vector.y        = Ib_b_(1);
     Ib_b_stamped.vector.z        = 0;
 
-    auto res = common_handlers_->transformer->transformSingle(Ib_b_stamped, uav_state_.header.frame_id);
+    CONTROLLER_TRACE1(transform_entry, name_.c_str());
+    auto res = common_handlers_->transformer->transformSingle(Ib_b_stamped, uav_state->header.frame_id);
+    CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
 
     if (res) {
       Ib_w[0] = res.value().vector.x;
@@ -809,6 +1414,29 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
   Eigen::Vector3d f = integral_feedback + feed_forward;
 
+  if (flight_recorder_) {
+
+    flight_record_.dt = dt;
+
+    common::recordState(flight_record_, uav_state->header.stamp, state);
+    common::recordReference(flight_record_, *control_reference);
+
+    common::recordVector(flight_record_.feedforward, feed_forward);
+    common::recordVector(flight_record_.integral_feedback, integral_feedback);
+    common::recordVector(flight_record_.disturbance, disturbance);
+  }
+
+  if (_disturbance_observer_enabled_ &&
+      (disturbance_observer_x_->isSaturated() || disturbance_observer_y_->isSaturated() || disturbance_observer_z_->isSaturated())) {
+    flight_record_.flags |= FLIGHT_RECORD_DISTURBANCE_SATURATED;
+  }
+
+  // the acceleration the observers expect during the next step, the integral feedback and the mass difference
+  // taken over at activation are a known compensation, the observers estimate only the rest
+  last_acceleration_cmd_ = Ra;
+
+  bool output_saturated = false;
+
   // | ----------- limiting the downwards acceleration ---------- |
   // the downwards force produced by the position and the acceleration feedback should not be larger than the gravity
 
@@ -845,8 +1473,20 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     ROS_INFO("[%s]: feed forward: [%.2f, %.2f, %.2f]", this->name_.c_str(), feed_forward[0], feed_forward[1], feed_forward[2]);
     ROS_INFO("[%s]: position_cmd: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", this->name_.c_str(), control_reference->position.x, control_reference->position.y,
              control_reference->position.z, control_reference->heading);
-    ROS_INFO("[%s]: odometry: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", this->name_.c_str(), uav_state->pose.position.x, uav_state->pose.position.y,
-             uav_state->pose.position.z, uav_heading);
+    ROS_INFO("[%s]: odometry: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", this->name_.c_str(), state.position[0], state.position[1],
+             state.position[2], uav_heading);
+
+    flight_record_.flags |= FLIGHT_RECORD_TILT_FAILSAFE | FLIGHT_RECORD_NULL_OUTPUT;
+
+    if (!shadow) {
+
+      if (flight_recorder_) {
+        flight_record_.theta = theta;
+        flight_recorder_->write(flight_record_);
+      }
+
+      health_->addUpdate(update_start, flight_record_.flags);
+    }
 
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
@@ -859,6 +1499,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     ROS_WARN_THROTTLE(1.0, "[%s]: tilt is being saturated, desired: %.2f deg, saturated %.2f deg", this->name_.c_str(), (theta / M_PI) * 180.0,
                       (constraints.tilt / M_PI) * 180.0);
     theta = constraints.tilt;
+
+    output_saturated = true;
+
+    flight_record_.flags |= FLIGHT_RECORD_TILT_SATURATED;
   }
 
   // reconstruct the vector
@@ -876,10 +1520,13 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     Rd = mrs_lib::AttitudeConverter(control_reference->orientation);
 
     if (control_reference->use_heading) {
-      try {
-        Rd = mrs_lib::AttitudeConverter(Rd).setHeading(control_reference->heading);
-      }
-      catch (...) {
+
+      std::optional<Eigen::Matrix3d> Rd_heading = common::setHeading(Rd, control_reference->heading);
+
+      if (Rd_heading) {
+        Rd = Rd_heading.value();
+      } else {
+        flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
         ROS_WARN_THROTTLE(1.0, "[%s]: failed to add heading to the desired orientation matrix", this->name_.c_str());
       }
     }
@@ -960,7 +1607,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
   } else if (thrust > _thrust_saturation_) {
 
-    thrust = _thrust_saturation_;
+    thrust           = _thrust_saturation_;
+    output_saturated = true;
+
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
     ROS_WARN_THROTTLE(1.0, "[%s]: saturating thrust to %.2f", this->name_.c_str(), _thrust_saturation_);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->position.x,
@@ -972,15 +1622,18 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: jerk [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->jerk.x, control_reference->jerk.y,
                       control_reference->jerk.z, control_reference->heading_jerk);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", uav_state->pose.position.x, uav_state->pose.position.y,
-                      uav_state->pose.position.z, uav_heading);
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", uav_state->velocity.linear.x,
-                      uav_state->velocity.linear.y, uav_state->velocity.linear.z, uav_state->velocity.angular.z);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", state.position[0], state.position[1],
+                      state.position[2], uav_heading);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", state.velocity[0],
+                      state.velocity[1], state.velocity[2], state.attitude_rate[2]);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
 
   } else if (thrust < 0.0) {
 
-    thrust = 0.0;
+    thrust           = 0.0;
+    output_saturated = true;
+
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
     ROS_WARN_THROTTLE(1.0, "[%s]: saturating thrust to %.2f", this->name_.c_str(), 0.0);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->position.x,
@@ -992,13 +1645,15 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: jerk [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->jerk.x, control_reference->jerk.y,
                       control_reference->jerk.z, control_reference->heading_jerk);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", uav_state->pose.position.x, uav_state->pose.position.y,
-                      uav_state->pose.position.z, uav_heading);
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", uav_state->velocity.linear.x,
-                      uav_state->velocity.linear.y, uav_state->velocity.linear.z, uav_state->velocity.angular.z);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", state.position[0], state.position[1],
+                      state.position[2], uav_heading);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", state.velocity[0],
+                      state.velocity[1], state.velocity[2], state.attitude_rate[2]);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
   }
 
+  last_output_saturated_ = output_saturated;
+
   // prepare the attitude feedback
   Eigen::Vector3d q_feedback = -Kq * Eq.array();
 
@@ -1019,20 +1674,18 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
   Eigen::Vector3d q_feedback_yawless = t;
   q_feedback_yawless(2)              = 0;  // nullyfy the effect of the original yaw feedback
 
-  double parasitic_heading_rate = 0;
+  std::optional<double> parasitic_heading_rate = common::getHeadingRate(R, q_feedback_yawless);
+  std::optional<double> compensation;
 
-  try {
-    parasitic_heading_rate = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getHeadingRate(q_feedback_yawless);
-  }
-  catch (...) {
-    ROS_ERROR("[%s]: exception caught while calculating the parasitic heading rate", name_.c_str());
+  if (parasitic_heading_rate) {
+    compensation = common::getYawRateIntrinsic(R, -parasitic_heading_rate.value());
   }
 
-  try {
-    rp_heading_rate_compensation(2) = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getYawRateIntrinsic(-parasitic_heading_rate);
-  }
-  catch (...) {
-    ROS_ERROR("[%s]: exception caught while calculating the parasitic heading rate compensation", name_.c_str());
+  if (compensation) {
+    rp_heading_rate_compensation(2) = compensation.value();
+  } else {
+    flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+    ROS_ERROR_THROTTLE(1.0, "[%s]: could not calculate the parasitic heading rate compensation, skipping it", name_.c_str());
   }
 
   t += rp_heading_rate_compensation;
@@ -1050,17 +1703,23 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     Eigen::Vector2d Ev_fcu_untilted = Eigen::Vector2d(0, 0);  // velocity error in the untilted frame of the UAV
 
     // get the position control error in the fcu_untilted frame
-    {
+    if (!lookup_transforms) {
+
+      Ep_fcu_untilted = common::toUntiltedFrame(Ep, uav_heading).head<2>();
+
+    } else {
 
       geometry_msgs::Vector3Stamped Ep_stamped;
 
       Ep_stamped.header.stamp    = ros::Time::now();
-      Ep_stamped.header.frame_id = uav_state_.header.frame_id;
+      Ep_stamped.header.frame_id = uav_state->header.frame_id;
       Ep_stamped.vector.x        = Ep(0);
       Ep_stamped.vector.y        = Ep(1);
       Ep_stamped.vector.z        = Ep(2);
 
+      CONTROLLER_TRACE1(transform_entry, name_.c_str());
       auto res = common_handlers_->transformer->transformSingle(Ep_stamped, "fcu_untilted");
+      CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
 
       if (res) {
         Ep_fcu_untilted[0] = res.value().vector.x;
@@ -1071,20 +1730,27 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     // get the velocity control error in the fcu_untilted frame
-    {
+    if (!lookup_transforms) {
+
+      Ev_fcu_untilted = common::toUntiltedFrame(Ev, uav_heading).head<2>();
+
+    } else {
+
       geometry_msgs::Vector3Stamped Ev_stamped;
 
       Ev_stamped.header.stamp    = ros::Time::now();
-      Ev_stamped.header.frame_id = uav_state_.header.frame_id;
+      Ev_stamped.header.frame_id = uav_state->header.frame_id;
       Ev_stamped.vector.x        = Ev(0);
       Ev_stamped.vector.y        = Ev(1);
       Ev_stamped.vector.z        = Ev(2);
 
+      CONTROLLER_TRACE1(transform_entry, name_.c_str());
       auto res = common_handlers_->transformer->transformSingle(Ev_stamped, "fcu_untilted");
+      CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
 
       if (res) {
         Ev_fcu_untilted[0] = res.value().vector.x;
-        Ev_fcu_untilted[1] = res.value().vector.x;
+        Ev_fcu_untilted[1] = res.value().vector.y;
       } else {
         ROS_ERROR_THROTTLE(1.0, "[%s]: could not transform the velocity error to fcu_untilted", name_.c_str());
       }
@@ -1094,8 +1760,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
     // antiwindup
     double temp_gain = kibxy_;
-    if (!control_reference->disable_antiwindups) {
-      if (rampup_active_ || sqrt(pow(uav_state->velocity.linear.x, 2) + pow(uav_state->velocity.linear.y, 2)) > 0.3) {
+    if (_disturbance_observer_enabled_) {
+      temp_gain = 0;
+    } else if (!control_reference->disable_antiwindups) {
+      if (rampup_active_ || sqrt(pow(state.velocity[0], 2) + pow(state.velocity[1], 2)) > 0.3) {
         temp_gain = 0;
         ROS_INFO_THROTTLE(1.0, "[%s]: anti-windup for body integral kicks in", this->name_.c_str());
       }
@@ -1123,6 +1791,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     if (kibxy_lim_ > 0 && body_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[%s]: MPC's body pitch integral is being saturated!", this->name_.c_str());
     }
 
@@ -1140,6 +1809,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     if (kibxy_lim_ > 0 && body_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[%s]: MPC's body roll integral is being saturated!", this->name_.c_str());
     }
   }
@@ -1161,8 +1831,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
     // antiwindup
     double temp_gain = kiwxy_;
-    if (!control_reference->disable_antiwindups) {
-      if (rampup_active_ || sqrt(pow(uav_state->velocity.linear.x, 2) + pow(uav_state->velocity.linear.y, 2)) > 0.3) {
+    if (_disturbance_observer_enabled_) {
+      temp_gain = 0;
+    } else if (!control_reference->disable_antiwindups) {
+      if (rampup_active_ || sqrt(pow(state.velocity[0], 2) + pow(state.velocity[1], 2)) > 0.3) {
         temp_gain = 0;
         ROS_INFO_THROTTLE(1.0, "[%s]: anti-windup for world integral kicks in", this->name_.c_str());
       }
@@ -1190,6 +1862,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     if (kiwxy_lim_ >= 0 && world_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[%s]: MPC's world X integral is being saturated!", this->name_.c_str());
     }
 
@@ -1207,6 +1880,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     if (kiwxy_lim_ >= 0 && world_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[%s]: MPC's world Y integral is being saturated!", this->name_.c_str());
     }
   }
@@ -1224,8 +1898,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
     // antiwindup
     double temp_gain = km_;
-    if (rampup_active_ ||
-        (fabs(uav_state->velocity.linear.z) > 0.3 && ((Ep[2] < 0 && uav_state->velocity.linear.z > 0) || (Ep[2] > 0 && uav_state->velocity.linear.z < 0)))) {
+    if (_disturbance_observer_enabled_) {
+      temp_gain = 0;
+    } else if (rampup_active_ ||
+        (fabs(state.velocity[2]) > 0.3 && ((Ep[2] < 0 && state.velocity[2] > 0) || (Ep[2] > 0 && state.velocity[2] < 0)))) {
       temp_gain = 0;
       ROS_INFO_THROTTLE(1.0, "[%s]: anti-windup for the mass kicks in", this->name_.c_str());
     }
@@ -1248,6 +1924,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     }
 
     if (uav_mass_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[%s]: The UAV mass difference is being saturated to %.2f!", this->name_.c_str(), uav_mass_difference_);
     }
   }
@@ -1267,6 +1944,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
     auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
 
+    if (fabs(t[0]) > constraints.roll_rate || fabs(t[1]) > constraints.pitch_rate || fabs(t[2]) > constraints.yaw_rate) {
+      flight_record_.flags |= FLIGHT_RECORD_RATE_SATURATED;
+    }
+
     if (t[0] > constraints.roll_rate) {
       t[0] = constraints.roll_rate;
     } else if (t[0] < -constraints.roll_rate) {
@@ -1294,10 +1975,16 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
   double desired_y_accel = 0;
   double desired_z_accel = 0;
 
+  Eigen::Vector3d world_accel_cmd;
+
   {
     Eigen::Matrix3d des_orientation = mrs_lib::AttitudeConverter(Rd);
     Eigen::Vector3d thrust_vector   = thrust_force * des_orientation.col(2);
 
+    // the acceleration expected to really happen, used for the state prediction
+    world_accel_cmd = thrust_vector / total_mass - Eigen::Vector3d(Iw_w_[0] + Ib_w[0], Iw_w_[1] + Ib_w[1], 0) / total_mass -
+                      Eigen::Vector3d(0, 0, common_handlers_->g) + disturbance;
+
     double world_accel_x = (thrust_vector[0] / total_mass) - (Iw_w_[0] / total_mass) - (Ib_w[0] / total_mass);
     double world_accel_y = (thrust_vector[1] / total_mass) - (Iw_w_[1] / total_mass) - (Ib_w[1] / total_mass);
     double world_accel_z = control_reference->acceleration.z;
@@ -1307,20 +1994,33 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
     // anti-windup, which will stop mass estimation. Therefore, the touch-down will not be detected.
     /* double world_accel_z = (thrust_vector[2] / total_mass) - common_handlers_->g; */
 
-    geometry_msgs::Vector3Stamped world_accel;
-    world_accel.header.stamp    = ros::Time::now();
-    world_accel.header.frame_id = uav_state->header.frame_id;
-    world_accel.vector.x        = world_accel_x;
-    world_accel.vector.y        = world_accel_y;
-    world_accel.vector.z        = world_accel_z;
+    if (!lookup_transforms) {
 
-    auto res = common_handlers_->transformer->transformSingle(world_accel, "fcu");
+      Eigen::Vector3d body_accel = R.transpose() * Eigen::Vector3d(world_accel_x, world_accel_y, world_accel_z);
 
-    if (res) {
+      desired_x_accel = body_accel[0];
+      desired_y_accel = body_accel[1];
+      desired_z_accel = body_accel[2];
+
+    } else {
+
+      geometry_msgs::Vector3Stamped world_accel;
+      world_accel.header.stamp    = ros::Time::now();
+      world_accel.header.frame_id = uav_state->header.frame_id;
+      world_accel.vector.x        = world_accel_x;
+      world_accel.vector.y        = world_accel_y;
+      world_accel.vector.z        = world_accel_z;
 
-      desired_x_accel = res.value().vector.x;
-      desired_y_accel = res.value().vector.y;
-      desired_z_accel = res.value().vector.z;
+      CONTROLLER_TRACE1(transform_entry, name_.c_str());
+      auto res = common_handlers_->transformer->transformSingle(world_accel, "fcu");
+      CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
+
+      if (res) {
+
+        desired_x_accel = res.value().vector.x;
+        desired_y_accel = res.value().vector.y;
+        desired_z_accel = res.value().vector.z;
+      }
     }
   }
 
@@ -1378,8 +2078,11 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
 
   output_command->ramping_up = rampup_active_;
 
-  output_command->mass_difference = uav_mass_difference_;
-  output_command->total_mass      = total_mass;
+  // the estimated disturbances are handed over as the equivalent mass difference and world integrals
+  double mass_difference_estimate = -total_mass * disturbance[2] / common_handlers_->g;
+
+  output_command->mass_difference = uav_mass_difference_ + mass_difference_estimate;
+  output_command->total_mass      = total_mass + mass_difference_estimate;
 
   output_command->disturbance_bx_b = -Ib_b_[0];
   output_command->disturbance_by_b = -Ib_b_[1];
@@ -1387,23 +2090,51 @@ const mrs_msgs::AttitudeCommand::ConstPtr MpcController::update(const mrs_msgs::
   output_command->disturbance_bx_w = -Ib_w[0];
   output_command->disturbance_by_w = -Ib_w[1];
 
-  output_command->disturbance_wx_w = -Iw_w_[0];
-  output_command->disturbance_wy_w = -Iw_w_[1];
+  output_command->disturbance_wx_w = -Iw_w_[0] + total_mass * disturbance[0];
+  output_command->disturbance_wy_w = -Iw_w_[1] + total_mass * disturbance[1];
 
   // set the constraints
   output_command->controller_enforcing_constraints = true;
 
-  output_command->horizontal_speed_constraint = 0.5 * _max_speed_horizontal_;
-  output_command->horizontal_acc_constraint   = 0.5 * _max_acceleration_horizontal_;
+  output_command->horizontal_speed_constraint = CONSTRAINTS_MARGIN * limits.speed_horizontal;
+  output_command->horizontal_acc_constraint   = CONSTRAINTS_MARGIN * limits.acceleration_horizontal;
 
-  output_command->vertical_asc_speed_constraint = 0.5 * _max_speed_vertical_;
-  output_command->vertical_asc_acc_constraint   = 0.5 * _max_acceleration_vertical_;
+  output_command->vertical_asc_speed_constraint = CONSTRAINTS_MARGIN * limits.speed_vertical;
+  output_command->vertical_asc_acc_constraint   = CONSTRAINTS_MARGIN * limits.acceleration_vertical;
 
-  output_command->vertical_desc_speed_constraint = 0.5 * _max_speed_vertical_;
-  output_command->vertical_desc_acc_constraint   = 0.5 * _max_acceleration_vertical_;
+  output_command->vertical_desc_speed_constraint = CONSTRAINTS_MARGIN * limits.speed_vertical;
+  output_command->vertical_desc_acc_constraint   = CONSTRAINTS_MARGIN * limits.acceleration_vertical;
 
   output_command->controller = this->name_;
 
+  // | ------------ remember the command for the prediction ------------ |
+
+  state_predictor_->addCommand(output_command->header.stamp, world_accel_cmd, t);
+
+  // | -------------------- record the update ------------------- |
+
+  if (rampup_active_) {
+    flight_record_.flags |= FLIGHT_RECORD_RAMPUP;
+  }
+
+  if (flight_recorder_ && !shadow) {
+
+    flight_record_.theta        = theta;
+    flight_record_.thrust_force = thrust_force;
+
+    common::recordVector(flight_record_.attitude_error, Eq);
+    common::recordVector(flight_record_.attitude_rate_feedforward, Rw + q_feedforward);
+    common::recordOutput(flight_record_, *output_command);
+
+    flight_recorder_->write(flight_record_);
+  }
+
+  if (!shadow) {
+    health_->setEstimate(0, uav_mass_difference_);
+    health_->setEstimate(1, disturbance.norm());
+    health_->addUpdate(update_start, flight_record_.flags);
+  }
+
   last_attitude_cmd_ = output_command;
 
   return output_command;
@@ -1428,22 +2159,36 @@ const mrs_msgs::ControllerStatus MpcController::getStatus() {
 
 void MpcController::switchOdometrySource(const mrs_msgs::UavState::ConstPtr &new_uav_state) {
 
+  CONTROLLER_TRACE2(switch_odometry_source, name_.c_str(), new_uav_state->header.frame_id.c_str());
+
   ROS_INFO("[%s]: switching the odometry source", this->name_.c_str());
 
-  auto uav_state = mrs_lib::get_mutexed(mutex_uav_state_, uav_state_);
+  // the frame of the stored integrals, empty before the first update
+  auto        uav_state = boost::atomic_load(&uav_state_);
+  std::string frame_id  = uav_state ? uav_state->header.frame_id : "";
+
+  // the stored commands are expressed in the old frame
+  state_predictor_->reset();
+
+  // so is the state of the copy, it starts over from the next active output
+  if (shadow_mode_ && !is_active_) {
+    shadow_mode_->resume();
+  }
 
   // | ----- transform world disturabances to the new frame ----- |
 
   geometry_msgs::Vector3Stamped world_integrals;
 
   world_integrals.header.stamp    = ros::Time::now();
-  world_integrals.header.frame_id = uav_state.header.frame_id;
+  world_integrals.header.frame_id = frame_id;
 
   world_integrals.vector.x = Iw_w_[0];
   world_integrals.vector.y = Iw_w_[1];
   world_integrals.vector.z = 0;
 
+  CONTROLLER_TRACE1(transform_entry, name_.c_str());
   auto res = common_handlers_->transformer->transformSingle(world_integrals, new_uav_state->header.frame_id);
+  CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
 
   if (res) {
 
@@ -1460,6 +2205,39 @@ void MpcController::switchOdometrySource(const mrs_msgs::UavState::ConstPtr &new
     Iw_w_[0] = 0;
     Iw_w_[1] = 0;
   }
+
+  // | ------- transform the estimated disturbances as well ------ |
+
+  if (_disturbance_observer_enabled_) {
+
+    std::scoped_lock lock(mutex_integrals_);
+
+    geometry_msgs::Vector3Stamped world_disturbance;
+
+    world_disturbance.header.stamp    = ros::Time::now();
+    world_disturbance.header.frame_id = frame_id;
+
+    world_disturbance.vector.x = disturbance_observer_x_->getDisturbance();
+    world_disturbance.vector.y = disturbance_observer_y_->getDisturbance();
+    world_disturbance.vector.z = 0;
+
+    CONTROLLER_TRACE1(transform_entry, name_.c_str());
+    auto res = common_handlers_->transformer->transformSingle(world_disturbance, new_uav_state->header.frame_id);
+    CONTROLLER_TRACE2(transform_exit, name_.c_str(), bool(res));
+
+    if (res) {
+      disturbance_observer_x_->setDisturbance(res.value().vector.x);
+      disturbance_observer_y_->setDisturbance(res.value().vector.y);
+    } else {
+      ROS_ERROR_THROTTLE(1.0, "[%s]: could not transform the estimated disturbance to the new frame", this->name_.c_str());
+
+      disturbance_observer_x_->setDisturbance(0);
+      disturbance_observer_y_->setDisturbance(0);
+    }
+
+    // the velocity estimates are re-initialized from the new odometry
+    disturbance_observer_reset_ = true;
+  }
 }
 
 //}
@@ -1472,6 +2250,10 @@ void MpcController::resetDisturbanceEstimators(void) {
 
   Iw_w_ = Eigen::Vector2d::Zero(2);
   Ib_b_ = Eigen::Vector2d::Zero(2);
+
+  disturbance_observer_x_->setDisturbance(0);
+  disturbance_observer_y_->setDisturbance(0);
+  disturbance_observer_z_->setDisturbance(0);
 }
 
 //}
@@ -1481,6 +2263,8 @@ void MpcController::resetDisturbanceEstimators(void) {
 const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr MpcController::setConstraints([
     [maybe_unused]] const mrs_msgs::DynamicsConstraintsSrvRequest::ConstPtr &constraints) {
 
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SERVICE);
+
   if (!is_initialized_) {
     return mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr(new mrs_msgs::DynamicsConstraintsSrvResponse());
   }
@@ -1489,6 +2273,10 @@ const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr MpcController::setConst
 
   got_constraints_ = true;
 
+  if (shadow_controller_) {
+    shadow_controller_->setConstraints(constraints);
+  }
+
   ROS_INFO("[%s]: updating constraints", this->name_.c_str());
 
   mrs_msgs::DynamicsConstraintsSrvResponse res;
@@ -1508,10 +2296,41 @@ const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr MpcController::setConst
 
 void MpcController::callbackDrs(mrs_uav_controllers::mpc_controllerConfig &config, [[maybe_unused]] uint32_t level) {
 
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_DRS);
+
   {
     std::scoped_lock lock(mutex_drs_params_, mutex_output_mode_);
 
     drs_params_ = config;
+
+    // the gains from the user supersede a pending echo of the filtered ones, also the one filterGains()
+    // is building right now from the previous params, it is stamped with the previous sequence
+    {
+      std::scoped_lock lock_write_back(mutex_drs_write_back_);
+
+      drs_sequence_++;
+      drs_write_back_pending_ = false;
+    }
+
+    // the copy of the shadow mode has no drs of its own
+    if (shadow_controller_) {
+
+      std::scoped_lock lock_shadow(shadow_controller_->mutex_drs_params_, shadow_controller_->mutex_output_mode_);
+
+      shadow_controller_->drs_params_ = config;
+    }
+  }
+
+  MpcWeights_t weights;
+  weights.Q_horizontal = Eigen::Vector3d(config.mpc_Q_xy_pos, config.mpc_Q_xy_vel, config.mpc_Q_xy_acc);
+  weights.S_horizontal = Eigen::Vector3d(config.mpc_S_xy_pos, config.mpc_S_xy_vel, config.mpc_S_xy_acc);
+  weights.Q_vertical   = Eigen::Vector3d(config.mpc_Q_z_pos, config.mpc_Q_z_vel, config.mpc_Q_z_acc);
+  weights.S_vertical   = Eigen::Vector3d(config.mpc_S_z_pos, config.mpc_S_z_vel, config.mpc_S_z_acc);
+
+  requestMpcSetup(weights);
+
+  if (shadow_controller_) {
+    shadow_controller_->requestMpcSetup(weights);
   }
 
   ROS_INFO("[%s]: DRS updated gains", this->name_.c_str());
@@ -1519,6 +2338,40 @@ void MpcController::callbackDrs(mrs_uav_controllers::mpc_controllerConfig &confi
 
 //}
 
+/* timerDrsWriteBack() //{ */
+
+void MpcController::timerDrsWriteBack([[maybe_unused]] const ros::TimerEvent &event) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+  // the drs server holds its mutex while in callbackDrs(), so no new params can come between the check and the publish
+  boost::recursive_mutex::scoped_lock lock_drs(mutex_drs_);
+
+  DrsConfig_t params;
+
+  {
+    std::scoped_lock lock(mutex_drs_write_back_);
+
+    if (!drs_write_back_pending_) {
+      return;
+    }
+
+    drs_write_back_pending_ = false;
+
+    // built from the params which callbackDrs() has replaced since
+    if (drs_write_back_sequence_ != drs_sequence_) {
+      return;
+    }
+
+    params = drs_write_back_;
+  }
+
+  // publishes, the drs mutex is recursive
+  drs_->updateConfig(params);
+}
+
+//}
+
 /* //{ callbackSetIntegralTerms() */
 
 bool MpcController::callbackSetIntegralTerms(std_srvs::SetBool::Request &req, std_srvs::SetBool::Response &res) {
@@ -1526,8 +2379,14 @@ bool MpcController::callbackSetIntegralTerms(std_srvs::SetBool::Request &req, st
   if (!is_initialized_)
     return false;
 
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SERVICE);
+
   integral_terms_enabled_ = req.data;
 
+  if (shadow_controller_) {
+    shadow_controller_->integral_terms_enabled_ = req.data;
+  }
+
   std::stringstream ss;
 
   ss << "integral terms %s" << (integral_terms_enabled_ ? "enabled" : "disabled");
@@ -1588,13 +2447,323 @@ void MpcController::filterGains(const bool mute_gains, const double dt) {
       new_drs_params_.kiwxy_lim = kiwxy_lim_;
       new_drs_params_.kibxy_lim = kibxy_lim_;
 
-      drs_->updateConfig(new_drs_params_);
+      std::scoped_lock lock_write_back(mutex_drs_write_back_);
+
+      drs_write_back_          = new_drs_params_;
+      drs_write_back_pending_  = true;
+      drs_write_back_sequence_ = drs_sequence_;
     }
   }
 }
 
 //}
 
+/* createMpcSetup() //{ */
+
+std::shared_ptr<MpcController::MpcSetup_t> MpcController::createMpcSetup(const MpcWeights_t &weights, const std::shared_ptr<MpcSetup_t> &previous) {
+
+  std::shared_ptr<MpcSetup_t> setup = std::make_shared<MpcSetup_t>();
+
+  setup->weights = weights;
+
+  mpc_solver::MpcSolverParams_t params_horizontal = mpc_solver_params_;
+  params_horizontal.Q                             = weights.Q_horizontal;
+  params_horizontal.S                             = weights.S_horizontal;
+
+  mpc_solver::MpcSolverParams_t params_vertical = mpc_solver_params_;
+  params_vertical.Q                             = weights.Q_vertical;
+  params_vertical.S                             = weights.S_vertical;
+
+  // the legacy library is constructed under the mutex of its solve(), a new instance would stall the control loop of every alias
+  const bool keep_solvers = previous && previous->solver_x->takesWeightsFromProblem();
+
+  if (keep_solvers) {
+
+    setup->solver_x = previous->solver_x;
+    setup->solver_y = previous->solver_y;
+    setup->solver_z = previous->solver_z;
+
+  } else {
+
+    setup->solver_x = mpc_solver::createMpcSolverBackend(mpc_solver_backend_type_, *mpc_model_horizontal_, params_horizontal);
+    setup->solver_y = mpc_solver::createMpcSolverBackend(mpc_solver_backend_type_, *mpc_model_horizontal_, params_horizontal);
+    setup->solver_z = mpc_solver::createMpcSolverBackend(mpc_solver_backend_type_, *mpc_model_vertical_, params_vertical);
+
+    if (!setup->solver_x || !setup->solver_y || !setup->solver_z) {
+      return nullptr;
+    }
+  }
+
+  setup->fast_path_horizontal = std::make_unique<mpc_solver::LqrFastPath>(*mpc_model_horizontal_);
+  setup->fast_path_vertical   = std::make_unique<mpc_solver::LqrFastPath>(*mpc_model_vertical_);
+
+  // precompute everything for all the combinations of the position and velocity masks, see update(),
+  // the kept solvers are being used by the control loop meanwhile and have nothing to precompute
+  for (int mask = 0; mask < 4 && !keep_solvers; mask++) {
+
+    Eigen::Vector3d Q_horizontal = weights.Q_horizontal;
+    Eigen::Vector3d S_horizontal = weights.S_horizontal;
+    Eigen::Vector3d Q_vertical   = weights.Q_vertical;
+    Eigen::Vector3d S_vertical   = weights.S_vertical;
+
+    for (int i = 0; i < 2; i++) {
+      if (mask & (1 << i)) {
+        Q_horizontal[i] = 0;
+        S_horizontal[i] = 0;
+        Q_vertical[i]   = 0;
+        S_vertical[i]   = 0;
+      }
+    }
+
+    setup->solver_x->prepare(Q_horizontal, S_horizontal);
+    setup->solver_y->prepare(Q_horizontal, S_horizontal);
+    setup->solver_z->prepare(Q_vertical, S_vertical);
+  }
+
+  if (_mpc_fast_path_enabled_) {
+    prepareFastPath(*setup->fast_path_horizontal, weights.Q_horizontal, weights.S_horizontal);
+    prepareFastPath(*setup->fast_path_vertical, weights.Q_vertical, weights.S_vertical);
+  }
+
+  return setup;
+}
+
+//}
+
+/* requestMpcSetup() //{ */
+
+void MpcController::requestMpcSetup(const MpcWeights_t &weights) {
+
+  {
+    std::scoped_lock lock(mutex_mpc_setup_request_);
+
+    if (weights.Q_horizontal == mpc_setup_request_.Q_horizontal && weights.S_horizontal == mpc_setup_request_.S_horizontal &&
+        weights.Q_vertical == mpc_setup_request_.Q_vertical && weights.S_vertical == mpc_setup_request_.S_vertical) {
+      return;
+    }
+
+    // the newer request overrides an older one, which has not been processed yet
+    mpc_setup_request_   = weights;
+    mpc_setup_requested_ = true;
+  }
+
+  mpc_setup_request_cv_.notify_one();
+}
+
+//}
+
+/* mpcSetupThread() //{ */
+
+void MpcController::mpcSetupThread(void) {
+
+  while (true) {
+
+    MpcWeights_t weights;
+
+    {
+      std::unique_lock lock(mutex_mpc_setup_request_);
+
+      mpc_setup_request_cv_.wait(lock, [this] { return mpc_setup_requested_ || mpc_setup_thread_stop_; });
+
+      if (mpc_setup_thread_stop_) {
+        return;
+      }
+
+      weights              = mpc_setup_request_;
+      mpc_setup_requested_ = false;
+    }
+
+    common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+    ros::WallTime start = ros::WallTime::now();
+
+    std::shared_ptr<MpcSetup_t> setup = createMpcSetup(weights, mpc_setup_last_);
+
+    if (!setup) {
+      ROS_ERROR("[%s]: could not re-set up the MPC solver with the new weights", this->name_.c_str());
+      continue;
+    }
+
+    mpc_setup_last_ = setup;
+
+    // the control loop picks it up at the beginning of the next update()
+    std::atomic_store(&mpc_setup_pending_, setup);
+
+    ROS_INFO("[%s]: the MPC solver has been re-set up with the new weights in %.1f ms, the next update() switches to them", this->name_.c_str(),
+             (ros::WallTime::now() - start).toSec() * 1000.0);
+  }
+}
+
+//}
+
+/* updateShadow() //{ */
+
+const mrs_msgs::AttitudeCommand::ConstPtr MpcController::updateShadow(const common::ShadowFrame_t &frame) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+  // the copy starts as if the control manager switched to it, from the output of the active controller
+  if (frame.restart && !shadow_controller_->activate(frame.active_output)) {
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  return shadow_controller_->update(frame.uav_state, frame.control_reference);
+}
+
+//}
+
+/* getMpcLimits() //{ */
+
+MpcController::MpcLimits_t MpcController::getMpcLimits(const bool clamp_by_constraints) {
+
+  MpcLimits_t limits;
+
+  {
+    std::scoped_lock lock(mutex_drs_params_);
+
+    limits.speed_horizontal        = drs_params_.max_speed_horizontal;
+    limits.acceleration_horizontal = drs_params_.max_acceleration_horizontal;
+    limits.jerk_horizontal         = drs_params_.max_jerk_horizontal;
+    limits.speed_vertical          = drs_params_.max_speed_vertical;
+    limits.acceleration_vertical   = drs_params_.max_acceleration_vertical;
+    limits.u_vertical              = drs_params_.max_u_vertical;
+  }
+
+  if (!clamp_by_constraints || !got_constraints_) {
+    return limits;
+  }
+
+  auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
+
+  // the tracker is given only a fraction of the limits (see update()), keep the same headroom above the constraints
+  limits.speed_horizontal        = std::min(limits.speed_horizontal, constraints.horizontal_speed / CONSTRAINTS_MARGIN);
+  limits.acceleration_horizontal = std::min(limits.acceleration_horizontal, constraints.horizontal_acceleration / CONSTRAINTS_MARGIN);
+  limits.jerk_horizontal         = std::min(limits.jerk_horizontal, constraints.horizontal_jerk / CONSTRAINTS_MARGIN);
+
+  limits.speed_vertical =
+      std::min(limits.speed_vertical, std::min(constraints.vertical_ascending_speed, constraints.vertical_descending_speed) / CONSTRAINTS_MARGIN);
+  limits.acceleration_vertical = std::min(limits.acceleration_vertical,
+                                          std::min(constraints.vertical_ascending_acceleration, constraints.vertical_descending_acceleration) / CONSTRAINTS_MARGIN);
+
+  return limits;
+}
+
+//}
+
+/* prepareFastPath() //{ */
+
+void MpcController::prepareFastPath(mpc_solver::LqrFastPath &fast_path, const Eigen::Vector3d &Q, const Eigen::Vector3d &S) {
+
+  // precompute the gains for all the combinations of the position and velocity masks, see update()
+  for (int mask = 0; mask < 4; mask++) {
+
+    Eigen::Vector3d temp_Q = Q;
+    Eigen::Vector3d temp_S = S;
+
+    if (mask & 0x01) {
+      temp_Q[0] = 0;
+      temp_S[0] = 0;
+    }
+
+    if (mask & 0x02) {
+      temp_Q[1] = 0;
+      temp_S[1] = 0;
+    }
+
+    fast_path.prepare(temp_Q, temp_S);
+  }
+}
+
+//}
+
+/* solveMpc() //{ */
+
+bool MpcController::solveMpc(mpc_solver::MpcSolverBackend &solver, mpc_solver::LqrFastPath &fast_path, const mpc_solver::MpcProblem_t &problem,
+                             mpc_solver::MpcSolution_t &solution) {
+
+  CONTROLLER_TRACE1(mpc_solve_entry, name_.c_str());
+
+  if (_mpc_fast_path_enabled_ && fast_path.solve(problem, solution)) {
+
+    solution.fast_path = true;
+
+    CONTROLLER_TRACE4(mpc_solve_exit, name_.c_str(), solution.iterations, true, true);
+
+    return true;
+  }
+
+  bool success = solver.solve(problem, solution);
+
+  CONTROLLER_TRACE4(mpc_solve_exit, name_.c_str(), solution.iterations, success, false);
+
+  return success;
+}
+
+//}
+
+/* selectMpcSolverBackend() //{ */
+
+std::string MpcController::selectMpcSolverBackend(const mpc_solver::MpcModel &model, const mpc_solver::MpcSolverParams_t &params) {
+
+  if (_mpc_solver_backend_ != "auto") {
+
+    std::vector<std::string> available = mpc_solver::getAvailableMpcSolverBackends();
+
+    if (std::find(available.begin(), available.end(), _mpc_solver_backend_) == available.end()) {
+
+      ROS_WARN("[%s]: the MPC solver backend '%s' is not available in this build (architecture), falling back to 'admm'", this->name_.c_str(),
+               _mpc_solver_backend_.c_str());
+
+      return "admm";
+    }
+
+    if (!mpc_solver::isMpcSolverBackendCompatible(_mpc_solver_backend_, model) && mpc_solver::isMpcSolverBackendCompatible("admm", model)) {
+
+      ROS_WARN("[%s]: the MPC solver backend '%s' does not support the time schedule of the model, falling back to 'admm'", this->name_.c_str(),
+               _mpc_solver_backend_.c_str());
+
+      return "admm";
+    }
+
+    return _mpc_solver_backend_;
+  }
+
+  // a representative problem: a step in the position reference while limits are active
+  mpc_solver::MpcProblem_t problem = mpc_solver::createMpcProblem(model);
+
+  problem.initial_state << 1.0, 0.0, 0.0;
+  problem.Q                = params.Q;
+  problem.S                = params.S;
+  problem.max_speed        = _max_speed_horizontal_;
+  problem.max_acceleration = 999;
+  problem.max_u            = _max_acceleration_horizontal_;
+  problem.max_du           = _max_jerk_;
+
+  std::vector<double> timings;
+
+  std::string fastest = mpc_solver::benchmarkMpcSolverBackends(model, params, problem, _mpc_solver_benchmark_n_solves_, timings);
+
+  std::vector<std::string> backends = mpc_solver::getAvailableMpcSolverBackends();
+
+  for (size_t i = 0; i < backends.size() && i < timings.size(); i++) {
+
+    if (!std::isfinite(timings[i])) {
+      ROS_INFO("[%s]: MPC solver backend '%s': not compatible with the model", this->name_.c_str(), backends[i].c_str());
+      continue;
+    }
+
+    ROS_INFO("[%s]: MPC solver backend '%s': %.1f us per solve", this->name_.c_str(), backends[i].c_str(), 1e6 * timings[i]);
+  }
+
+  if (fastest.empty()) {
+    ROS_ERROR("[%s]: none of the MPC solver backends succeeded during the benchmark", this->name_.c_str());
+  }
+
+  return fastest;
+}
+
+//}
+
 /* calculateGainChange() //{ */
 
 double MpcController::calculateGainChange(const double dt, const double current_value, const double desired_value, const bool bypass_rate, std::string name,
@@ -0,0 +1,200 @@
+#include <mrs_uav_controllers/mpc_solver/admm_kernels.h>
+#include <mrs_uav_controllers/common/cpu_dispatch.h>
+
+#include <cstddef>
+
+using namespace mrs_uav_controllers::common;
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+// | ------------------------- the bodies ------------------------- |
+
+/* matVecBody() //{ */
+
+// four columns per pass over y, so y is loaded and stored once per four columns
+CPU_DISPATCH_INLINE void matVecBody(const double* __restrict A, const int rows, const int cols, const double* __restrict x, double* __restrict y) {
+
+  for (int i = 0; i < rows; i++) {
+    y[i] = 0;
+  }
+
+  int j = 0;
+
+  for (; j + 4 <= cols; j += 4) {
+
+    const double* a0 = A + size_t(j) * rows;
+    const double* a1 = a0 + rows;
+    const double* a2 = a1 + rows;
+    const double* a3 = a2 + rows;
+
+    const double x0 = x[j];
+    const double x1 = x[j + 1];
+    const double x2 = x[j + 2];
+    const double x3 = x[j + 3];
+
+    for (int i = 0; i < rows; i++) {
+      y[i] += a0[i] * x0 + a1[i] * x1 + a2[i] * x2 + a3[i] * x3;
+    }
+  }
+
+  for (; j < cols; j++) {
+
+    const double* a  = A + size_t(j) * rows;
+    const double  xj = x[j];
+
+    for (int i = 0; i < rows; i++) {
+      y[i] += a[i] * xj;
+    }
+  }
+}
+
+//}
+
+/* updateBody() //{ */
+
+CPU_DISPATCH_INLINE void updateBody(const int m, const double alpha, const double rho, const double* __restrict z_tilde, const double* __restrict l,
+                                    const double* __restrict u, double* __restrict z, double* __restrict y, double* __restrict rhs) {
+
+  for (int i = 0; i < m; i++) {
+
+    const double z_relaxed = alpha * z_tilde[i] + (1.0 - alpha) * z[i];
+
+    double z_new = z_relaxed + y[i] / rho;
+
+    z_new = z_new < l[i] ? l[i] : z_new;
+    z_new = z_new > u[i] ? u[i] : z_new;
+
+    const double y_new = y[i] + rho * (z_relaxed - z_new);
+
+    z[i]   = z_new;
+    y[i]   = y_new;
+    rhs[i] = rho * z_new - y_new;
+  }
+}
+
+//}
+
+#ifdef MRS_UAV_CONTROLLERS_CPU_DISPATCH
+
+// | ------------------------ the variants ------------------------ |
+
+/* admmMatVec variants //{ */
+
+typedef void (*AdmmMatVec_t)(const double*, const int, const int, const double*, double*);
+
+CPU_DISPATCH_TARGET_AVX512 static void admmMatVecAvx512(const double* A, const int rows, const int cols, const double* x, double* y) {
+  matVecBody(A, rows, cols, x, y);
+}
+
+CPU_DISPATCH_TARGET_AVX2 static void admmMatVecAvx2(const double* A, const int rows, const int cols, const double* x, double* y) {
+  matVecBody(A, rows, cols, x, y);
+}
+
+CPU_DISPATCH_TARGET_SSE42 static void admmMatVecSse42(const double* A, const int rows, const int cols, const double* x, double* y) {
+  matVecBody(A, rows, cols, x, y);
+}
+
+static void admmMatVecDefault(const double* A, const int rows, const int cols, const double* x, double* y) {
+  matVecBody(A, rows, cols, x, y);
+}
+
+extern "C" AdmmMatVec_t resolveAdmmMatVec(void) {
+
+  switch (detectCpuIsa()) {
+    case CPU_ISA_AVX512:
+      return admmMatVecAvx512;
+    case CPU_ISA_AVX2:
+      return admmMatVecAvx2;
+    case CPU_ISA_SSE42:
+      return admmMatVecSse42;
+    default:
+      return admmMatVecDefault;
+  }
+}
+
+//}
+
+/* admmUpdate variants //{ */
+
+typedef void (*AdmmUpdate_t)(const int, const double, const double, const double*, const double*, const double*, double*, double*, double*);
+
+CPU_DISPATCH_TARGET_AVX512 static void admmUpdateAvx512(const int m, const double alpha, const double rho, const double* z_tilde, const double* l,
+                                                        const double* u, double* z, double* y, double* rhs) {
+  updateBody(m, alpha, rho, z_tilde, l, u, z, y, rhs);
+}
+
+CPU_DISPATCH_TARGET_AVX2 static void admmUpdateAvx2(const int m, const double alpha, const double rho, const double* z_tilde, const double* l, const double* u,
+                                                    double* z, double* y, double* rhs) {
+  updateBody(m, alpha, rho, z_tilde, l, u, z, y, rhs);
+}
+
+CPU_DISPATCH_TARGET_SSE42 static void admmUpdateSse42(const int m, const double alpha, const double rho, const double* z_tilde, const double* l,
+                                                      const double* u, double* z, double* y, double* rhs) {
+  updateBody(m, alpha, rho, z_tilde, l, u, z, y, rhs);
+}
+
+static void admmUpdateDefault(const int m, const double alpha, const double rho, const double* z_tilde, const double* l, const double* u, double* z, double* y,
+                              double* rhs) {
+  updateBody(m, alpha, rho, z_tilde, l, u, z, y, rhs);
+}
+
+extern "C" AdmmUpdate_t resolveAdmmUpdate(void) {
+
+  switch (detectCpuIsa()) {
+    case CPU_ISA_AVX512:
+      return admmUpdateAvx512;
+    case CPU_ISA_AVX2:
+      return admmUpdateAvx2;
+    case CPU_ISA_SSE42:
+      return admmUpdateSse42;
+    default:
+      return admmUpdateDefault;
+  }
+}
+
+//}
+
+// | ------------------ resolved at the load time ----------------- |
+
+void admmMatVec(const double* A, const int rows, const int cols, const double* x, double* y) __attribute__((ifunc("resolveAdmmMatVec")));
+
+void admmUpdate(const int m, const double alpha, const double rho, const double* z_tilde, const double* l, const double* u, double* z, double* y,
+                double* rhs) __attribute__((ifunc("resolveAdmmUpdate")));
+
+#else
+
+/* admmMatVec() //{ */
+
+void admmMatVec(const double* A, const int rows, const int cols, const double* x, double* y) {
+  matVecBody(A, rows, cols, x, y);
+}
+
+//}
+
+/* admmUpdate() //{ */
+
+void admmUpdate(const int m, const double alpha, const double rho, const double* z_tilde, const double* l, const double* u, double* z, double* y,
+                double* rhs) {
+  updateBody(m, alpha, rho, z_tilde, l, u, z, y, rhs);
+}
+
+//}
+
+#endif
+
+/* getAdmmKernelIsa() //{ */
+
+const char* getAdmmKernelIsa(void) {
+
+  return getCpuIsaName(detectCpuIsa());
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
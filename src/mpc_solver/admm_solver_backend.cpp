@@ -0,0 +1,268 @@
+#include <mrs_uav_controllers/mpc_solver/admm_solver_backend.h>
+#include <mrs_uav_controllers/mpc_solver/admm_kernels.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+// ADMM parameters, the defaults of OSQP
+const double ADMM_SIGMA        = 1e-6;
+const double ADMM_ALPHA        = 1.6;
+const double ADMM_EPS_ABS      = 1e-4;
+const double ADMM_EPS_REL      = 1e-3;
+const int    ADMM_CHECK_PERIOD = 5;
+
+// regularization of the inputs, makes P positive definite even when all the weights are muted
+const double INPUT_REGULARIZATION = 1e-6;
+
+// how many weight combinations are kept factorized
+const int MAX_FACTORIZATIONS = 4;
+
+/* AdmmSolverBackend() //{ */
+
+AdmmSolverBackend::AdmmSolverBackend(const MpcModel& model, const MpcSolverParams_t& params) : model_(model), params_(params) {
+
+  n_ = model_.horizonLength();
+  m_ = 4 * n_;
+
+  // | ------------------ the constraint matrix ----------------- |
+
+  A_ = Eigen::MatrixXd::Zero(m_, n_);
+
+  for (int k = 0; k < n_; k++) {
+
+    // predicted velocity and acceleration
+    A_.row(k)      = model_.Gamma().row(3 * k + 1);
+    A_.row(n_ + k) = model_.Gamma().row(3 * k + 2);
+
+    // input
+    A_(2 * n_ + k, k) = 1.0;
+
+    // input rate
+    A_(3 * n_ + k, k) = 1.0 / model_.dt(k);
+
+    if (k > 0) {
+      A_(3 * n_ + k, k - 1) = -1.0 / model_.dt(k);
+    }
+  }
+
+  At_  = A_.transpose();
+  AtA_ = A_.transpose() * A_;
+
+  // | ------------------------ workspace ----------------------- |
+
+  weights_       = Eigen::VectorXd::Zero(3 * n_);
+  error_         = Eigen::VectorXd::Zero(3 * n_);
+  free_response_ = Eigen::VectorXd::Zero(3 * n_);
+  q_             = Eigen::VectorXd::Zero(n_);
+  x_             = Eigen::VectorXd::Zero(n_);
+  x_tilde_       = Eigen::VectorXd::Zero(n_);
+  rhs_           = Eigen::VectorXd::Zero(n_);
+  tmp_n_         = Eigen::VectorXd::Zero(n_);
+  l_             = Eigen::VectorXd::Zero(m_);
+  u_             = Eigen::VectorXd::Zero(m_);
+  z_             = Eigen::VectorXd::Zero(m_);
+  z_tilde_       = Eigen::VectorXd::Zero(m_);
+  y_             = Eigen::VectorXd::Zero(m_);
+  tmp_m_         = Eigen::VectorXd::Zero(m_);
+  rhs_m_         = Eigen::VectorXd::Zero(m_);
+
+  factorizations_.reserve(MAX_FACTORIZATIONS);
+
+  getFactorization(params_.Q, params_.S);
+}
+
+//}
+
+/* getName() //{ */
+
+std::string AdmmSolverBackend::getName(void) const {
+  return "admm";
+}
+
+//}
+
+/* solve() //{ */
+
+bool AdmmSolverBackend::solve(const MpcProblem_t& problem, MpcSolution_t& solution) {
+
+  const Factorization_t& factorization = getFactorization(problem.Q, problem.S);
+
+  const double rho = factorization.rho;
+
+  // | ------------------ the linear cost term ------------------ |
+
+  for (int k = 0; k < n_; k++) {
+    weights_.segment<3>(3 * k) = k < (n_ - 1) ? problem.Q : problem.S;
+  }
+
+  free_response_.noalias() = model_.Phi() * problem.initial_state;
+  free_response_ += problem.disturbance * model_.Delta();
+
+  error_ = weights_.cwiseProduct(free_response_ - problem.reference);
+
+  q_.noalias() = 2.0 * model_.Gamma().transpose() * error_;
+
+  // | ------------------------- bounds ------------------------- |
+
+  for (int k = 0; k < n_; k++) {
+
+    l_(k) = -problem.max_speed - free_response_(3 * k + 1);
+    u_(k) = problem.max_speed - free_response_(3 * k + 1);
+
+    l_(n_ + k) = -problem.max_acceleration - free_response_(3 * k + 2);
+    u_(n_ + k) = problem.max_acceleration - free_response_(3 * k + 2);
+
+    l_(2 * n_ + k) = -problem.max_u;
+    u_(2 * n_ + k) = problem.max_u;
+
+    l_(3 * n_ + k) = -problem.max_du;
+    u_(3 * n_ + k) = problem.max_du;
+  }
+
+  // the first input rate is relative to the last applied input
+  l_(3 * n_) += problem.last_input / model_.dt(0);
+  u_(3 * n_) += problem.last_input / model_.dt(0);
+
+  // | ----------------------- warm start ----------------------- |
+
+  if (warm_start_valid_) {
+
+    // shift the last solution by one step
+    for (int k = 0; k < n_ - 1; k++) {
+      x_(k) = x_(k + 1);
+    }
+
+  } else {
+
+    x_.setConstant(problem.last_input);
+    y_.setZero();
+  }
+
+  z_.noalias() = A_ * x_;
+  z_           = z_.cwiseMax(l_).cwiseMin(u_);
+
+  // | ------------------------ iterate ------------------------- |
+
+  int iteration = 0;
+
+  rhs_m_ = rho * z_ - y_;
+
+  // the products with A and A' and the update of z and y run in the kernels dispatched on the instruction set
+  for (iteration = 1; iteration <= params_.max_iterations; iteration++) {
+
+    admmMatVec(At_.data(), n_, m_, rhs_m_.data(), rhs_.data());
+    rhs_ += ADMM_SIGMA * x_ - q_;
+
+    x_tilde_ = factorization.kkt.solve(rhs_);
+
+    admmMatVec(A_.data(), m_, n_, x_tilde_.data(), z_tilde_.data());
+
+    x_ = ADMM_ALPHA * x_tilde_ + (1.0 - ADMM_ALPHA) * x_;
+
+    admmUpdate(m_, ADMM_ALPHA, rho, z_tilde_.data(), l_.data(), u_.data(), z_.data(), y_.data(), rhs_m_.data());
+
+    // | ------------------ check the convergence ----------------- |
+
+    if (iteration % ADMM_CHECK_PERIOD == 0) {
+
+      admmMatVec(A_.data(), m_, n_, x_.data(), tmp_m_.data());
+
+      double primal_residual = (tmp_m_ - z_).lpNorm<Eigen::Infinity>();
+      double primal_scale    = std::max(tmp_m_.lpNorm<Eigen::Infinity>(), z_.lpNorm<Eigen::Infinity>());
+
+      tmp_n_.noalias() = factorization.P * x_;
+      admmMatVec(At_.data(), n_, m_, y_.data(), rhs_.data());
+
+      double dual_residual = (tmp_n_ + q_ + rhs_).lpNorm<Eigen::Infinity>();
+      double dual_scale    = std::max({tmp_n_.lpNorm<Eigen::Infinity>(), q_.lpNorm<Eigen::Infinity>(), rhs_.lpNorm<Eigen::Infinity>()});
+
+      if (primal_residual <= ADMM_EPS_ABS + ADMM_EPS_REL * primal_scale && dual_residual <= ADMM_EPS_ABS + ADMM_EPS_REL * dual_scale) {
+        break;
+      }
+    }
+  }
+
+  solution.iterations  = std::min(iteration, params_.max_iterations);
+  solution.first_input = x_(0);
+
+  warm_start_valid_ = x_.allFinite() && y_.allFinite();
+
+  if (!warm_start_valid_) {
+    x_.setZero();
+    y_.setZero();
+  }
+
+  return std::isfinite(solution.first_input);
+}
+
+//}
+
+/* prepare() //{ */
+
+void AdmmSolverBackend::prepare(const Eigen::Vector3d& Q, const Eigen::Vector3d& S) {
+  getFactorization(Q, S);
+}
+
+//}
+
+/* getFactorization() //{ */
+
+const AdmmSolverBackend::Factorization_t& AdmmSolverBackend::getFactorization(const Eigen::Vector3d& Q, const Eigen::Vector3d& S) {
+
+  for (size_t i = 0; i < factorizations_.size(); i++) {
+    if (factorizations_[i].Q == Q && factorizations_[i].S == S) {
+      return factorizations_[i];
+    }
+  }
+
+  // | ------------ the weights have not been seen yet ----------- |
+
+  Factorization_t factorization;
+
+  factorization.Q = Q;
+  factorization.S = S;
+
+  Eigen::VectorXd sqrt_weights(3 * n_);
+
+  for (int k = 0; k < n_; k++) {
+    sqrt_weights.segment<3>(3 * k) = (k < (n_ - 1) ? Q : S).cwiseSqrt();
+  }
+
+  Eigen::MatrixXd weighted_gamma = sqrt_weights.asDiagonal() * model_.Gamma();
+
+  factorization.P = 2.0 * (weighted_gamma.transpose() * weighted_gamma + INPUT_REGULARIZATION * Eigen::MatrixXd::Identity(n_, n_));
+
+  // scale the penalty parameter to the magnitude of the cost
+  factorization.rho = 0.1 * std::max(factorization.P.trace() / AtA_.trace(), 1e-6);
+
+  factorization.kkt.compute(factorization.P + ADMM_SIGMA * Eigen::MatrixXd::Identity(n_, n_) + factorization.rho * AtA_);
+
+  if (int(factorizations_.size()) < MAX_FACTORIZATIONS) {
+
+    factorizations_.push_back(factorization);
+
+    return factorizations_.back();
+
+  } else {
+
+    int idx = next_factorization_;
+
+    next_factorization_ = (next_factorization_ + 1) % MAX_FACTORIZATIONS;
+
+    factorizations_[idx] = factorization;
+
+    return factorizations_[idx];
+  }
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
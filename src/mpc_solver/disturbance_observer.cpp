@@ -0,0 +1,88 @@
+#include <mrs_uav_controllers/mpc_solver/disturbance_observer.h>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* DisturbanceObserver() //{ */
+
+DisturbanceObserver::DisturbanceObserver(const double bandwidth, const double damping, const double max_disturbance) : max_disturbance_(max_disturbance) {
+
+  l_v_ = 2.0 * damping * bandwidth;
+  l_d_ = bandwidth * bandwidth;
+}
+
+//}
+
+/* reset() //{ */
+
+void DisturbanceObserver::reset(const double velocity, const double disturbance) {
+
+  velocity_ = velocity;
+
+  setDisturbance(disturbance);
+}
+
+//}
+
+/* update() //{ */
+
+void DisturbanceObserver::update(const double velocity, const double acceleration_cmd, const double dt) {
+
+  if (!std::isfinite(velocity) || !std::isfinite(acceleration_cmd) || !(dt > 0)) {
+    return;
+  }
+
+  double error = velocity - velocity_;
+
+  velocity_ += (acceleration_cmd + disturbance_ + l_v_ * error) * dt;
+
+  setDisturbance(disturbance_ + l_d_ * error * dt);
+}
+
+//}
+
+/* getDisturbance() //{ */
+
+double DisturbanceObserver::getDisturbance(void) const {
+  return disturbance_;
+}
+
+//}
+
+/* setDisturbance() //{ */
+
+void DisturbanceObserver::setDisturbance(const double disturbance) {
+
+  saturated_ = false;
+
+  if (!std::isfinite(disturbance)) {
+    disturbance_ = 0;
+  } else if (disturbance > max_disturbance_) {
+    disturbance_ = max_disturbance_;
+    saturated_   = true;
+  } else if (disturbance < -max_disturbance_) {
+    disturbance_ = -max_disturbance_;
+    saturated_   = true;
+  } else {
+    disturbance_ = disturbance;
+  }
+}
+
+//}
+
+/* isSaturated() //{ */
+
+bool DisturbanceObserver::isSaturated(void) const {
+  return saturated_;
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,94 @@
+#include <mrs_uav_controllers/mpc_solver/legacy_solver_backend.h>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+// the horizon the library has been generated for
+const int LEGACY_HORIZON_LENGTH = 26;
+
+std::mutex LegacySolverBackend::mutex_library_;
+
+/* LegacySolverBackend() //{ */
+
+LegacySolverBackend::LegacySolverBackend(const MpcModel& model, const MpcSolverParams_t& params) : dt1_(model.dt1()), dt2_(model.dt2()) {
+
+  Q_ = std::vector<double>(params.Q.data(), params.Q.data() + 3);
+  S_ = std::vector<double>(params.S.data(), params.S.data() + 3);
+
+  reference_     = Eigen::MatrixXd::Zero(3 * model.horizonLength(), 1);
+  delta_         = model.Delta();
+  initial_state_ = Eigen::MatrixXd::Zero(3, 1);
+
+  std::scoped_lock lock(mutex_library_);
+
+  solver_ = std::make_unique<mrs_mpc_solvers::mpc_controller::Solver>(params.name, params.verbose, params.max_iterations, Q_, S_, model.dt1(), model.dt2(),
+                                                                      model.p1(), model.p2());
+}
+
+//}
+
+/* getName() //{ */
+
+std::string LegacySolverBackend::getName(void) const {
+  return "legacy";
+}
+
+//}
+
+/* supportsModel() //{ */
+
+bool LegacySolverBackend::supportsModel(const MpcModel& model) {
+  return model.horizonLength() == LEGACY_HORIZON_LENGTH && model.isTwoStep();
+}
+
+//}
+
+/* takesWeightsFromProblem() //{ */
+
+bool LegacySolverBackend::takesWeightsFromProblem(void) const {
+  return true;
+}
+
+//}
+
+/* solve() //{ */
+
+bool LegacySolverBackend::solve(const MpcProblem_t& problem, MpcSolution_t& solution) {
+
+  for (int i = 0; i < 3; i++) {
+    Q_[i] = problem.Q[i];
+    S_[i] = problem.S[i];
+  }
+
+  // the library has no disturbance input, the predicted effect of the disturbance is subtracted from the reference instead,
+  // which gives the same cost, only the constraints are evaluated without the disturbance
+  reference_     = problem.reference - problem.disturbance * delta_;
+  initial_state_ = problem.initial_state;
+
+  std::scoped_lock lock(mutex_library_);
+
+  solver_->lock();
+  solver_->setQ(Q_);
+  solver_->setS(S_);
+  solver_->setParams();
+  solver_->setLastInput(problem.last_input);
+  solver_->loadReference(reference_);
+  solver_->setLimits(problem.max_speed, problem.max_acceleration, problem.max_u, problem.max_du, dt1_, dt2_);
+  solver_->setInitialState(initial_state_);
+  solution.iterations  = solver_->solveMPC();
+  solution.first_input = solver_->getFirstControlInput();
+  solver_->unlock();
+
+  return std::isfinite(solution.first_input);
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,156 @@
+#include <mrs_uav_controllers/mpc_solver/lqr_fast_path.h>
+
+#include <cmath>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+// the same input regularization as the QP backends use
+const double INPUT_REGULARIZATION = 1e-6;
+
+// how many weight combinations are kept precomputed
+const int MAX_GAINS = 4;
+
+/* LqrFastPath() //{ */
+
+LqrFastPath::LqrFastPath(const MpcModel& model) : model_(model) {
+
+  n_ = model_.horizonLength();
+
+  p_.resize(n_);
+
+  reference_ = Eigen::VectorXd::Zero(3 * n_);
+
+  gains_.reserve(MAX_GAINS);
+}
+
+//}
+
+/* prepare() //{ */
+
+void LqrFastPath::prepare(const Eigen::Vector3d& Q, const Eigen::Vector3d& S) {
+
+  if (findGains(Q, S) != nullptr) {
+    return;
+  }
+
+  Gains_t gains;
+
+  gains.Q = Q;
+  gains.S = S;
+  gains.K.resize(n_);
+  gains.Acl.resize(n_);
+  gains.g.resize(n_);
+
+  // the value function of the last state
+  Eigen::Matrix3d P = S.asDiagonal();
+
+  for (int k = n_ - 1; k >= 0; k--) {
+
+    const Eigen::Matrix3d& A = model_.A(k);
+    const Eigen::Vector3d& B = model_.B(k);
+
+    gains.g[k]   = 1.0 / (INPUT_REGULARIZATION + B.dot(P * B));
+    gains.K[k]   = gains.g[k] * (B.transpose() * P * A);
+    gains.Acl[k] = A - B * gains.K[k];
+
+    // the initial state is not penalized
+    Eigen::Matrix3d W = k > 0 ? Eigen::Matrix3d(Q.asDiagonal()) : Eigen::Matrix3d::Zero();
+
+    P = W + A.transpose() * P * gains.Acl[k];
+    P = 0.5 * (P + P.transpose());
+  }
+
+  if (int(gains_.size()) < MAX_GAINS) {
+
+    gains_.push_back(gains);
+
+  } else {
+
+    gains_[next_gains_] = gains;
+
+    next_gains_ = (next_gains_ + 1) % MAX_GAINS;
+  }
+}
+
+//}
+
+/* solve() //{ */
+
+bool LqrFastPath::solve(const MpcProblem_t& problem, MpcSolution_t& solution) {
+
+  const Gains_t* gains = findGains(problem.Q, problem.S);
+
+  if (gains == nullptr) {
+    return false;
+  }
+
+  // | -------- backward pass of the reference-dependent term -------- |
+
+  // the disturbance is accounted for by shifting the reference by its predicted effect, which gives the same cost
+  reference_.noalias() = problem.reference - problem.disturbance * model_.Delta();
+
+  // p_[k] holds the linear term of the value function of the state x_{k+1}
+  p_[n_ - 1] = -(problem.S.cwiseProduct(reference_.segment<3>(3 * (n_ - 1))));
+
+  for (int k = n_ - 1; k > 0; k--) {
+    p_[k - 1] = -(problem.Q.cwiseProduct(reference_.segment<3>(3 * (k - 1)))) + gains->Acl[k].transpose() * p_[k];
+  }
+
+  // | ---- forward rollout with the check of the constraints ---- |
+
+  // the rollout is done in the shifted coordinates, the disturbance is added back for the check of the constraints
+  Eigen::Vector3d x          = problem.initial_state;
+  Eigen::Vector3d x_dist     = Eigen::Vector3d::Zero();
+  double          last_input = problem.last_input;
+
+  for (int k = 0; k < n_; k++) {
+
+    double u = -gains->K[k].dot(x) - gains->g[k] * model_.B(k).dot(p_[k]);
+
+    if (!std::isfinite(u) || std::abs(u) > problem.max_u || std::abs(u - last_input) > problem.max_du * model_.dt(k)) {
+      return false;
+    }
+
+    x      = model_.A(k) * x + model_.B(k) * u;
+    x_dist = model_.A(k) * x_dist + problem.disturbance * model_.E(k);
+
+    if (std::abs(x[1] + x_dist[1]) > problem.max_speed || std::abs(x[2] + x_dist[2]) > problem.max_acceleration) {
+      return false;
+    }
+
+    if (k == 0) {
+      solution.first_input = u;
+    }
+
+    last_input = u;
+  }
+
+  solution.iterations = 0;
+
+  return true;
+}
+
+//}
+
+/* findGains() //{ */
+
+const LqrFastPath::Gains_t* LqrFastPath::findGains(const Eigen::Vector3d& Q, const Eigen::Vector3d& S) const {
+
+  for (size_t i = 0; i < gains_.size(); i++) {
+    if (gains_[i].Q == Q && gains_[i].S == S) {
+      return &gains_[i];
+    }
+  }
+
+  return nullptr;
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
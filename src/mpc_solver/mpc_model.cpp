@@ -0,0 +1,198 @@
+#include <mrs_uav_controllers/mpc_solver/mpc_model.h>
+
+#include <algorithm>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* MpcModel() //{ */
+
+MpcModel::MpcModel(const int horizon_length, const double dt1, const double dt2, const double p1, const double p2)
+    : horizon_length_(horizon_length), p1_(p1), p2_(p2) {
+
+  dts_ = createTwoStepSchedule(horizon_length, dt1, dt2);
+
+  compile();
+}
+
+MpcModel::MpcModel(const std::vector<double>& dts, const double p1, const double p2) : horizon_length_(int(dts.size())), p1_(p1), p2_(p2), dts_(dts) {
+
+  compile();
+}
+
+//}
+
+/* compile() //{ */
+
+void MpcModel::compile(void) {
+
+  A_.resize(horizon_length_);
+  B_.resize(horizon_length_);
+  E_.resize(horizon_length_);
+
+  for (int k = 0; k < horizon_length_; k++) {
+
+    double dt = dts_[k];
+
+    // clang-format off
+    A_[k] << 1.0, dt,  0.5 * dt * dt,
+             0.0, 1.0, dt,
+             0.0, 0.0, p1_;
+    // clang-format on
+
+    B_[k] << 0.0, 0.0, p2_;
+
+    E_[k] << 0.5 * dt * dt, dt, 0.0;
+  }
+
+  // | --------------- stacked prediction matrices -------------- |
+
+  Phi_   = Eigen::MatrixXd::Zero(3 * horizon_length_, 3);
+  Gamma_ = Eigen::MatrixXd::Zero(3 * horizon_length_, horizon_length_);
+  Delta_  = Eigen::VectorXd::Zero(3 * horizon_length_);
+
+  Eigen::Matrix3d A_prod = Eigen::Matrix3d::Identity();
+
+  for (int k = 0; k < horizon_length_; k++) {
+
+    A_prod = A_[k] * A_prod;
+
+    Phi_.block<3, 3>(3 * k, 0) = A_prod;
+
+    // x_{k+1} = A_k x_k + B_k u_k
+    Gamma_.block<3, 1>(3 * k, k) = B_[k];
+
+    for (int j = 0; j < k; j++) {
+      Gamma_.block<3, 1>(3 * k, j) = A_[k] * Gamma_.block<3, 1>(3 * (k - 1), j);
+    }
+
+    Delta_.segment<3>(3 * k) = E_[k];
+
+    if (k > 0) {
+      Delta_.segment<3>(3 * k) += A_[k] * Delta_.segment<3>(3 * (k - 1));
+    }
+  }
+}
+
+//}
+
+/* getters //{ */
+
+int MpcModel::horizonLength(void) const {
+  return horizon_length_;
+}
+
+double MpcModel::dt(const int k) const {
+  return dts_[k];
+}
+
+double MpcModel::dt1(void) const {
+  return dts_.front();
+}
+
+double MpcModel::dt2(void) const {
+  return horizon_length_ > 1 ? dts_[1] : dts_.front();
+}
+
+double MpcModel::horizonTime(void) const {
+
+  double time = 0;
+
+  for (int k = 0; k < horizon_length_; k++) {
+    time += dts_[k];
+  }
+
+  return time;
+}
+
+bool MpcModel::isTwoStep(void) const {
+
+  for (int k = 2; k < horizon_length_; k++) {
+    if (dts_[k] != dts_[1]) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+double MpcModel::p1(void) const {
+  return p1_;
+}
+
+double MpcModel::p2(void) const {
+  return p2_;
+}
+
+const Eigen::Matrix3d& MpcModel::A(const int k) const {
+  return A_[k];
+}
+
+const Eigen::Vector3d& MpcModel::B(const int k) const {
+  return B_[k];
+}
+
+const Eigen::Vector3d& MpcModel::E(const int k) const {
+  return E_[k];
+}
+
+const Eigen::MatrixXd& MpcModel::Phi(void) const {
+  return Phi_;
+}
+
+const Eigen::MatrixXd& MpcModel::Gamma(void) const {
+  return Gamma_;
+}
+
+const Eigen::VectorXd& MpcModel::Delta(void) const {
+  return Delta_;
+}
+
+//}
+
+/* createTwoStepSchedule() //{ */
+
+std::vector<double> createTwoStepSchedule(const int horizon_length, const double dt1, const double dt2) {
+
+  std::vector<double> dts(horizon_length, dt2);
+
+  if (horizon_length > 0) {
+    dts[0] = dt1;
+  }
+
+  return dts;
+}
+
+//}
+
+/* createGeometricSchedule() //{ */
+
+std::vector<double> createGeometricSchedule(const int horizon_length, const double dt1, const double dt2, const double ratio, const double max_dt) {
+
+  std::vector<double> dts(horizon_length);
+
+  double dt = dt2;
+
+  for (int k = 0; k < horizon_length; k++) {
+
+    if (k == 0) {
+      dts[k] = dt1;
+      continue;
+    }
+
+    dts[k] = std::min(dt, max_dt);
+
+    dt *= ratio;
+  }
+
+  return dts;
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
@@ -0,0 +1,154 @@
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+#include <mrs_uav_controllers/mpc_solver/admm_solver_backend.h>
+
+#ifdef MPC_CONTROLLER_LEGACY_SOLVER
+#include <mrs_uav_controllers/mpc_solver/legacy_solver_backend.h>
+#endif
+
+#include <chrono>
+#include <limits>
+
+namespace mrs_uav_controllers
+{
+
+namespace mpc_solver
+{
+
+/* createMpcProblem() //{ */
+
+MpcProblem_t createMpcProblem(const MpcModel& model) {
+
+  MpcProblem_t problem;
+
+  problem.initial_state = Eigen::Vector3d::Zero();
+  problem.reference     = Eigen::VectorXd::Zero(3 * model.horizonLength());
+
+  problem.Q = Eigen::Vector3d::Zero();
+  problem.S = Eigen::Vector3d::Zero();
+
+  problem.max_speed        = std::numeric_limits<double>::max();
+  problem.max_acceleration = std::numeric_limits<double>::max();
+  problem.max_u            = std::numeric_limits<double>::max();
+  problem.max_du           = std::numeric_limits<double>::max();
+
+  problem.last_input  = 0;
+  problem.disturbance = 0;
+
+  return problem;
+}
+
+//}
+
+/* getAvailableMpcSolverBackends() //{ */
+
+std::vector<std::string> getAvailableMpcSolverBackends(void) {
+
+#ifdef MPC_CONTROLLER_LEGACY_SOLVER
+  return std::vector<std::string>{"legacy", "admm"};
+#else
+  return std::vector<std::string>{"admm"};
+#endif
+}
+
+//}
+
+/* isMpcSolverBackendCompatible() //{ */
+
+bool isMpcSolverBackendCompatible(const std::string& type, [[maybe_unused]] const MpcModel& model) {
+
+#ifdef MPC_CONTROLLER_LEGACY_SOLVER
+  if (type == "legacy") {
+    return LegacySolverBackend::supportsModel(model);
+  }
+#endif
+
+  if (type == "admm") {
+    return true;
+  }
+
+  return false;
+}
+
+//}
+
+/* createMpcSolverBackend() //{ */
+
+std::unique_ptr<MpcSolverBackend> createMpcSolverBackend(const std::string& type, const MpcModel& model, const MpcSolverParams_t& params) {
+
+  if (!isMpcSolverBackendCompatible(type, model)) {
+    return nullptr;
+  }
+
+#ifdef MPC_CONTROLLER_LEGACY_SOLVER
+  if (type == "legacy") {
+    return std::make_unique<LegacySolverBackend>(model, params);
+  }
+#endif
+
+  if (type == "admm") {
+    return std::make_unique<AdmmSolverBackend>(model, params);
+  }
+
+  return nullptr;
+}
+
+//}
+
+/* benchmarkMpcSolverBackends() //{ */
+
+std::string benchmarkMpcSolverBackends(const MpcModel& model, const MpcSolverParams_t& params, const MpcProblem_t& problem, const int n_solves,
+                                       std::vector<double>& timings) {
+
+  std::vector<std::string> backends = getAvailableMpcSolverBackends();
+
+  timings.clear();
+
+  std::string fastest;
+  double      fastest_time = std::numeric_limits<double>::max();
+
+  for (size_t i = 0; i < backends.size(); i++) {
+
+    std::unique_ptr<MpcSolverBackend> backend = createMpcSolverBackend(backends[i], model, params);
+
+    if (!backend) {
+      timings.push_back(std::numeric_limits<double>::infinity());
+      continue;
+    }
+
+    MpcProblem_t  bench_problem = problem;
+    MpcSolution_t solution;
+
+    // warm up the caches and the factorizations
+    backend->solve(bench_problem, solution);
+
+    auto start = std::chrono::steady_clock::now();
+
+    bool success = true;
+
+    for (int j = 0; j < n_solves; j++) {
+
+      success &= backend->solve(bench_problem, solution);
+
+      // close the loop with a crude model of the plant, so the problem does not stay the same
+      bench_problem.initial_state = model.A(0) * bench_problem.initial_state + model.B(0) * solution.first_input;
+      bench_problem.last_input    = solution.first_input;
+    }
+
+    double mean_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / double(std::max(n_solves, 1));
+
+    timings.push_back(mean_time);
+
+    if (success && mean_time < fastest_time) {
+      fastest      = backends[i];
+      fastest_time = mean_time;
+    }
+  }
+
+  return fastest;
+}
+
+//}
+
+}  // namespace mpc_solver
+
+}  // namespace mrs_uav_controllers
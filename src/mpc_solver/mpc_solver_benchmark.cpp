@@ -0,0 +1,264 @@
+/* the solve time of the MPC solver backends against the reach of the prediction horizon */
+
+#include <mrs_uav_controllers/mpc_solver/mpc_solver_backend.h>
+#include <mrs_uav_controllers/mpc_solver/admm_kernels.h>
+#include <mrs_uav_controllers/common/perf_counters.h>
+#include <mrs_uav_controllers/common/benchmark_utils.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+using namespace mrs_uav_controllers::mpc_solver;
+using namespace mrs_uav_controllers::common;
+
+/* struct Schedule_t //{ */
+
+typedef struct
+{
+  std::string         name;
+  std::vector<double> dts;
+} Schedule_t;
+
+//}
+
+/* struct BackendProfile_t //{ */
+
+typedef struct
+{
+  bool        valid;
+  double      median_time;
+  double      p99_time;
+  double      allocations;  // per solve
+  std::string counters_json;
+} BackendProfile_t;
+
+//}
+
+/* profileMpcSolverBackend() //{ */
+
+// the same closed loop as benchmarkMpcSolverBackends(), timing each solve separately
+BackendProfile_t profileMpcSolverBackend(const std::string& type, const MpcModel& model, const MpcSolverParams_t& params, const MpcProblem_t& problem,
+                                         const int n_solves, const bool counters) {
+
+  BackendProfile_t profile{false, 0, 0, 0, "null"};
+
+  std::unique_ptr<MpcSolverBackend> backend = createMpcSolverBackend(type, model, params);
+
+  if (!backend) {
+    return profile;
+  }
+
+  MpcProblem_t  bench_problem = problem;
+  MpcSolution_t solution;
+
+  backend->solve(bench_problem, solution);
+
+  std::vector<double> durations(std::max(n_solves, 1), 0.0);
+
+  uint64_t allocations_start = getAllocationCount();
+
+  for (int j = 0; j < n_solves; j++) {
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    backend->solve(bench_problem, solution);
+
+    durations[j] = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+
+    bench_problem.initial_state = model.A(0) * bench_problem.initial_state + model.B(0) * solution.first_input;
+    bench_problem.last_input    = solution.first_input;
+  }
+
+  profile.valid       = true;
+  profile.allocations = double(getAllocationCount() - allocations_start) / double(std::max(n_solves, 1));
+  profile.median_time = samplePercentile(durations, 0.50);
+  profile.p99_time    = samplePercentile(durations, 0.99);
+
+  // | ----------------- the performance counters ----------------- |
+
+  // a separate pass, the reads of the counters would distort the timings above
+  if (!counters) {
+    return profile;
+  }
+
+  PerfCounters perf_counters;
+
+  if (!perf_counters.isAvailable()) {
+    return profile;
+  }
+
+  bench_problem = problem;
+
+  for (int j = 0; j < n_solves; j++) {
+
+    perf_counters.start();
+
+    backend->solve(bench_problem, solution);
+
+    perf_counters.stop();
+
+    bench_problem.initial_state = model.A(0) * bench_problem.initial_state + model.B(0) * solution.first_input;
+    bench_problem.last_input    = solution.first_input;
+  }
+
+  profile.counters_json = perfCountersToJson(perf_counters.getValues());
+
+  return profile;
+}
+
+//}
+
+/* main() //{ */
+
+int main(int argc, char** argv) {
+
+  int n_solves = 1000;
+
+  bool        counters = false;
+  std::string json_file;
+
+  // mpc_solver_benchmark [n_solves] [--counters] [--json <file>]
+  for (int i = 1; i < argc; i++) {
+
+    if (strcmp(argv[i], "--counters") == 0) {
+      counters = true;
+    } else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+      json_file = argv[++i];
+    } else {
+      n_solves = std::atoi(argv[i]);
+    }
+  }
+
+  if (counters) {
+
+    PerfCounters perf_counters;
+
+    if (!perf_counters.isAvailable()) {
+      printf("the performance counters are not available: %s\n", perf_counters.getError().c_str());
+      counters = false;
+    }
+  }
+
+  // the horizontal model and the default weights and limits of config/default/mpc.yaml
+  MpcSolverParams_t params;
+  params.name           = "MpcSolverBenchmark";
+  params.verbose        = false;
+  params.max_iterations = 30;
+  params.Q              = Eigen::Vector3d(500, 100, 100);
+  params.S              = Eigen::Vector3d(1000, 300, 300);
+
+  std::vector<Schedule_t> schedules;
+
+  schedules.push_back({"two_step N=26", createTwoStepSchedule(26, 0.01, 0.05)});
+  schedules.push_back({"two_step N=40", createTwoStepSchedule(40, 0.01, 0.05)});
+  schedules.push_back({"two_step N=80", createTwoStepSchedule(80, 0.01, 0.05)});
+  schedules.push_back({"geometric N=26", createGeometricSchedule(26, 0.01, 0.05, 1.1, 0.2)});
+  schedules.push_back({"geometric N=20", createGeometricSchedule(20, 0.01, 0.05, 1.15, 0.3)});
+  schedules.push_back({"geometric N=15", createGeometricSchedule(15, 0.01, 0.05, 1.25, 0.5)});
+
+  std::vector<std::string> backends = getAvailableMpcSolverBackends();
+
+  printf("admm kernels: %s\n", getAdmmKernelIsa());
+
+  printf("%-16s %4s %9s", "schedule", "N", "reach [s]");
+
+  for (size_t i = 0; i < backends.size(); i++) {
+    printf(" %12s", (backends[i] + " [us]").c_str());
+  }
+
+  printf("\n");
+
+  std::string json_schedules;
+
+  for (size_t i = 0; i < schedules.size(); i++) {
+
+    MpcModel model(schedules[i].dts, 0, 1.0);
+
+    // a step in the position reference while the limits are active
+    MpcProblem_t problem = createMpcProblem(model);
+
+    problem.initial_state << 5.0, 0.0, 0.0;
+    problem.Q                = params.Q;
+    problem.S                = params.S;
+    problem.max_speed        = 2.0;
+    problem.max_acceleration = 999;
+    problem.max_u            = 2.0;
+    problem.max_du           = 5.0;
+
+    std::vector<double> timings;
+
+    benchmarkMpcSolverBackends(model, params, problem, n_solves, timings);
+
+    printf("%-16s %4d %9.2f", schedules[i].name.c_str(), model.horizonLength(), model.horizonTime());
+
+    for (size_t j = 0; j < timings.size(); j++) {
+
+      if (std::isfinite(timings[j])) {
+        printf(" %12.1f", 1e6 * timings[j]);
+      } else {
+        printf(" %12s", "-");
+      }
+    }
+
+    printf("\n");
+
+    std::string json_backends;
+
+    char buffer[256];
+
+    for (size_t j = 0; j < timings.size(); j++) {
+
+      BackendProfile_t profile = profileMpcSolverBackend(backends[j], model, params, problem, n_solves, counters);
+
+      if (!profile.valid) {
+        continue;
+      }
+
+      printf("  %-14s median %.1f us, p99 %.1f us, %.2f allocations\n", backends[j].c_str(), 1e6 * profile.median_time, 1e6 * profile.p99_time,
+             profile.allocations);
+
+      if (counters) {
+        printf("  %-14s %s\n", "", profile.counters_json.c_str());
+      }
+
+      snprintf(buffer, sizeof(buffer), "\"mean_time\": %.9f, \"median_time\": %.9f, \"p99_time\": %.9f, \"allocations\": %.3f", timings[j],
+               profile.median_time, profile.p99_time, profile.allocations);
+
+      json_backends += std::string(json_backends.empty() ? "" : ", ") + "{\"name\": \"" + backends[j] + "\", " + buffer + ", \"counters\": " + profile.counters_json + "}";
+    }
+
+    snprintf(buffer, sizeof(buffer), "%.3f", model.horizonTime());
+
+    json_schedules += std::string(i > 0 ? ",\n" : "") + "    {\"name\": \"" + schedules[i].name + "\", \"horizon_length\": " + std::to_string(model.horizonLength()) +
+                      ", \"horizon_time\": " + buffer + ", \"backends\": [" + json_backends + "]}";
+  }
+
+  // | ------------------------ json output ----------------------- |
+
+  if (!json_file.empty()) {
+
+    FILE* file = fopen(json_file.c_str(), "w");
+
+    if (file == nullptr) {
+      printf("could not open '%s'\n", json_file.c_str());
+      return 1;
+    }
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"benchmark\": \"mpc_solver\",\n");
+    fprintf(file, "  \"build\": \"%s\",\n", getBuildDescription());
+    fprintf(file, "  \"kernel_isa\": \"%s\",\n", getAdmmKernelIsa());
+    fprintf(file, "  \"n_solves\": %d,\n", n_solves);
+    fprintf(file, "  \"schedules\": [\n%s\n  ]\n", json_schedules.c_str());
+    fprintf(file, "}\n");
+
+    fclose(file);
+  }
+
+  return 0;
+}
+
+//}
@@ -15,12 +15,34 @@
 #include <mrs_lib/mutex.h>
 #include <mrs_lib/attitude_converter.h>
 
+#include <mrs_uav_controllers/common/state_predictor.h>
+#include <mrs_uav_controllers/common/rate_controller.h>
+#include <mrs_uav_controllers/common/control_allocation.h>
+#include <mrs_uav_controllers/common/flatness.h>
+#include <mrs_uav_controllers/common/flight_recorder_utils.h>
+#include <mrs_uav_controllers/common/controller_health.h>
+#include <mrs_uav_controllers/common/tracing.h>
+#include <mrs_uav_controllers/common/high_rate.h>
+#include <mrs_uav_controllers/common/attitude_math.h>
+#include <mrs_uav_controllers/common/shadow_mode.h>
+
 #include <geometry_msgs/Vector3Stamped.h>
 
+#include <mavros_msgs/ActuatorControl.h>
+#include <mavros_msgs/AttitudeTarget.h>
+
+#include <sensor_msgs/Imu.h>
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+
 //}
 
 #define OUTPUT_ATTITUDE_RATE 0
 #define OUTPUT_ATTITUDE_QUATERNION 1
+#define OUTPUT_TORQUE 2
+#define OUTPUT_FULLY_ACTUATED 3
 
 namespace mrs_uav_controllers
 {
@@ -53,14 +75,16 @@ private:
   std::string _version_;
 
   bool is_initialized_ = false;
-  bool is_active_      = false;
+
+  // written by the control manager, read by the callbacks of the attitude loop which decide whether to forward the setpoints
+  std::atomic<bool> is_active_ = false;
 
   std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers_;
 
   // | ------------------------ uav state ----------------------- |
 
-  mrs_msgs::UavState uav_state_;
-  std::mutex         mutex_uav_state_;
+  // the last measured state, swapped atomically (boost::atomic_store/load) instead of copied under a mutex
+  mrs_msgs::UavState::ConstPtr uav_state_;
 
   // | --------------- dynamic reconfigure server --------------- |
 
@@ -115,6 +139,18 @@ private:
   double _gains_filter_change_rate_;
   double _gains_filter_min_change_rate_;
 
+  // the filtered gains are echoed to the drs by a timer at a low rate, the control thread does no ROS I/O,
+  // the echo is built from the drs params of a sequence number and dropped when callbackDrs() came since
+  DrsConfig_t drs_write_back_;
+  bool        drs_write_back_pending_  = false;
+  uint64_t    drs_write_back_sequence_ = 0;
+  uint64_t    drs_sequence_            = 0;  // bumped by callbackDrs()
+  std::mutex  mutex_drs_write_back_;
+  ros::Timer  timer_drs_write_back_;
+  double      _gains_filter_write_back_rate_;
+
+  void timerDrsWriteBack(const ros::TimerEvent& event);
+
   // | ------------ controller limits and saturations ----------- |
 
   bool   _tilt_angle_failsafe_enabled_;
@@ -130,11 +166,55 @@ private:
   ros::Time last_update_time_;
   bool      first_iteration_ = true;
 
+  double last_uav_heading_ = 0;  // the fallback when the heading is singular
+
+  // | ---------------- high-rate odometry, 1 kHz ---------------- |
+
+  common::HighRateParams_t _high_rate_;
+  double                   _min_dt_;  // [s] the closer odometry is skipped
+
+  common::Decimator transform_decimator_;
+
   // | ----------------------- output mode ---------------------- |
 
-  int        output_mode_;  // attitude_rate / acceleration
+  int        output_mode_;  // attitude_rate / acceleration / torque / fully actuated
   std::mutex mutex_output_mode_;
 
+  // | ---------------------- torque output --------------------- |
+
+  std::unique_ptr<common::RateController>    rate_controller_;
+  std::unique_ptr<common::ControlAllocation> control_allocation_;
+  std::unique_ptr<common::ControlAllocation> full_allocation_;  // of the fully actuated multirotor
+
+  common::MotorVector_t throttles_;
+
+  Eigen::Vector3d _max_torque_;  // [N m], normalization of the torque for the autopilot's mixer
+  int             _mixer_group_;
+
+  ros::Publisher publisher_actuator_control_;
+
+  // what update() leaves for the rate loop, which runs on every IMU message with the gyro as the feedback
+  typedef struct
+  {
+    bool            valid = false;
+    ros::Time       stamp;        // of the update() which produced it
+    int             output_mode;  // torque / fully actuated
+    Eigen::Vector3d rate;         // [rad/s], the desired attitude rate
+    bool            flatness_feedforward;
+    Eigen::Vector3d angular_acceleration;  // [rad/s^2], the feedforward from the differential flatness
+    double          thrust;                // [-], after the rampup
+    double          collective_force;      // [N]
+    Eigen::Vector3d body_force;            // [N], of the fully actuated multirotor
+  } RateLoopSetpoint_t;
+
+  RateLoopSetpoint_t rate_loop_setpoint_;
+  ros::Time          rate_loop_imu_stamp_;  // of the last gyro measurement fed to the rate controller
+  std::mutex         mutex_rate_loop_;      // also locks the rate controller and the throttles
+
+  void updateRateLoop(const sensor_msgs::Imu& imu);
+
+  void resetRateLoop(void);
+
   // | ------------------------ profiler_ ------------------------ |
 
   mrs_lib::Profiler profiler_;
@@ -157,6 +237,70 @@ private:
   double    rampup_duration_;
   ros::Time rampup_start_time_;
   ros::Time rampup_last_time_;
+
+  // | -------------------- state prediction -------------------- |
+
+  std::unique_ptr<common::StatePredictor> state_predictor_;
+
+  // | --------------------- flight recorder -------------------- |
+
+  std::unique_ptr<common::FlightRecorder> flight_recorder_;
+  common::FlightRecord_t                  flight_record_;
+
+  // | ------------------------- health ------------------------- |
+
+  std::unique_ptr<common::ControllerHealth> health_;
+
+  // | ------------------ IMU-rate attitude loop ----------------- |
+
+  // what update() leaves for the attitude loop, which runs on every IMU message
+  typedef struct
+  {
+    bool            valid = false;
+    ros::Time       stamp;                    // of the update() which produced it
+    Eigen::Matrix3d Rd;                       // the desired orientation
+    Eigen::Matrix3d R_alignment;              // rotates the IMU orientation into the frame of the odometry
+    Eigen::Array3d  Kq;                       // the attitude gains
+    Eigen::Vector3d rate_feedforward;         // Rw + q_feedforward
+    Eigen::Vector3d flatness_feedforward;     // q_feedforward, excluded from the parasitic heading rate compensation
+    bool            heading_rate_compensation;
+    Eigen::Vector3d rate_limit;               // [rad/s], the dynamics constraints
+    double          thrust;
+  } AttitudeLoopSetpoint_t;
+
+  bool   _attitude_loop_enabled_ = false;
+  double _attitude_loop_max_age_;
+
+  AttitudeLoopSetpoint_t attitude_loop_setpoint_;
+  Eigen::Matrix3d        imu_orientation_;  // the last orientation from the IMU
+  ros::Time              imu_stamp_;
+  std::mutex             mutex_attitude_loop_;
+
+  ros::Subscriber subscriber_imu_;
+  ros::Publisher  publisher_attitude_target_;
+
+  void callbackImu(const sensor_msgs::Imu::ConstPtr& msg);
+
+  void resetAttitudeLoop(void);
+
+  // the setpoint of the control manager is routed through the controller, which forwards it to the autopilot
+  // only while the attitude or the rate loop is not publishing, so the autopilot gets a single stream of setpoints
+  ros::Subscriber subscriber_manager_output_;
+  ros::Time       imu_loop_output_time_;  // of the last output of the attitude or the rate loop, zero when they stopped
+
+  void callbackManagerOutput(const mavros_msgs::AttitudeTarget::ConstPtr& msg);
+
+  // | ----------------------- shadow mode ---------------------- |
+
+  // the copy of the controller evaluated by the shadow mode, initialized from the same params without any ROS I/O,
+  // it is updated only by the shadow worker, the control manager never sees it
+  bool                           shadow_instance_ = false;
+  std::unique_ptr<Se3Controller> shadow_controller_;
+
+  const mrs_msgs::AttitudeCommand::ConstPtr updateShadow(const common::ShadowFrame_t& frame);
+
+  // the last member, its worker is joined before the copy it updates is destroyed
+  std::unique_ptr<common::ShadowMode> shadow_mode_;
 };
 
 //}
@@ -167,7 +311,7 @@ private:
 
 /* //{ initialize() */
 
-void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]] const std::string name, const std::string name_space, const double uav_mass,
+void Se3Controller::initialize(const ros::NodeHandle& parent_nh, const std::string name, const std::string name_space, const double uav_mass,
                                std::shared_ptr<mrs_uav_managers::CommonHandlers_t> common_handlers) {
 
   ros::NodeHandle nh_(parent_nh, name_space);
@@ -234,6 +378,7 @@ void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]
   // gain filtering
   param_loader.loadParam("gains_filter/perc_change_rate", _gains_filter_change_rate_);
   param_loader.loadParam("gains_filter/min_change_rate", _gains_filter_min_change_rate_);
+  param_loader.loadParam("gains_filter/write_back_rate", _gains_filter_write_back_rate_);
 
   // gain muting
   param_loader.loadParam("gain_mute_coefficient", _gain_mute_coefficient_);
@@ -241,12 +386,81 @@ void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]
   // output mode
   param_loader.loadParam("output_mode", output_mode_);
 
+  // IMU-rate attitude loop
+  param_loader.loadParam("attitude_loop/enabled", _attitude_loop_enabled_);
+  param_loader.loadParam("attitude_loop/max_age", _attitude_loop_max_age_);
+
   param_loader.loadParam("rotation_matrix", drs_params_.rotation_type);
 
   // angular rate feed forward
   param_loader.loadParam("angular_rate_feedforward/parasitic_pitch_roll", drs_params_.pitch_roll_heading_rate_compensation);
   param_loader.loadParam("angular_rate_feedforward/jerk", drs_params_.jerk_feedforward);
 
+  // state prediction
+  common::StatePredictorParams_t state_prediction;
+  std::string                    state_prediction_delay_mode;
+
+  param_loader.loadParam("state_prediction/enabled", state_prediction.enabled);
+  param_loader.loadParam("state_prediction/delay_mode", state_prediction_delay_mode);
+  param_loader.loadParam("state_prediction/fixed_delay", state_prediction.fixed_delay);
+  param_loader.loadParam("state_prediction/actuation_delay", state_prediction.actuation_delay);
+  param_loader.loadParam("state_prediction/max_delay", state_prediction.max_delay);
+  param_loader.loadParam("state_prediction/history_length", state_prediction.history_length);
+
+  // torque output
+  common::RateControllerParams_t rate_controller;
+  std::vector<double>            inertia, rate_gains, max_torque, motors;
+  bool                           mixer_enabled;
+  double                         torque_coefficient;
+
+  param_loader.loadParam("torque_output/inertia", inertia);
+  param_loader.loadParam("torque_output/rate_gains", rate_gains);
+  param_loader.loadParam("torque_output/feedforward_tc", rate_controller.feedforward_tc);
+  param_loader.loadParam("torque_output/max_torque", max_torque);
+  param_loader.loadParam("torque_output/mixer/enabled", mixer_enabled);
+  param_loader.loadParam("torque_output/mixer/torque_coefficient", torque_coefficient);
+  param_loader.loadParam("torque_output/mixer/motors", motors);
+  param_loader.loadParam("torque_output/mixer/group", _mixer_group_);
+
+  // fully actuated multirotor
+  bool                fully_actuated_enabled;
+  double              fully_actuated_torque_coefficient;
+  std::vector<double> fully_actuated_motors;
+
+  param_loader.loadParam("fully_actuated/enabled", fully_actuated_enabled);
+  param_loader.loadParam("fully_actuated/torque_coefficient", fully_actuated_torque_coefficient);
+  param_loader.loadParam("fully_actuated/motors", fully_actuated_motors);
+
+  // flight recorder
+  bool        flight_recorder_enabled;
+  std::string flight_recorder_directory;
+  int         flight_recorder_capacity;
+
+  param_loader.loadParam("flight_recorder/enabled", flight_recorder_enabled);
+  param_loader.loadParam("flight_recorder/directory", flight_recorder_directory);
+  param_loader.loadParam("flight_recorder/capacity", flight_recorder_capacity);
+
+  // diagnostics
+  common::ControllerHealthParams_t health;
+
+  param_loader.loadParam("diagnostics/rate", health.rate);
+  param_loader.loadParam("diagnostics/max_update_time", health.max_update_time);
+
+  // high-rate odometry
+  param_loader.loadParam("high_rate/enabled", _high_rate_.enabled);
+  param_loader.loadParam("high_rate/min_dt", _high_rate_.min_dt);
+  param_loader.loadParam("high_rate/transform_decimation", _high_rate_.transform_decimation);
+  param_loader.loadParam("high_rate/update_budget", _high_rate_.update_budget);
+
+  // shadow mode
+  common::ShadowModeParams_t shadow;
+
+  param_loader.loadParam("shadow_mode/enabled", shadow.enabled);
+  param_loader.loadParam("shadow_mode/queue_size", shadow.queue_size);
+  param_loader.loadParam("shadow_mode/log_period", shadow.log_period);
+  param_loader.loadParam("shadow_mode/max_stamp_offset", shadow.max_stamp_offset);
+  param_loader.loadParam("shadow_mode/cpus", shadow.cpus);
+
   if (!param_loader.loadedSuccessfully()) {
     ROS_ERROR("[Se3Controller]: could not load all parameters!");
     ros::shutdown();
@@ -254,18 +468,120 @@ void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]
 
   // | ---------------- prepare stuff from params --------------- |
 
-  if (!(output_mode_ == OUTPUT_ATTITUDE_RATE || output_mode_ == OUTPUT_ATTITUDE_QUATERNION)) {
-    ROS_ERROR("[Se3Controller]: output mode has to be {0, 1}!");
+  if (!(output_mode_ == OUTPUT_ATTITUDE_RATE || output_mode_ == OUTPUT_ATTITUDE_QUATERNION || output_mode_ == OUTPUT_TORQUE ||
+        output_mode_ == OUTPUT_FULLY_ACTUATED)) {
+    ROS_ERROR("[Se3Controller]: output mode has to be {0, 1, 2, 3}!");
+    ros::shutdown();
+  }
+
+  if (inertia.size() != 3 || rate_gains.size() != 3 || max_torque.size() != 3) {
+    ROS_ERROR("[Se3Controller]: torque_output/inertia, rate_gains and max_torque have to have 3 elements!");
     ros::shutdown();
   }
 
+  rate_controller.inertia = Eigen::Vector3d(inertia[0], inertia[1], inertia[2]);
+  rate_controller.gains   = Eigen::Vector3d(rate_gains[0], rate_gains[1], rate_gains[2]);
+  _max_torque_            = Eigen::Vector3d(max_torque[0], max_torque[1], max_torque[2]);
+
+  rate_controller_ = std::make_unique<common::RateController>(rate_controller);
+
+  if (mixer_enabled) {
+
+    // the motors are given as triplets [x, y, direction]
+    if (motors.empty() || motors.size() % 3 != 0 || motors.size() / 3 > size_t(common::CONTROL_ALLOCATION_MAX_MOTORS)) {
+      ROS_ERROR("[Se3Controller]: torque_output/mixer/motors has to contain [x, y, direction] of up to 8 motors!");
+      ros::shutdown();
+    }
+
+    std::vector<common::Motor_t> layout;
+
+    for (size_t i = 0; i + 2 < motors.size(); i += 3) {
+      layout.push_back({motors[i], motors[i + 1], motors[i + 2]});
+    }
+
+    control_allocation_ = std::make_unique<common::ControlAllocation>(layout, torque_coefficient, common_handlers_->motor_params);
+  }
+
+  if (fully_actuated_enabled) {
+
+    // the motors are given as [x, y, z, axis_x, axis_y, axis_z, direction]
+    if (fully_actuated_motors.empty() || fully_actuated_motors.size() % 7 != 0 ||
+        fully_actuated_motors.size() / 7 > size_t(common::CONTROL_ALLOCATION_MAX_MOTORS)) {
+      ROS_ERROR("[Se3Controller]: fully_actuated/motors has to contain [x, y, z, axis_x, axis_y, axis_z, direction] of up to 8 motors!");
+      ros::shutdown();
+    }
+
+    std::vector<common::TiltedMotor_t> layout;
+
+    for (size_t i = 0; i + 6 < fully_actuated_motors.size(); i += 7) {
+
+      const double* m = &fully_actuated_motors[i];
+
+      layout.push_back({Eigen::Vector3d(m[0], m[1], m[2]), Eigen::Vector3d(m[3], m[4], m[5]), m[6]});
+    }
+
+    full_allocation_ = std::make_unique<common::ControlAllocation>(layout, fully_actuated_torque_coefficient, common_handlers_->motor_params);
+
+    if (full_allocation_->rank() < 6) {
+      ROS_ERROR("[Se3Controller]: the motors in fully_actuated/motors can not produce an arbitrary wrench (the rank is %d)!", full_allocation_->rank());
+      ros::shutdown();
+    }
+  }
+
+  if (output_mode_ == OUTPUT_FULLY_ACTUATED && !full_allocation_) {
+    ROS_ERROR("[Se3Controller]: output mode 3 needs fully_actuated/enabled = true!");
+    ros::shutdown();
+  }
+
+  if (state_prediction_delay_mode == "measured") {
+    state_prediction.measure_delay = true;
+  } else if (state_prediction_delay_mode == "fixed") {
+    state_prediction.measure_delay = false;
+  } else {
+    ROS_ERROR("[Se3Controller]: state_prediction/delay_mode has to be {\"measured\", \"fixed\"}!");
+    ros::shutdown();
+  }
+
+  state_predictor_ = std::make_unique<common::StatePredictor>(state_prediction);
+
+  if (flight_recorder_enabled && !shadow_instance_) {
+
+    std::string path = common::getFlightRecorderPath(flight_recorder_directory, name);
+
+    flight_recorder_ = std::make_unique<common::FlightRecorder>(path, size_t(std::max(flight_recorder_capacity, 1)), "Se3Controller");
+
+    if (flight_recorder_->isOpen()) {
+      ROS_INFO("[Se3Controller]: recording the flight into '%s'", path.c_str());
+    } else {
+      ROS_ERROR("[Se3Controller]: could not open the flight recorder: %s", flight_recorder_->getError().c_str());
+      flight_recorder_.reset();
+    }
+  }
+
+  // | ------------------ high-rate odometry ------------------- |
+
+  if (_high_rate_.enabled) {
+
+    _min_dt_             = _high_rate_.min_dt;
+    transform_decimator_ = common::Decimator(_high_rate_.transform_decimation);
+
+    health.max_update_time = _high_rate_.update_budget;
+
+    ROS_INFO("[Se3Controller]: high-rate odometry: min dt %.4f s, transforms on every %d. update, budget %.1f us", _min_dt_,
+             transform_decimator_.getPeriod(), 1e6 * _high_rate_.update_budget);
+
+  } else {
+
+    _min_dt_ = 0.001;
+  }
+
+  health_ = std::make_unique<common::ControllerHealth>(name, std::vector<std::string>{"mass difference [kg]"}, health);
+
   // initialize the integrals
   uav_mass_difference_ = 0;
   Iw_w_                = Eigen::Vector2d::Zero(2);
   Ib_b_                = Eigen::Vector2d::Zero(2);
 
-  // | --------------- dynamic reconfigure server --------------- |
-
   drs_params_.kpxy             = kpxy_;
   drs_params_.kvxy             = kvxy_;
   drs_params_.kaxy             = kaxy_;
@@ -283,15 +599,63 @@ void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]
   drs_params_.output_mode      = output_mode_;
   drs_params_.jerk_feedforward = true;
 
+  // the copy for the shadow mode ends here, the drs params come from the live instance
+  if (shadow_instance_) {
+
+    profiler_ = mrs_lib::Profiler(nh_, "Se3Controller", false);
+
+    is_initialized_ = true;
+    return;
+  }
+
+  // | ----------------------- publishers ----------------------- |
+
+  health_->advertise(nh_);
+
+  publisher_actuator_control_ = nh_.advertise<mavros_msgs::ActuatorControl>("actuator_control_out", 1);
+
+  // the torque output can be switched on by the drs, so the IMU and the setpoints of the control manager are subscribed
+  // even without the attitude loop, nothing is published when they are not remapped
+  publisher_attitude_target_ = nh_.advertise<mavros_msgs::AttitudeTarget>("attitude_target_out", 1);
+
+  subscriber_imu_ = nh_.subscribe("imu_in", 1, &Se3Controller::callbackImu, this, ros::TransportHints().tcpNoDelay());
+
+  subscriber_manager_output_ =
+      nh_.subscribe("manager_attitude_target_in", 1, &Se3Controller::callbackManagerOutput, this, ros::TransportHints().tcpNoDelay());
+
+  if (_attitude_loop_enabled_ || output_mode_ == OUTPUT_TORQUE || output_mode_ == OUTPUT_FULLY_ACTUATED) {
+    ROS_INFO("[Se3Controller]: the %s loop is closed at the rate of '%s', the setpoints of the control manager are expected on '%s'",
+             _attitude_loop_enabled_ ? "attitude" : "attitude rate", subscriber_imu_.getTopic().c_str(), subscriber_manager_output_.getTopic().c_str());
+  }
+
+  // | --------------- dynamic reconfigure server --------------- |
+
   drs_.reset(new Drs_t(mutex_drs_, nh_));
   drs_->updateConfig(drs_params_);
   Drs_t::CallbackType f = boost::bind(&Se3Controller::callbackDrs, this, _1, _2);
   drs_->setCallback(f);
 
+  timer_drs_write_back_ = nh_.createTimer(ros::Rate(_gains_filter_write_back_rate_), &Se3Controller::timerDrsWriteBack, this);
+
   // | ------------------------ profiler ------------------------ |
 
   profiler_ = mrs_lib::Profiler(nh_, "Se3Controller", _profiler_enabled_);
 
+  // | ----------------------- shadow mode ---------------------- |
+
+  if (shadow.enabled) {
+
+    shadow_controller_                   = std::make_unique<Se3Controller>();
+    shadow_controller_->shadow_instance_ = true;
+    shadow_controller_->initialize(parent_nh, name, name_space, uav_mass, common_handlers);
+
+    shadow_mode_ = std::make_unique<common::ShadowMode>(name, shadow, [this](const common::ShadowFrame_t& frame) { return updateShadow(frame); });
+    shadow_mode_->start(nh_);
+
+    // the controller is loaded inactive
+    shadow_mode_->resume();
+  }
+
   // | ----------------------- finish init ---------------------- |
 
   ROS_INFO("[Se3Controller]: initialized, version %s", VERSION);
@@ -305,10 +669,16 @@ void Se3Controller::initialize(const ros::NodeHandle& parent_nh, [[maybe_unused]
 
 bool Se3Controller::activate(const mrs_msgs::AttitudeCommand::ConstPtr& last_attitude_cmd) {
 
+  CONTROLLER_TRACE1(activate, "Se3Controller");
+
+  // the copy of the shadow mode, activated by its worker
+  const bool shadow = shadow_instance_;
+
   if (last_attitude_cmd == mrs_msgs::AttitudeCommand::Ptr()) {
 
     ROS_WARN("[Se3Controller]: activated without getting the last controller's command");
 
+    // the controller stays inactive, the shadow evaluation goes on
     return false;
 
   } else {
@@ -359,7 +729,15 @@ bool Se3Controller::activate(const mrs_msgs::AttitudeCommand::ConstPtr& last_att
   first_iteration_ = true;
   gains_muted_     = true;
 
-  ROS_INFO("[Se3Controller]: activated");
+  state_predictor_->reset();
+  transform_decimator_.reset();
+
+  // does not wait, the copy keeps evaluating the frame it has, its output is dropped
+  if (shadow_mode_) {
+    shadow_mode_->pause();
+  }
+
+  ROS_INFO("[Se3Controller]: activated%s", shadow ? " in the shadow mode" : "");
 
   is_active_ = true;
 
@@ -372,11 +750,20 @@ bool Se3Controller::activate(const mrs_msgs::AttitudeCommand::ConstPtr& last_att
 
 void Se3Controller::deactivate(void) {
 
+  CONTROLLER_TRACE1(deactivate, "Se3Controller");
+
   is_active_           = false;
   first_iteration_     = false;
   uav_mass_difference_ = 0;
 
+  resetAttitudeLoop();
+  resetRateLoop();
+
   ROS_INFO("[Se3Controller]: deactivated");
+
+  if (shadow_mode_) {
+    shadow_mode_->resume();
+  }
 }
 
 //}
@@ -389,15 +776,27 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
   mrs_lib::Routine    profiler_routine = profiler_.createRoutine("update");
   mrs_lib::ScopeTimer timer = mrs_lib::ScopeTimer("Se3Controller::update", common_handlers_->scope_timer.logger, common_handlers_->scope_timer.enabled);
 
-  {
-    std::scoped_lock lock(mutex_uav_state_);
+  // the copy of the shadow mode, without any output or record
+  const bool shadow = shadow_instance_;
 
-    uav_state_ = *uav_state;
-  }
+  common::UpdateTrace update_trace("Se3Controller");
+  common::CpuTimeScope cpu_time_scope(*health_, shadow ? common::CPU_BACKGROUND : common::CPU_UPDATE);
+
+  auto update_start = std::chrono::steady_clock::now();
+
+  boost::atomic_store(&uav_state_, uav_state);
 
   auto drs_params = mrs_lib::get_mutexed(mutex_drs_params_, drs_params_);
 
+  auto output_mode = mrs_lib::get_mutexed(mutex_output_mode_, output_mode_);
+
   if (!is_active_) {
+
+    // the same inputs as the active controller has in this iteration
+    if (shadow_mode_) {
+      shadow_mode_->addInputs(uav_state, control_reference);
+    }
+
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
 
@@ -405,9 +804,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
 
-  // | -------------------- calculate the dt -------------------- |
+  // the state predicted over the latency, the header stays in the measured message
+  const common::PredictedState_t state = state_predictor_->predict(*uav_state, ros::Time::now());
 
-  double dt;
+  // | -------------------- calculate the dt -------------------- |
 
   if (first_iteration_) {
 
@@ -418,16 +818,13 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     ROS_INFO("[Se3Controller]: first iteration");
 
     return mrs_msgs::AttitudeCommand::ConstPtr(new mrs_msgs::AttitudeCommand(activation_attitude_cmd_));
-
-  } else {
-
-    dt                = (uav_state->header.stamp - last_update_time_).toSec();
-    last_update_time_ = uav_state->header.stamp;
   }
 
-  if (fabs(dt) <= 0.001) {
+  std::optional<double> odometry_dt = common::odometryDt(uav_state->header.stamp, last_update_time_, _min_dt_);
 
-    ROS_DEBUG("[Se3Controller]: the last odometry message came too close (%.2f s)!", dt);
+  if (!odometry_dt) {
+
+    ROS_DEBUG("[Se3Controller]: the last odometry message came too close or out of order, skipping it");
 
     if (last_attitude_cmd_ != mrs_msgs::AttitudeCommand::Ptr()) {
 
@@ -439,17 +836,26 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
   }
 
+  double dt = odometry_dt.value();
+
+  flight_record_ = common::FlightRecord_t();
+
+  // at high rates, the transformer is queried only on every n-th update, the orientation of the UAV state is used in between
+  bool lookup_transforms = transform_decimator_.tick();
+
   // | ----------------- get the current heading ---------------- |
 
-  double uav_heading = 0;
+  std::optional<double> heading = common::getHeading(state.orientation.toRotationMatrix());
 
-  try {
-    uav_heading = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getHeading();
-  }
-  catch (...) {
-    ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not calculate the UAV heading");
+  if (heading) {
+    last_uav_heading_ = heading.value();
+  } else {
+    flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+    ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not calculate the UAV heading, using the last one");
   }
 
+  double uav_heading = last_uav_heading_;
+
   // --------------------------------------------------------------
   // |          load the control reference and estimates          |
   // --------------------------------------------------------------
@@ -503,14 +909,14 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   // Op - position in global frame
   // Ov - velocity in global frame
-  Eigen::Vector3d Op(uav_state->pose.position.x, uav_state->pose.position.y, uav_state->pose.position.z);
-  Eigen::Vector3d Ov(uav_state->velocity.linear.x, uav_state->velocity.linear.y, uav_state->velocity.linear.z);
+  Eigen::Vector3d Op = state.position;
+  Eigen::Vector3d Ov = state.velocity;
 
   // R - current uav attitude
-  Eigen::Matrix3d R = mrs_lib::AttitudeConverter(uav_state->pose.orientation);
+  Eigen::Matrix3d R = state.orientation.toRotationMatrix();
 
   // Ow - UAV angular rate
-  Eigen::Vector3d Ow(uav_state->velocity.angular.x, uav_state->velocity.angular.y, uav_state->velocity.angular.z);
+  Eigen::Vector3d Ow = state.attitude_rate;
 
   // | -------------- calculate the control errors -------------- |
 
@@ -590,7 +996,11 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   Eigen::Vector2d Ib_w = Eigen::Vector2d(0, 0);
 
-  {
+  if (!lookup_transforms) {
+
+    Ib_w = common::fromUntiltedFrame(Eigen::Vector3d(Ib_b_(0), Ib_b_(1), 0), uav_heading).head<2>();
+
+  } else {
 
     geometry_msgs::Vector3Stamped Ib_b_stamped;
 
@@ -600,7 +1010,9 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     Ib_b_stamped.vector.y        = Ib_b_(1);
     Ib_b_stamped.vector.z        = 0;
 
-    auto res = common_handlers_->transformer->transformSingle(Ib_b_stamped, uav_state_.header.frame_id);
+    CONTROLLER_TRACE1(transform_entry, "Se3Controller");
+    auto res = common_handlers_->transformer->transformSingle(Ib_b_stamped, uav_state->header.frame_id);
+    CONTROLLER_TRACE2(transform_exit, "Se3Controller", bool(res));
 
     if (res) {
       Ib_w[0] = res.value().vector.x;
@@ -626,6 +1038,19 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   Eigen::Vector3d f = position_feedback + velocity_feedback + integral_feedback + feed_forward;
 
+  if (flight_recorder_) {
+
+    flight_record_.dt = dt;
+
+    common::recordState(flight_record_, uav_state->header.stamp, state);
+    common::recordReference(flight_record_, *control_reference);
+
+    common::recordVector(flight_record_.feedforward, feed_forward);
+    common::recordVector(flight_record_.position_feedback, position_feedback);
+    common::recordVector(flight_record_.velocity_feedback, velocity_feedback);
+    common::recordVector(flight_record_.integral_feedback, integral_feedback);
+  }
+
   // | ----------- limiting the downwards acceleration ---------- |
   // the downwards force produced by the position and the acceleration feedback should not be larger than the gravity
 
@@ -650,10 +1075,13 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
     ROS_ERROR("[Se3Controller]: NaN detected in variable 'theta', returning null");
 
+    resetAttitudeLoop();
+
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
 
-  if (_tilt_angle_failsafe_enabled_ && theta > _tilt_angle_failsafe_) {
+  // the fully actuated UAV does not tilt to produce the force
+  if (output_mode != OUTPUT_FULLY_ACTUATED && _tilt_angle_failsafe_enabled_ && theta > _tilt_angle_failsafe_) {
 
     ROS_ERROR("[Se3Controller]: the produced tilt angle (%.2f deg) would be over the failsafe limit (%.2f deg), returning null", (180.0 / M_PI) * theta,
               (180.0 / M_PI) * _tilt_angle_failsafe_);
@@ -663,8 +1091,22 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     ROS_INFO("[Se3Controller]: integral feedback: [%.2f, %.2f, %.2f]", integral_feedback[0], integral_feedback[1], integral_feedback[2]);
     ROS_INFO("[Se3Controller]: position_cmd: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", control_reference->position.x, control_reference->position.y,
              control_reference->position.z, control_reference->heading);
-    ROS_INFO("[Se3Controller]: odometry: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", uav_state->pose.position.x, uav_state->pose.position.y,
-             uav_state->pose.position.z, uav_heading);
+    ROS_INFO("[Se3Controller]: odometry: x: %.2f, y: %.2f, z: %.2f, heading: %.2f", state.position[0], state.position[1],
+             state.position[2], uav_heading);
+
+    flight_record_.flags |= FLIGHT_RECORD_TILT_FAILSAFE | FLIGHT_RECORD_NULL_OUTPUT;
+
+    if (!shadow) {
+
+      if (flight_recorder_) {
+        flight_record_.theta = theta;
+        flight_recorder_->write(flight_record_);
+      }
+
+      health_->addUpdate(update_start, flight_record_.flags);
+    }
+
+    resetAttitudeLoop();
 
     return mrs_msgs::AttitudeCommand::ConstPtr();
   }
@@ -673,10 +1115,12 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
 
-  if (fabs(constraints.tilt) > 1e-3 && theta > constraints.tilt) {
+  if (output_mode != OUTPUT_FULLY_ACTUATED && fabs(constraints.tilt) > 1e-3 && theta > constraints.tilt) {
     ROS_WARN_THROTTLE(1.0, "[Se3Controller]: tilt is being saturated, desired: %.2f deg, saturated %.2f deg", (theta / M_PI) * 180.0,
                       (constraints.tilt / M_PI) * 180.0);
     theta = constraints.tilt;
+
+    flight_record_.flags |= FLIGHT_RECORD_TILT_SATURATED;
   }
 
   // reconstruct the vector
@@ -694,11 +1138,14 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     Rd = mrs_lib::AttitudeConverter(control_reference->orientation);
 
     if (control_reference->use_heading) {
-      try {
-        Rd = mrs_lib::AttitudeConverter(Rd).setHeading(control_reference->heading);
-      }
-      catch (...) {
-        ROS_ERROR("[Se3Controller]: could not set the desired heading");
+
+      std::optional<Eigen::Matrix3d> Rd_heading = common::setHeading(Rd, control_reference->heading);
+
+      if (Rd_heading) {
+        Rd = Rd_heading.value();
+      } else {
+        flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+        ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not set the desired heading, keeping the one of the desired orientation");
       }
     }
 
@@ -757,6 +1204,14 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
   }
 
+  // the fully actuated UAV keeps level, the attitude is tracked independently of the force
+  if (output_mode == OUTPUT_FULLY_ACTUATED && !control_reference->use_orientation) {
+
+    double desired_heading = control_reference->use_heading ? control_reference->heading : uav_heading;
+
+    Rd = mrs_lib::AttitudeConverter(0, 0, desired_heading);
+  }
+
   // --------------------------------------------------------------
   // |                      orientation error                     |
   // --------------------------------------------------------------
@@ -799,6 +1254,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
   } else if (thrust > _thrust_saturation_) {
 
     thrust = _thrust_saturation_;
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: saturating thrust to %.2f", _thrust_saturation_);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->position.x,
@@ -810,15 +1266,16 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: jerk [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->jerk.x, control_reference->jerk.y,
                       control_reference->jerk.z, control_reference->heading_jerk);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", uav_state->pose.position.x, uav_state->pose.position.y,
-                      uav_state->pose.position.z, uav_heading);
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", uav_state->velocity.linear.x,
-                      uav_state->velocity.linear.y, uav_state->velocity.linear.z, uav_state->velocity.angular.z);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", state.position[0], state.position[1],
+                      state.position[2], uav_heading);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", state.velocity[0],
+                      state.velocity[1], state.velocity[2], state.attitude_rate[2]);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
 
   } else if (thrust < 0.0) {
 
     thrust = 0.0;
+    flight_record_.flags |= FLIGHT_RECORD_THRUST_SATURATED;
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: saturating thrust to 0");
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->position.x,
@@ -830,10 +1287,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: desired state: jerk [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", control_reference->jerk.x, control_reference->jerk.y,
                       control_reference->jerk.z, control_reference->heading_jerk);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", uav_state->pose.position.x, uav_state->pose.position.y,
-                      uav_state->pose.position.z, uav_heading);
-    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", uav_state->velocity.linear.x,
-                      uav_state->velocity.linear.y, uav_state->velocity.linear.z, uav_state->velocity.angular.z);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: pos [x: %.2f, y: %.2f, z: %.2f, hdg: %.2f]", state.position[0], state.position[1],
+                      state.position[2], uav_heading);
+    ROS_WARN_THROTTLE(0.1, "[Se3Controller]: current state: vel [x: %.2f, y: %.2f, z: %.2f, yaw rate: %.2f]", state.velocity[0],
+                      state.velocity[1], state.velocity[2], state.attitude_rate[2]);
     ROS_WARN_THROTTLE(0.1, "[Se3Controller]: ---------------------------");
   }
 
@@ -845,27 +1302,57 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
   } else if (control_reference->use_heading_rate) {
 
     // to fill in the feed forward yaw rate
-    double desired_yaw_rate = 0;
+    std::optional<double> desired_yaw_rate = common::getYawRateIntrinsic(Rd, control_reference->heading_rate);
 
-    try {
-      desired_yaw_rate = mrs_lib::AttitudeConverter(Rd).getYawRateIntrinsic(control_reference->heading_rate);
-    }
-    catch (...) {
-      ROS_ERROR("[Se3Controller]: exception caught while calculating the desired_yaw_rate feedforward");
+    if (!desired_yaw_rate) {
+      flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+      ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not calculate the desired_yaw_rate feedforward, skipping it");
     }
 
-    Rw << 0, 0, desired_yaw_rate;
+    Rw << 0, 0, desired_yaw_rate.value_or(0.0);
   }
 
-  // feedforward angular acceleration
-  Eigen::Vector3d q_feedforward = Eigen::Vector3d(0, 0, 0);
+  // | ---------------- differential flatness feedforward ---------------- |
+
+  // the attitude rate and the angular acceleration of the desired orientation given by the jerk, snap and heading derivatives
+  Eigen::Vector3d q_feedforward                = Eigen::Vector3d(0, 0, 0);
+  Eigen::Vector3d angular_acceleration_forward = Eigen::Vector3d(0, 0, 0);
+  bool            flatness_feedforward         = false;
+
+  if (drs_params.jerk_feedforward && !control_reference->use_orientation && !control_reference->use_attitude_rate && output_mode != OUTPUT_FULLY_ACTUATED) {
+
+    common::FlatReference_t flat_reference;
 
-  if (drs_params.jerk_feedforward) {
+    flat_reference.jerk = Eigen::Vector3d(control_reference->jerk.x, control_reference->jerk.y, control_reference->jerk.z);
+    flat_reference.snap = Eigen::Vector3d(control_reference->snap.x, control_reference->snap.y, control_reference->snap.z);
 
-    Eigen::Matrix3d I;
-    I << 0, 1, 0, -1, 0, 0, 0, 0, 0;
-    Eigen::Vector3d desired_jerk = Eigen::Vector3d(control_reference->jerk.x, control_reference->jerk.y, control_reference->jerk.z);
-    q_feedforward                = (I.transpose() * Rd.transpose() * desired_jerk) / (thrust_force / total_mass);
+    // the heading which was used to construct Rd
+    flat_reference.heading              = control_reference->use_heading ? control_reference->heading : uav_heading;
+    flat_reference.heading_rate         = control_reference->use_heading_rate ? control_reference->heading_rate : 0;
+    flat_reference.heading_acceleration = control_reference->use_heading_rate ? control_reference->heading_acceleration : 0;
+
+    // the collective acceleration along the desired body z
+    double c = f.dot(Rd.col(2)) / total_mass;
+
+    common::FlatnessFeedforward_t feedforward;
+
+    if (drs_params.rotation_type == common::ROTATION_LEE) {
+      flatness_feedforward = common::flatnessFeedforward<common::ROTATION_LEE>(Rd, c, flat_reference, feedforward);
+    } else {
+      flatness_feedforward = common::flatnessFeedforward<common::ROTATION_BACA>(Rd, c, flat_reference, feedforward);
+    }
+
+    if (flatness_feedforward) {
+
+      q_feedforward                = feedforward.attitude_rate;
+      angular_acceleration_forward = feedforward.angular_acceleration;
+
+      // the yaw rate feedforward already contains the heading rate
+      Rw[2] = 0;
+
+    } else {
+      ROS_WARN_THROTTLE(1.0, "[Se3Controller]: the flatness feedforward is singular, skipping it");
+    }
   }
 
   // angular feedback + angular rate feedforward
@@ -879,20 +1366,23 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     Eigen::Vector3d q_feedback_yawless = t;
     q_feedback_yawless(2)              = 0;  // nullyfy the effect of the original yaw feedback
 
-    double parasitic_heading_rate = 0;
-
-    try {
-      parasitic_heading_rate = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getHeadingRate(q_feedback_yawless);
-    }
-    catch (...) {
-      ROS_ERROR("[Se3Controller]: exception caught while calculating the parasitic heading rate!");
+    // the flatness yaw rate already accounts for the pitch and roll rate of the feedforward
+    if (flatness_feedforward) {
+      q_feedback_yawless.head(2) -= q_feedforward.head(2);
     }
 
-    try {
-      rp_heading_rate_compensation(2) = mrs_lib::AttitudeConverter(uav_state->pose.orientation).getYawRateIntrinsic(-parasitic_heading_rate);
+    std::optional<double> parasitic_heading_rate = common::getHeadingRate(R, q_feedback_yawless);
+    std::optional<double> compensation;
+
+    if (parasitic_heading_rate) {
+      compensation = common::getYawRateIntrinsic(R, -parasitic_heading_rate.value());
     }
-    catch (...) {
-      ROS_ERROR("[Se3Controller]: exception caught while calculating the parasitic heading rate compensation!");
+
+    if (compensation) {
+      rp_heading_rate_compensation(2) = compensation.value();
+    } else {
+      flight_record_.flags |= FLIGHT_RECORD_ATTITUDE_SINGULAR;
+      ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not calculate the parasitic heading rate compensation, skipping it");
     }
   }
 
@@ -934,6 +1424,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     if (kiwxy_lim_ >= 0 && world_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[Se3Controller]: SE3's world X integral is being saturated!");
     }
 
@@ -951,6 +1442,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     if (kiwxy_lim_ >= 0 && world_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[Se3Controller]: SE3's world Y integral is being saturated!");
     }
   }
@@ -970,17 +1462,23 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     Eigen::Vector2d Ev_fcu_untilted = Eigen::Vector2d(0, 0);  // velocity error in the untilted frame of the UAV
 
     // get the position control error in the fcu_untilted frame
-    {
+    if (!lookup_transforms) {
+
+      Ep_fcu_untilted = common::toUntiltedFrame(Ep, uav_heading).head<2>();
+
+    } else {
 
       geometry_msgs::Vector3Stamped Ep_stamped;
 
       Ep_stamped.header.stamp    = ros::Time::now();
-      Ep_stamped.header.frame_id = uav_state_.header.frame_id;
+      Ep_stamped.header.frame_id = uav_state->header.frame_id;
       Ep_stamped.vector.x        = Ep(0);
       Ep_stamped.vector.y        = Ep(1);
       Ep_stamped.vector.z        = Ep(2);
 
+      CONTROLLER_TRACE1(transform_entry, "Se3Controller");
       auto res = common_handlers_->transformer->transformSingle(Ep_stamped, "fcu_untilted");
+      CONTROLLER_TRACE2(transform_exit, "Se3Controller", bool(res));
 
       if (res) {
         Ep_fcu_untilted[0] = res.value().vector.x;
@@ -991,20 +1489,27 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     // get the velocity control error in the fcu_untilted frame
-    {
+    if (!lookup_transforms) {
+
+      Ev_fcu_untilted = common::toUntiltedFrame(Ev, uav_heading).head<2>();
+
+    } else {
+
       geometry_msgs::Vector3Stamped Ev_stamped;
 
       Ev_stamped.header.stamp    = ros::Time::now();
-      Ev_stamped.header.frame_id = uav_state_.header.frame_id;
+      Ev_stamped.header.frame_id = uav_state->header.frame_id;
       Ev_stamped.vector.x        = Ev(0);
       Ev_stamped.vector.y        = Ev(1);
       Ev_stamped.vector.z        = Ev(2);
 
+      CONTROLLER_TRACE1(transform_entry, "Se3Controller");
       auto res = common_handlers_->transformer->transformSingle(Ev_stamped, "fcu_untilted");
+      CONTROLLER_TRACE2(transform_exit, "Se3Controller", bool(res));
 
       if (res) {
         Ev_fcu_untilted[0] = res.value().vector.x;
-        Ev_fcu_untilted[1] = res.value().vector.x;
+        Ev_fcu_untilted[1] = res.value().vector.y;
       } else {
         ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: could not transform the velocity error to fcu_untilted");
       }
@@ -1031,6 +1536,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     if (kibxy_lim_ > 0 && body_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[Se3Controller]: SE3's body pitch integral is being saturated!");
     }
 
@@ -1048,6 +1554,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     if (kibxy_lim_ > 0 && body_integral_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[Se3Controller]: SE3's body roll integral is being saturated!");
     }
   }
@@ -1081,6 +1588,7 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     }
 
     if (uav_mass_saturated) {
+      flight_record_.flags |= FLIGHT_RECORD_INTEGRAL_SATURATED;
       ROS_WARN_THROTTLE(1.0, "[Se3Controller]: The UAV mass difference is being saturated to %.2f!", uav_mass_difference_);
     }
   }
@@ -1100,6 +1608,8 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
   double desired_y_accel = 0;
   double desired_z_accel = 0;
 
+  Eigen::Vector3d world_accel_cmd;
+
   {
 
     Eigen::Matrix3d des_orientation = mrs_lib::AttitudeConverter(Rd);
@@ -1109,21 +1619,36 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     double world_accel_y = (thrust_vector[1] / total_mass) - (Iw_w_[1] / total_mass) - (Ib_w[1] / total_mass);
     double world_accel_z = (thrust_vector[2] / total_mass) - common_handlers_->g;
 
-    geometry_msgs::Vector3Stamped world_accel;
+    world_accel_cmd << world_accel_x, world_accel_y, world_accel_z;
 
-    world_accel.header.stamp    = ros::Time::now();
-    world_accel.header.frame_id = uav_state->header.frame_id;
-    world_accel.vector.x        = world_accel_x;
-    world_accel.vector.y        = world_accel_y;
-    world_accel.vector.z        = world_accel_z;
+    if (!lookup_transforms) {
 
-    auto res = common_handlers_->transformer->transformSingle(world_accel, "fcu");
+      Eigen::Vector3d body_accel = R.transpose() * world_accel_cmd;
 
-    if (res) {
+      desired_x_accel = body_accel[0];
+      desired_y_accel = body_accel[1];
+      desired_z_accel = body_accel[2];
+
+    } else {
+
+      geometry_msgs::Vector3Stamped world_accel;
 
-      desired_x_accel = res.value().vector.x;
-      desired_y_accel = res.value().vector.y;
-      desired_z_accel = res.value().vector.z;
+      world_accel.header.stamp    = ros::Time::now();
+      world_accel.header.frame_id = uav_state->header.frame_id;
+      world_accel.vector.x        = world_accel_x;
+      world_accel.vector.y        = world_accel_y;
+      world_accel.vector.z        = world_accel_z;
+
+      CONTROLLER_TRACE1(transform_entry, "Se3Controller");
+      auto res = common_handlers_->transformer->transformSingle(world_accel, "fcu");
+      CONTROLLER_TRACE2(transform_exit, "Se3Controller", bool(res));
+
+      if (res) {
+
+        desired_x_accel = res.value().vector.x;
+        desired_y_accel = res.value().vector.y;
+        desired_z_accel = res.value().vector.z;
+      }
     }
   }
 
@@ -1133,6 +1658,10 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
     auto constraints = mrs_lib::get_mutexed(mutex_constraints_, constraints_);
 
+    if (fabs(t[0]) > constraints.roll_rate || fabs(t[1]) > constraints.pitch_rate || fabs(t[2]) > constraints.yaw_rate) {
+      flight_record_.flags |= FLIGHT_RECORD_RATE_SATURATED;
+    }
+
     if (t[0] > constraints.roll_rate) {
       t[0] = constraints.roll_rate;
     } else if (t[0] < -constraints.roll_rate) {
@@ -1156,8 +1685,6 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   // | --------------- fill the resulting command --------------- |
 
-  auto output_mode = mrs_lib::get_mutexed(mutex_output_mode_, output_mode_);
-
   // fill in the desired attitude anyway, since we know it
   output_command->attitude = mrs_lib::AttitudeConverter(Rd);
 
@@ -1175,6 +1702,15 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
     output_command->mode_mask = output_command->MODE_ATTITUDE;
 
     ROS_WARN_THROTTLE(1.0, "[Se3Controller]: outputting desired orientation (this is not normal)");
+
+  } else if (output_mode == OUTPUT_TORQUE || output_mode == OUTPUT_FULLY_ACTUATED) {
+
+    // the rate loop on the IMU takes this over, the control manager forwards it to the autopilot when the loop is not running
+    output_command->attitude_rate.x = t[0];
+    output_command->attitude_rate.y = t[1];
+    output_command->attitude_rate.z = t[2];
+
+    output_command->mode_mask = output_command->MODE_ATTITUDE_RATE;
   }
 
   output_command->desired_acceleration.x = desired_x_accel;
@@ -1226,6 +1762,137 @@ const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::update(const mrs_msgs::
 
   output_command->controller = "Se3Controller";
 
+  // | ------------ remember the command for the prediction ------------ |
+
+  state_predictor_->addCommand(output_command->header.stamp, world_accel_cmd, t);
+
+  // | -------------- hand over to the attitude loop -------------- |
+
+  if (_attitude_loop_enabled_ && !shadow) {
+
+    auto [imu_orientation, imu_stamp] = mrs_lib::get_mutexed(mutex_attitude_loop_, imu_orientation_, imu_stamp_);
+
+    bool imu_fresh = !imu_stamp.isZero() && (ros::Time::now() - imu_stamp).toSec() < _attitude_loop_max_age_;
+
+    // otherwise, the control manager would keep publishing the setpoints of update() to the autopilot as well
+    bool manager_routed = subscriber_manager_output_.getNumPublishers() > 0;
+
+    if (!manager_routed) {
+      ROS_WARN_THROTTLE(5.0, "[Se3Controller]: the output of the control manager is not remapped to '%s', the attitude loop stays off",
+                        subscriber_manager_output_.getTopic().c_str());
+    }
+
+    // the IMU-rate loop takes over only the tracking of Rd, the rest keeps the rate of the odometry
+    if (output_mode == OUTPUT_ATTITUDE_RATE && !control_reference->use_attitude_rate && !rampup_active_ && imu_fresh && manager_routed) {
+
+      AttitudeLoopSetpoint_t setpoint;
+
+      setpoint.valid = true;
+      setpoint.stamp = ros::Time::now();
+      setpoint.Rd    = Rd;
+
+      // the odometry and the autopilot may estimate the orientation differently, mostly the heading
+      setpoint.R_alignment = R * imu_orientation.transpose();
+
+      setpoint.Kq                        = Kq;
+      setpoint.rate_feedforward          = Rw + q_feedforward;
+      setpoint.flatness_feedforward      = flatness_feedforward ? q_feedforward : Eigen::Vector3d::Zero();
+      setpoint.heading_rate_compensation = drs_params.pitch_roll_heading_rate_compensation;
+      setpoint.thrust                    = output_command->thrust;
+
+      if (got_constraints_) {
+        setpoint.rate_limit << constraints.roll_rate, constraints.pitch_rate, constraints.yaw_rate;
+      } else {
+        setpoint.rate_limit.setConstant(std::numeric_limits<double>::infinity());
+      }
+
+      mrs_lib::set_mutexed(mutex_attitude_loop_, setpoint, attitude_loop_setpoint_);
+
+    } else {
+
+      resetAttitudeLoop();
+    }
+  }
+
+  // | ---------------- hand over to the rate loop ---------------- |
+
+  if ((output_mode == OUTPUT_TORQUE || output_mode == OUTPUT_FULLY_ACTUATED) && !shadow) {
+
+    ros::Time imu_stamp = mrs_lib::get_mutexed(mutex_attitude_loop_, imu_stamp_);
+
+    bool imu_fresh = !imu_stamp.isZero() && (ros::Time::now() - imu_stamp).toSec() < _attitude_loop_max_age_;
+
+    // otherwise, the control manager would keep publishing the attitude rate to the autopilot as well
+    bool manager_routed = subscriber_manager_output_.getNumPublishers() > 0;
+
+    if (!imu_fresh) {
+      ROS_WARN_THROTTLE(1.0, "[Se3Controller]: no IMU on '%s', the attitude rate goes to the autopilot instead of the torque",
+                        subscriber_imu_.getTopic().c_str());
+    } else if (!manager_routed) {
+      ROS_WARN_THROTTLE(5.0, "[Se3Controller]: the output of the control manager is not remapped to '%s', the attitude rate goes to the autopilot",
+                        subscriber_manager_output_.getTopic().c_str());
+    }
+
+    if (imu_fresh && manager_routed) {
+
+      RateLoopSetpoint_t setpoint;
+
+      setpoint.valid                = true;
+      setpoint.stamp                = ros::Time::now();
+      setpoint.output_mode          = output_mode;
+      setpoint.rate                 = t;
+      setpoint.flatness_feedforward = flatness_feedforward;
+      setpoint.angular_acceleration = angular_acceleration_forward;
+      setpoint.thrust               = output_command->thrust;
+      setpoint.collective_force     = mrs_lib::quadratic_thrust_model::thrustToForce(common_handlers_->motor_params, output_command->thrust);
+
+      // the desired force in the body frame, the body z is the (saturated and ramped-up) thrust
+      setpoint.body_force    = R.transpose() * f;
+      setpoint.body_force[2] = setpoint.collective_force;
+
+      std::scoped_lock lock(mutex_rate_loop_);
+
+      // the rate controller starts over when the loop was stopped
+      if (!rate_loop_setpoint_.valid) {
+        rate_controller_->reset();
+        rate_loop_imu_stamp_ = ros::Time(0);
+      }
+
+      rate_loop_setpoint_ = setpoint;
+
+    } else {
+
+      resetRateLoop();
+    }
+
+  } else if (!shadow) {
+
+    resetRateLoop();
+  }
+
+  // | -------------------- record the update ------------------- |
+
+  if (rampup_active_) {
+    flight_record_.flags |= FLIGHT_RECORD_RAMPUP;
+  }
+
+  if (flight_recorder_ && !shadow) {
+
+    flight_record_.theta        = theta;
+    flight_record_.thrust_force = thrust_force;
+
+    common::recordVector(flight_record_.attitude_error, Eq);
+    common::recordVector(flight_record_.attitude_rate_feedforward, Rw + q_feedforward);
+    common::recordOutput(flight_record_, *output_command);
+
+    flight_recorder_->write(flight_record_);
+  }
+
+  if (!shadow) {
+    health_->setEstimate(0, uav_mass_difference_);
+    health_->addUpdate(update_start, flight_record_.flags);
+  }
+
   last_attitude_cmd_ = output_command;
 
   return output_command;
@@ -1250,22 +1917,39 @@ const mrs_msgs::ControllerStatus Se3Controller::getStatus() {
 
 void Se3Controller::switchOdometrySource(const mrs_msgs::UavState::ConstPtr& new_uav_state) {
 
+  CONTROLLER_TRACE2(switch_odometry_source, "Se3Controller", new_uav_state->header.frame_id.c_str());
+
   ROS_INFO("[Se3Controller]: switching the odometry source");
 
-  auto uav_state = mrs_lib::get_mutexed(mutex_uav_state_, uav_state_);
+  // the frame of the stored integrals, empty before the first update
+  auto        uav_state = boost::atomic_load(&uav_state_);
+  std::string frame_id  = uav_state ? uav_state->header.frame_id : "";
+
+  // the stored commands are expressed in the old frame
+  state_predictor_->reset();
+
+  // so is Rd, the attitude loop waits for the next update()
+  resetAttitudeLoop();
+
+  // so is the state of the copy, it starts over from the next active output
+  if (shadow_mode_ && !is_active_) {
+    shadow_mode_->resume();
+  }
 
   // | ----- transform world disturabances to the new frame ----- |
 
   geometry_msgs::Vector3Stamped world_integrals;
 
   world_integrals.header.stamp    = ros::Time::now();
-  world_integrals.header.frame_id = uav_state.header.frame_id;
+  world_integrals.header.frame_id = frame_id;
 
   world_integrals.vector.x = Iw_w_[0];
   world_integrals.vector.y = Iw_w_[1];
   world_integrals.vector.z = 0;
 
+  CONTROLLER_TRACE1(transform_entry, "Se3Controller");
   auto res = common_handlers_->transformer->transformSingle(world_integrals, new_uav_state->header.frame_id);
+  CONTROLLER_TRACE2(transform_exit, "Se3Controller", bool(res));
 
   if (res) {
 
@@ -1299,11 +1983,155 @@ void Se3Controller::resetDisturbanceEstimators(void) {
 
 //}
 
+/* updateRateLoop() //{ */
+
+void Se3Controller::updateRateLoop(const sensor_msgs::Imu& imu) {
+
+  std::scoped_lock lock(mutex_rate_loop_);
+
+  if (!is_active_ || !rate_loop_setpoint_.valid) {
+    return;
+  }
+
+  const RateLoopSetpoint_t& setpoint = rate_loop_setpoint_;
+
+  if ((ros::Time::now() - setpoint.stamp).toSec() > _attitude_loop_max_age_) {
+
+    ROS_WARN_THROTTLE(1.0, "[Se3Controller]: the position loop has not updated the rate loop for %.3f s", (ros::Time::now() - setpoint.stamp).toSec());
+    return;
+  }
+
+  // the period of the gyro, 0 on the first message resets the derivative of the desired rate
+  double dt = rate_loop_imu_stamp_.isZero() ? 0.0 : (imu.header.stamp - rate_loop_imu_stamp_).toSec();
+
+  rate_loop_imu_stamp_ = imu.header.stamp;
+
+  Eigen::Vector3d rate(imu.angular_velocity.x, imu.angular_velocity.y, imu.angular_velocity.z);
+
+  if (!rate.allFinite()) {
+    ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: the angular velocity from the IMU is not finite");
+    return;
+  }
+
+  Eigen::Vector3d torque;
+
+  if (setpoint.flatness_feedforward) {
+    torque = rate_controller_->update(setpoint.rate, rate, dt, setpoint.angular_acceleration);
+  } else {
+    torque = rate_controller_->update(setpoint.rate, rate, dt);
+  }
+
+  mavros_msgs::ActuatorControl actuator_control;
+
+  actuator_control.header.stamp = imu.header.stamp;
+
+  bool motors_saturated = false;
+
+  if (setpoint.output_mode == OUTPUT_FULLY_ACTUATED) {
+
+    motors_saturated = full_allocation_->mix(setpoint.body_force, torque, throttles_);
+
+  } else if (control_allocation_) {
+
+    motors_saturated = control_allocation_->mix(setpoint.collective_force, torque, throttles_);
+  }
+
+  if (motors_saturated) {
+    ROS_WARN_THROTTLE(1.0, "[Se3Controller]: the motor throttles are being saturated");
+  }
+
+  if (setpoint.output_mode == OUTPUT_FULLY_ACTUATED || control_allocation_) {
+
+    actuator_control.group_mix = _mixer_group_;
+
+    // the direct outputs of the autopilot take [-1, 1]
+    for (int i = 0; i < throttles_.size(); i++) {
+      actuator_control.controls[i] = 2.0 * throttles_[i] - 1.0;
+    }
+
+  } else {
+
+    actuator_control.group_mix = mavros_msgs::ActuatorControl::PX4_MIX_FLIGHT_CONTROL;
+
+    for (int i = 0; i < 3; i++) {
+      actuator_control.controls[i] = std::clamp(torque[i] / _max_torque_[i], -1.0, 1.0);
+    }
+
+    actuator_control.controls[3] = setpoint.thrust;
+  }
+
+  try {
+    publisher_actuator_control_.publish(actuator_control);
+  }
+  catch (...) {
+    ROS_ERROR("[Se3Controller]: exception caught during publishing topic '%s'", publisher_actuator_control_.getTopic().c_str());
+  }
+
+  mrs_lib::set_mutexed(mutex_attitude_loop_, ros::Time::now(), imu_loop_output_time_);
+}
+
+//}
+
+/* resetRateLoop() //{ */
+
+void Se3Controller::resetRateLoop(void) {
+
+  {
+    std::scoped_lock lock(mutex_rate_loop_);
+
+    // skip the lock of the attitude loop, unless the rate loop was running
+    if (!rate_loop_setpoint_.valid) {
+      return;
+    }
+
+    rate_loop_setpoint_.valid = false;
+  }
+
+  // the setpoints of the control manager go to the autopilot again
+  mrs_lib::set_mutexed(mutex_attitude_loop_, ros::Time(0), imu_loop_output_time_);
+}
+
+//}
+
+/* resetAttitudeLoop() //{ */
+
+void Se3Controller::resetAttitudeLoop(void) {
+
+  std::scoped_lock lock(mutex_attitude_loop_);
+
+  // the setpoints of the control manager go to the autopilot again, unless the rate loop is the one running
+  if (attitude_loop_setpoint_.valid) {
+    imu_loop_output_time_ = ros::Time(0);
+  }
+
+  attitude_loop_setpoint_.valid = false;
+}
+
+//}
+
+/* updateShadow() //{ */
+
+const mrs_msgs::AttitudeCommand::ConstPtr Se3Controller::updateShadow(const common::ShadowFrame_t& frame) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+  // the copy starts as if the control manager switched to it, from the output of the active controller
+  if (frame.restart && !shadow_controller_->activate(frame.active_output)) {
+    return mrs_msgs::AttitudeCommand::ConstPtr();
+  }
+
+  return shadow_controller_->update(frame.uav_state, frame.control_reference);
+}
+
+//}
+
 /* setConstraints() //{ */
 
 const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr Se3Controller::setConstraints([
     [maybe_unused]] const mrs_msgs::DynamicsConstraintsSrvRequest::ConstPtr& constraints) {
 
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SERVICE);
+
   if (!is_initialized_) {
     return mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr(new mrs_msgs::DynamicsConstraintsSrvResponse());
   }
@@ -1312,6 +2140,10 @@ const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr Se3Controller::setConst
 
   got_constraints_ = true;
 
+  if (shadow_controller_) {
+    shadow_controller_->setConstraints(constraints);
+  }
+
   ROS_INFO("[Se3Controller]: updating constraints");
 
   mrs_msgs::DynamicsConstraintsSrvResponse res;
@@ -1331,12 +2163,40 @@ const mrs_msgs::DynamicsConstraintsSrvResponse::ConstPtr Se3Controller::setConst
 
 void Se3Controller::callbackDrs(mrs_uav_controllers::se3_controllerConfig& config, [[maybe_unused]] uint32_t level) {
 
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_DRS);
+
   {
     std::scoped_lock lock(mutex_drs_params_, mutex_output_mode_);
 
     drs_params_ = config;
 
+    // the gains from the user supersede a pending echo of the filtered ones, also the one filterGains()
+    // is building right now from the previous params, it is stamped with the previous sequence
+    {
+      std::scoped_lock lock_write_back(mutex_drs_write_back_);
+
+      drs_sequence_++;
+      drs_write_back_pending_ = false;
+    }
+
     output_mode_ = config.output_mode;
+
+    if (output_mode_ == OUTPUT_FULLY_ACTUATED && !full_allocation_) {
+
+      ROS_WARN("[Se3Controller]: the fully actuated output needs fully_actuated/enabled = true, keeping the attitude rate output");
+
+      output_mode_            = OUTPUT_ATTITUDE_RATE;
+      drs_params_.output_mode = OUTPUT_ATTITUDE_RATE;
+    }
+
+    // the copy of the shadow mode has no drs of its own
+    if (shadow_controller_) {
+
+      std::scoped_lock lock_shadow(shadow_controller_->mutex_drs_params_, shadow_controller_->mutex_output_mode_);
+
+      shadow_controller_->drs_params_  = drs_params_;
+      shadow_controller_->output_mode_ = output_mode_;
+    }
   }
 
   ROS_INFO("[Se3Controller]: DRS updated gains");
@@ -1344,6 +2204,179 @@ void Se3Controller::callbackDrs(mrs_uav_controllers::se3_controllerConfig& confi
 
 //}
 
+/* callbackImu() //{ */
+
+void Se3Controller::callbackImu(const sensor_msgs::Imu::ConstPtr& msg) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SUBSCRIBER);
+
+  Eigen::Quaterniond q_imu(msg->orientation.w, msg->orientation.x, msg->orientation.y, msg->orientation.z);
+
+  if (!(fabs(q_imu.squaredNorm() - 1.0) < 1e-3)) {
+    ROS_ERROR_THROTTLE(1.0, "[Se3Controller]: the orientation from the IMU is not a unit quaternion");
+    return;
+  }
+
+  Eigen::Matrix3d R_imu = q_imu.normalized().toRotationMatrix();
+
+  AttitudeLoopSetpoint_t setpoint;
+
+  {
+    std::scoped_lock lock(mutex_attitude_loop_);
+
+    imu_orientation_ = R_imu;
+    imu_stamp_       = ros::Time::now();
+
+    setpoint = attitude_loop_setpoint_;
+  }
+
+  // the torque output modes, the attitude loop is off then
+  updateRateLoop(*msg);
+
+  if (!is_active_ || !setpoint.valid) {
+    CONTROLLER_TRACE2(attitude_loop, "Se3Controller", false);
+    return;
+  }
+
+  if ((ros::Time::now() - setpoint.stamp).toSec() > _attitude_loop_max_age_) {
+
+    ROS_WARN_THROTTLE(1.0, "[Se3Controller]: the position loop has not updated the attitude loop for %.3f s", (ros::Time::now() - setpoint.stamp).toSec());
+
+    CONTROLLER_TRACE2(attitude_loop, "Se3Controller", false);
+    return;
+  }
+
+  // the orientation from the IMU expressed in the frame of the odometry
+  Eigen::Matrix3d R = setpoint.R_alignment * R_imu;
+
+  // the same attitude feedback as in update()
+  Eigen::Matrix3d E = 0.5 * (setpoint.Rd.transpose() * R - R.transpose() * setpoint.Rd);
+
+  Eigen::Vector3d Eq;
+
+  // clang-format off
+  Eq << (E(2, 1) - E(1, 2)) / 2.0,
+        (E(0, 2) - E(2, 0)) / 2.0,
+        (E(1, 0) - E(0, 1)) / 2.0;
+  // clang-format on
+
+  Eigen::Vector3d q_feedback = -setpoint.Kq * Eq.array();
+
+  Eigen::Vector3d t = q_feedback + setpoint.rate_feedforward;
+
+  if (setpoint.heading_rate_compensation) {
+
+    Eigen::Vector3d q_feedback_yawless = t;
+    q_feedback_yawless(2)              = 0;
+    q_feedback_yawless.head(2) -= setpoint.flatness_feedforward.head(2);
+
+    std::optional<double> parasitic_heading_rate = common::getHeadingRate(R, q_feedback_yawless);
+    std::optional<double> compensation;
+
+    if (parasitic_heading_rate) {
+      compensation = common::getYawRateIntrinsic(R, -parasitic_heading_rate.value());
+    }
+
+    t(2) += compensation.value_or(0.0);
+  }
+
+  t = t.cwiseMax(-setpoint.rate_limit).cwiseMin(setpoint.rate_limit);
+
+  mavros_msgs::AttitudeTarget attitude_target;
+
+  attitude_target.header.stamp = msg->header.stamp;
+  attitude_target.type_mask    = mavros_msgs::AttitudeTarget::IGNORE_ATTITUDE;
+  attitude_target.orientation  = mrs_lib::AttitudeConverter(setpoint.Rd);
+  attitude_target.body_rate.x  = t[0];
+  attitude_target.body_rate.y  = t[1];
+  attitude_target.body_rate.z  = t[2];
+  attitude_target.thrust       = setpoint.thrust;
+
+  try {
+    publisher_attitude_target_.publish(attitude_target);
+  }
+  catch (...) {
+    ROS_ERROR("[Se3Controller]: exception caught during publishing topic '%s'", publisher_attitude_target_.getTopic().c_str());
+  }
+
+  {
+    std::scoped_lock lock(mutex_attitude_loop_);
+
+    // unless the loop was stopped meanwhile
+    if (attitude_loop_setpoint_.valid) {
+      imu_loop_output_time_ = ros::Time::now();
+    }
+  }
+
+  CONTROLLER_TRACE2(attitude_loop, "Se3Controller", true);
+}
+
+//}
+
+/* callbackManagerOutput() //{ */
+
+void Se3Controller::callbackManagerOutput(const mavros_msgs::AttitudeTarget::ConstPtr& msg) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_SUBSCRIBER);
+
+  bool attitude_loop_publishing;
+
+  {
+    std::scoped_lock lock(mutex_attitude_loop_);
+
+    attitude_loop_publishing = is_active_ && !imu_loop_output_time_.isZero() &&
+                               (ros::Time::now() - imu_loop_output_time_).toSec() < _attitude_loop_max_age_;
+  }
+
+  // the same setpoint at the rate of the odometry, the autopilot takes the one of the attitude loop
+  if (attitude_loop_publishing) {
+    return;
+  }
+
+  try {
+    publisher_attitude_target_.publish(msg);
+  }
+  catch (...) {
+    ROS_ERROR("[Se3Controller]: exception caught during publishing topic '%s'", publisher_attitude_target_.getTopic().c_str());
+  }
+}
+
+//}
+
+/* timerDrsWriteBack() //{ */
+
+void Se3Controller::timerDrsWriteBack([[maybe_unused]] const ros::TimerEvent& event) {
+
+  common::CpuTimeScope cpu_time_scope(*health_, common::CPU_BACKGROUND);
+
+  // the drs server holds its mutex while in callbackDrs(), so no new params can come between the check and the publish
+  boost::recursive_mutex::scoped_lock lock_drs(mutex_drs_);
+
+  DrsConfig_t params;
+
+  {
+    std::scoped_lock lock(mutex_drs_write_back_);
+
+    if (!drs_write_back_pending_) {
+      return;
+    }
+
+    drs_write_back_pending_ = false;
+
+    // built from the params which callbackDrs() has replaced since
+    if (drs_write_back_sequence_ != drs_sequence_) {
+      return;
+    }
+
+    params = drs_write_back_;
+  }
+
+  // publishes, the drs mutex is recursive
+  drs_->updateConfig(params);
+}
+
+//}
+
 // --------------------------------------------------------------
 // |                       other routines                       |
 // --------------------------------------------------------------
@@ -1403,7 +2436,11 @@ void Se3Controller::filterGains(const bool mute_gains, const double dt) {
       new_drs_params.km_lim      = km_lim_;
       new_drs_params.output_mode = output_mode_;
 
-      drs_->updateConfig(new_drs_params);
+      std::scoped_lock lock_write_back(mutex_drs_write_back_);
+
+      drs_write_back_          = new_drs_params;
+      drs_write_back_pending_  = true;
+      drs_write_back_sequence_ = drs_sequence_;
     }
   }
 }
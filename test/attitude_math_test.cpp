@@ -0,0 +1,147 @@
+#include <mrs_uav_controllers/common/attitude_math.h>
+
+#include <mrs_lib/attitude_converter.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace mrs_uav_controllers;
+
+/* randomAttitudes() //{ */
+
+// the roll and pitch within +-0.8 rad, away from the singular attitudes
+std::vector<Eigen::Matrix3d> randomAttitudes(const int n) {
+
+  std::mt19937                           generator(42);
+  std::uniform_real_distribution<double> tilt(-0.8, 0.8);
+  std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+
+  std::vector<Eigen::Matrix3d> attitudes;
+
+  for (int i = 0; i < n; i++) {
+
+    const double roll  = tilt(generator);
+    const double pitch = tilt(generator);
+    const double yaw   = heading(generator);
+
+    attitudes.push_back(Eigen::Matrix3d(mrs_lib::AttitudeConverter(roll, pitch, yaw)));
+  }
+
+  return attitudes;
+}
+
+//}
+
+/* angleDifference() //{ */
+
+double angleDifference(const double a, const double b) {
+  return fabs(atan2(sin(a - b), cos(a - b)));
+}
+
+//}
+
+// | ------------------- against mrs_lib ------------------- |
+
+TEST(AttitudeMath, getHeading) {
+
+  for (const auto& R : randomAttitudes(1000)) {
+
+    std::optional<double> heading = common::getHeading(R);
+
+    ASSERT_TRUE(heading);
+    EXPECT_LT(angleDifference(heading.value(), mrs_lib::AttitudeConverter(R).getHeading()), 1e-9);
+  }
+}
+
+TEST(AttitudeMath, getHeadingRate) {
+
+  std::mt19937                           generator(43);
+  std::uniform_real_distribution<double> rate(-3.0, 3.0);
+
+  for (const auto& R : randomAttitudes(1000)) {
+
+    const Eigen::Vector3d attitude_rate(rate(generator), rate(generator), rate(generator));
+
+    std::optional<double> heading_rate = common::getHeadingRate(R, attitude_rate);
+
+    ASSERT_TRUE(heading_rate);
+    EXPECT_NEAR(heading_rate.value(), mrs_lib::AttitudeConverter(R).getHeadingRate(attitude_rate), 1e-9);
+  }
+}
+
+TEST(AttitudeMath, getYawRateIntrinsic) {
+
+  std::mt19937                           generator(44);
+  std::uniform_real_distribution<double> rate(-3.0, 3.0);
+
+  for (const auto& R : randomAttitudes(1000)) {
+
+    const double heading_rate = rate(generator);
+
+    std::optional<double> yaw_rate = common::getYawRateIntrinsic(R, heading_rate);
+
+    ASSERT_TRUE(yaw_rate);
+    EXPECT_NEAR(yaw_rate.value(), mrs_lib::AttitudeConverter(R).getYawRateIntrinsic(heading_rate), 1e-9);
+
+    // the yaw rate alone produces the heading rate
+    EXPECT_NEAR(common::getHeadingRate(R, Eigen::Vector3d(0, 0, yaw_rate.value())).value(), heading_rate, 1e-9);
+  }
+}
+
+TEST(AttitudeMath, setHeading) {
+
+  std::mt19937                           generator(45);
+  std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+
+  for (const auto& R : randomAttitudes(1000)) {
+
+    const double new_heading = heading(generator);
+
+    std::optional<Eigen::Matrix3d> R_new = common::setHeading(R, new_heading);
+
+    ASSERT_TRUE(R_new);
+    EXPECT_TRUE(R_new->isApprox(Eigen::Matrix3d(mrs_lib::AttitudeConverter(R).setHeading(new_heading)), 1e-9));
+
+    // a rotation with the same body z and the new heading
+    EXPECT_TRUE((R_new.value() * R_new->transpose()).isIdentity(1e-9));
+    EXPECT_NEAR(R_new->determinant(), 1.0, 1e-9);
+    EXPECT_TRUE(R_new->col(2).isApprox(R.col(2), 1e-9));
+    EXPECT_LT(angleDifference(common::getHeading(R_new.value()).value(), new_heading), 1e-9);
+  }
+}
+
+// | ------------------ the singular attitudes ------------------ |
+
+TEST(AttitudeMath, bodyXVertical) {
+
+  // pitched by 90 deg, the body x points down
+  const Eigen::Matrix3d R = Eigen::Matrix3d(mrs_lib::AttitudeConverter(0.3, M_PI / 2.0, 0.5));
+
+  EXPECT_FALSE(common::getHeading(R));
+  EXPECT_FALSE(common::getHeadingRate(R, Eigen::Vector3d(0.1, 0.2, 0.3)));
+  EXPECT_FALSE(common::getYawRateIntrinsic(R, 0.5));
+
+  // no heading rate is wanted, no yaw rate is needed
+  ASSERT_TRUE(common::getYawRateIntrinsic(R, 0.0));
+  EXPECT_EQ(common::getYawRateIntrinsic(R, 0.0).value(), 0.0);
+}
+
+TEST(AttitudeMath, bodyZHorizontal) {
+
+  // rolled by 90 deg, the body yaw does not change the heading and the heading vector can not be projected
+  const Eigen::Matrix3d R = Eigen::Matrix3d(mrs_lib::AttitudeConverter(M_PI / 2.0, 0.0, 0.5));
+
+  EXPECT_TRUE(common::getHeading(R));
+  EXPECT_FALSE(common::getYawRateIntrinsic(R, 0.5));
+  EXPECT_FALSE(common::setHeading(R, 1.0));
+}
+
+int main(int argc, char** argv) {
+
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,181 @@
+#include <mrs_uav_controllers/common/flatness.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+using namespace mrs_uav_controllers;
+
+const double g = 9.81;
+
+/* Trajectory_t //{ */
+
+// a flat output trajectory around t = 0 with a constant snap and heading acceleration
+typedef struct
+{
+  Eigen::Vector3d acceleration;
+  Eigen::Vector3d jerk;
+  Eigen::Vector3d snap;
+  double          heading;
+  double          heading_rate;
+  double          heading_acceleration;
+} Trajectory_t;
+
+//}
+
+/* desiredOrientation() //{ */
+
+// the desired orientation at the time t, constructed as in the Se3Controller
+template <int rotation_type>
+Eigen::Matrix3d desiredOrientation(const Trajectory_t& trajectory, const double t) {
+
+  const Eigen::Vector3d acceleration = trajectory.acceleration + trajectory.jerk * t + 0.5 * trajectory.snap * t * t;
+  const double          heading      = trajectory.heading + trajectory.heading_rate * t + 0.5 * trajectory.heading_acceleration * t * t;
+
+  const Eigen::Vector3d zb = (acceleration + Eigen::Vector3d(0, 0, g)).normalized();
+  const Eigen::Vector3d xc(cos(heading), sin(heading), 0);
+
+  Eigen::Matrix3d Rd;
+
+  Rd.col(2) = zb;
+
+  if constexpr (rotation_type == common::ROTATION_LEE) {
+
+    Rd.col(1) = zb.cross(xc).normalized();
+    Rd.col(0) = Rd.col(1).cross(zb);
+
+  } else {
+
+    // the oblique projection of the heading vector along the world z
+    Rd.col(0) = Eigen::Vector3d(xc[0], xc[1], -(zb[0] * xc[0] + zb[1] * xc[1]) / zb[2]).normalized();
+    Rd.col(1) = zb.cross(Rd.col(0));
+  }
+
+  return Rd;
+}
+
+//}
+
+/* attitudeRate() //{ */
+
+// the body attitude rate from the central difference of the orientation, [w]x = R' * dR/dt
+template <int rotation_type>
+Eigen::Vector3d attitudeRate(const Trajectory_t& trajectory, const double t) {
+
+  const double h = 1e-5;
+
+  const Eigen::Matrix3d R     = desiredOrientation<rotation_type>(trajectory, t);
+  const Eigen::Matrix3d R_dot = (desiredOrientation<rotation_type>(trajectory, t + h) - desiredOrientation<rotation_type>(trajectory, t - h)) / (2.0 * h);
+  const Eigen::Matrix3d W     = R.transpose() * R_dot;
+
+  return Eigen::Vector3d(W(2, 1), W(0, 2), W(1, 0));
+}
+
+//}
+
+/* randomTrajectories() //{ */
+
+std::vector<Trajectory_t> randomTrajectories(const int n) {
+
+  std::mt19937                           generator(42);
+  std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+  auto randomVector = [&](const double scale) -> Eigen::Vector3d {
+    return Eigen::Vector3d(uniform(generator), uniform(generator), uniform(generator)) * scale;
+  };
+
+  std::vector<Trajectory_t> trajectories;
+
+  for (int i = 0; i < n; i++) {
+
+    Trajectory_t trajectory;
+
+    trajectory.acceleration         = randomVector(5.0);
+    trajectory.jerk                 = randomVector(10.0);
+    trajectory.snap                 = randomVector(50.0);
+    trajectory.heading              = M_PI * uniform(generator);
+    trajectory.heading_rate         = 2.0 * uniform(generator);
+    trajectory.heading_acceleration = 5.0 * uniform(generator);
+
+    trajectories.push_back(trajectory);
+  }
+
+  return trajectories;
+}
+
+//}
+
+/* checkFlatnessFeedforward() //{ */
+
+template <int rotation_type>
+void checkFlatnessFeedforward(void) {
+
+  for (const auto& trajectory : randomTrajectories(1000)) {
+
+    common::FlatReference_t reference;
+
+    reference.jerk                 = trajectory.jerk;
+    reference.snap                 = trajectory.snap;
+    reference.heading              = trajectory.heading;
+    reference.heading_rate         = trajectory.heading_rate;
+    reference.heading_acceleration = trajectory.heading_acceleration;
+
+    const Eigen::Matrix3d Rd = desiredOrientation<rotation_type>(trajectory, 0);
+    const double          c  = (trajectory.acceleration + Eigen::Vector3d(0, 0, g)).norm();
+
+    common::FlatnessFeedforward_t feedforward;
+
+    ASSERT_TRUE(common::flatnessFeedforward<rotation_type>(Rd, c, reference, feedforward));
+
+    const double h = 1e-3;
+
+    const Eigen::Vector3d attitude_rate        = attitudeRate<rotation_type>(trajectory, 0);
+    const Eigen::Vector3d angular_acceleration = (attitudeRate<rotation_type>(trajectory, h) - attitudeRate<rotation_type>(trajectory, -h)) / (2.0 * h);
+
+    EXPECT_LT((feedforward.attitude_rate - attitude_rate).norm(), 1e-7);
+    EXPECT_LT((feedforward.angular_acceleration - angular_acceleration).norm(), 1e-4 * std::max(1.0, angular_acceleration.norm()));
+  }
+}
+
+//}
+
+TEST(Flatness, feedforwardLee) {
+  checkFlatnessFeedforward<common::ROTATION_LEE>();
+}
+
+TEST(Flatness, feedforwardBaca) {
+  checkFlatnessFeedforward<common::ROTATION_BACA>();
+}
+
+TEST(Flatness, singular) {
+
+  common::FlatReference_t reference;
+
+  reference.jerk                 = Eigen::Vector3d(1, 2, 3);
+  reference.snap                 = Eigen::Vector3d(4, 5, 6);
+  reference.heading              = 0;
+  reference.heading_rate         = 0;
+  reference.heading_acceleration = 0;
+
+  common::FlatnessFeedforward_t feedforward;
+
+  // free fall, no collective acceleration
+  EXPECT_FALSE(common::flatnessFeedforward<common::ROTATION_LEE>(Eigen::Matrix3d::Identity(), 0.0, reference, feedforward));
+  EXPECT_FALSE(common::flatnessFeedforward<common::ROTATION_BACA>(Eigen::Matrix3d::Identity(), 0.0, reference, feedforward));
+
+  // the body x orthogonal to the heading vector (Lee), the body y orthogonal to its normal (Baca)
+  const Eigen::Matrix3d Rd = Eigen::AngleAxisd(M_PI / 2.0, Eigen::Vector3d::UnitZ()).toRotationMatrix();
+
+  EXPECT_FALSE(common::flatnessFeedforward<common::ROTATION_LEE>(Rd, g, reference, feedforward));
+  EXPECT_FALSE(common::flatnessFeedforward<common::ROTATION_BACA>(Rd, g, reference, feedforward));
+}
+
+int main(int argc, char** argv) {
+
+  testing::InitGoogleTest(&argc, argv);
+
+  return RUN_ALL_TESTS();
+}